@@ -0,0 +1,161 @@
+// VM listing cost, per-domain calls vs one virConnectGetAllDomainStats,
+// for 10 to 1000 running domains on the libvirt test:///default driver.
+//
+// The test driver answers in-process, so the gap only shows the number of
+// libvirt calls; over qemu+ssh every one of them is a network round trip.
+
+#include "../include/domain_stats.hpp"
+
+#include <libvirt/libvirt.h>
+#include <libvirt/virterror.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+const char* TEST_URI = "test:///default";
+const int SIZES[] = {10, 100, 1000};
+const int RUNS = 5;
+
+void ignoreErrors(void*, virErrorPtr) {}
+
+std::string domainXml(const std::string& name) {
+    return "<domain type='test'>"
+           "<name>" + name + "</name>"
+           "<memory unit='MiB'>512</memory>"
+           "<vcpu>1</vcpu>"
+           "<os><type>hvm</type></os>"
+           "<devices>"
+           "<disk type='file' device='disk'>"
+           "<source file='/var/lib/libvirt/images/" + name + ".qcow2'/>"
+           "<target dev='vda' bus='virtio'/>"
+           "</disk>"
+           "<interface type='network'><source network='default'/></interface>"
+           "</devices>"
+           "</domain>";
+}
+
+bool defineDomains(virConnectPtr conn, int count) {
+    for (int i = 0; i < count; i++) {
+        std::string name = "bench-" + std::to_string(i);
+        virDomainPtr domain = virDomainDefineXML(conn, domainXml(name).c_str());
+        if (!domain) {
+            fprintf(stderr, "Cannot define %s\n", name.c_str());
+            return false;
+        }
+        virDomainCreate(domain);
+        virDomainFree(domain);
+    }
+    return true;
+}
+
+void removeDomains(virConnectPtr conn, int count) {
+    for (int i = 0; i < count; i++) {
+        std::string name = "bench-" + std::to_string(i);
+        virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+        if (!domain) continue;
+        virDomainDestroy(domain);
+        virDomainUndefine(domain);
+        virDomainFree(domain);
+    }
+}
+
+// What listAllVMs did before the bulk path: info and ID per domain, then
+// info, block and interface stats again for each running one
+size_t listPerDomain(virConnectPtr conn, const std::unordered_map<std::string, std::string>& nics) {
+    virDomainPtr* domains = nullptr;
+    int count = virConnectListAllDomains(conn, &domains, 0);
+    if (count < 0) return 0;
+
+    size_t calls = 1;
+    for (int i = 0; i < count; i++) {
+        virDomainInfo info;
+        virDomainGetInfo(domains[i], &info);
+        virDomainGetID(domains[i]);
+        calls += 2;
+
+        if (info.state == VIR_DOMAIN_RUNNING) {
+            virDomainGetInfo(domains[i], &info);
+            virDomainBlockStatsStruct block;
+            virDomainBlockStats(domains[i], "vda", &block, sizeof(block));
+            calls += 2;
+
+            auto nic = nics.find(virDomainGetName(domains[i]));
+            if (nic != nics.end()) {
+                virDomainInterfaceStatsStruct net;
+                virDomainInterfaceStats(domains[i], nic->second.c_str(), &net, sizeof(net));
+                calls++;
+            }
+        }
+        virDomainFree(domains[i]);
+    }
+    free(domains);
+    return calls;
+}
+
+size_t listBulk(virConnectPtr conn) {
+    std::vector<DomainStats::DomainSample> samples;
+    DomainStats::collectAll(conn, samples);
+    return 1;
+}
+
+template <typename F>
+double medianMs(F run) {
+    std::vector<double> times;
+    for (int i = 0; i < RUNS; i++) {
+        auto started = std::chrono::steady_clock::now();
+        run();
+        times.push_back(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - started).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+} // namespace
+
+int main() {
+    virSetErrorFunc(nullptr, ignoreErrors);
+
+    virConnectPtr conn = virConnectOpen(TEST_URI);
+    if (!conn) {
+        fprintf(stderr, "Cannot open %s\n", TEST_URI);
+        return 1;
+    }
+
+    printf("%8s  %14s %10s  %14s %10s  %8s\n",
+           "domains", "per-domain ms", "calls", "bulk ms", "calls", "speedup");
+
+    for (int size : SIZES) {
+        if (!defineDomains(conn, size)) {
+            removeDomains(conn, size);
+            virConnectClose(conn);
+            return 1;
+        }
+
+        // Interface names are only known at run time
+        std::unordered_map<std::string, std::string> nics;
+        std::vector<DomainStats::DomainSample> samples;
+        DomainStats::collectAll(conn, samples);
+        for (const auto& sample : samples) {
+            if (!sample.nics.empty()) nics[sample.name] = sample.nics[0].name;
+        }
+
+        size_t perDomainCalls = 0, bulkCalls = 0;
+        double perDomain = medianMs([&]() { perDomainCalls = listPerDomain(conn, nics); });
+        double bulk = medianMs([&]() { bulkCalls = listBulk(conn); });
+
+        printf("%8d  %14.2f %10zu  %14.2f %10zu  %7.1fx\n",
+               size, perDomain, perDomainCalls, bulk, bulkCalls, bulk > 0 ? perDomain / bulk : 0.0);
+
+        removeDomains(conn, size);
+    }
+
+    virConnectClose(conn);
+    return 0;
+}
@@ -0,0 +1,186 @@
+// Reading the VNC port and disk paths out of a domain's XML: the std::regex
+// searches the handlers used to run on every call, against one
+// parseDomainXML pass (which DomainModelCache then keeps per domain).
+// Snapshot metadata is compared the same way.
+
+#include "../include/domain_model.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int ITERATIONS = 20000;
+
+// Live XML of a running qemu guest, trimmed of the parts nobody reads
+const char* DOMAIN_XML = R"(<domain type='kvm' id='7'>
+  <name>alice__web__1718000000</name>
+  <uuid>6f1c1b7e-3f0a-4c36-9d4e-2b1f0c8e5a11</uuid>
+  <memory unit='KiB'>2097152</memory>
+  <currentMemory unit='KiB'>2097152</currentMemory>
+  <vcpu placement='static'>2</vcpu>
+  <resource><partition>/machine</partition></resource>
+  <os><type arch='x86_64' machine='pc-q35-8.2'>hvm</type><boot dev='hd'/></os>
+  <features><acpi/><apic/><vmport state='off'/></features>
+  <cpu mode='host-passthrough' check='none' migratable='on'/>
+  <clock offset='utc'><timer name='rtc' tickpolicy='catchup'/><timer name='pit' tickpolicy='delay'/></clock>
+  <on_poweroff>destroy</on_poweroff>
+  <on_reboot>restart</on_reboot>
+  <on_crash>destroy</on_crash>
+  <devices>
+    <emulator>/usr/bin/qemu-system-x86_64</emulator>
+    <disk type='file' device='disk'>
+      <driver name='qemu' type='qcow2' discard='unmap'/>
+      <source file='/var/lib/libvirt/images/alice__web__1718000000.qcow2' index='2'/>
+      <backingStore type='file' index='3'>
+        <format type='qcow2'/>
+        <source file='/var/lib/libvirt/images/base/ubuntu-24.04.qcow2'/>
+        <backingStore/>
+      </backingStore>
+      <target dev='vda' bus='virtio'/>
+      <alias name='virtio-disk0'/>
+      <address type='pci' domain='0x0000' bus='0x04' slot='0x00' function='0x0'/>
+    </disk>
+    <disk type='file' device='cdrom'>
+      <driver name='qemu' type='raw'/>
+      <source file='/var/lib/libvirt/images/alice__web__1718000000-cloud-init.iso' index='1'/>
+      <backingStore/>
+      <target dev='sda' bus='sata'/>
+      <readonly/>
+      <alias name='sata0-0-0'/>
+      <address type='drive' controller='0' bus='0' target='0' unit='0'/>
+    </disk>
+    <controller type='usb' index='0' model='qemu-xhci' ports='15'><alias name='usb'/></controller>
+    <controller type='sata' index='0'><alias name='ide'/></controller>
+    <controller type='pci' index='0' model='pcie-root'><alias name='pcie.0'/></controller>
+    <interface type='network'>
+      <mac address='52:54:00:3a:91:0c'/>
+      <source network='default' portid='0b1e5a8e-44a2-4d5c-9a1e-6f3b2c1d0e9f' bridge='virbr0'/>
+      <target dev='vnet6'/>
+      <model type='virtio'/>
+      <alias name='net0'/>
+      <address type='pci' domain='0x0000' bus='0x01' slot='0x00' function='0x0'/>
+    </interface>
+    <serial type='pty'><source path='/dev/pts/3'/><target type='isa-serial' port='0'/><alias name='serial0'/></serial>
+    <console type='pty' tty='/dev/pts/3'><source path='/dev/pts/3'/><target type='serial' port='0'/></console>
+    <channel type='unix'>
+      <source mode='bind' path='/run/libvirt/qemu/channel/7-alice__web__1718000000/org.qemu.guest_agent.0'/>
+      <target type='virtio' name='org.qemu.guest_agent.0' state='connected'/>
+      <alias name='channel0'/>
+      <address type='virtio-serial' controller='0' bus='0' port='1'/>
+    </channel>
+    <input type='tablet' bus='usb'><alias name='input0'/></input>
+    <graphics type='vnc' port='5907' autoport='yes' listen='0.0.0.0'>
+      <listen type='address' address='0.0.0.0'/>
+    </graphics>
+    <video><model type='virtio' heads='1' primary='yes'/><alias name='video0'/></video>
+    <memballoon model='virtio'><stats period='5'/><alias name='balloon0'/></memballoon>
+  </devices>
+</domain>)";
+
+const char* SNAPSHOT_XML = R"(<domainsnapshot>
+  <name>before-upgrade</name>
+  <state>running</state>
+  <creationTime>1718003600</creationTime>
+  <memory snapshot='internal'/>
+  <disks><disk name='vda' snapshot='internal'/></disks>
+</domainsnapshot>)";
+
+// What getVNCInfo and getDiskPaths did: regexes built on every call.
+// The disk pattern also matches backing images, which is how deleteVM
+// used to reach the shared base image.
+struct Extracted {
+    int vncPort = -1;
+    std::vector<std::string> disks;
+};
+
+Extracted extractWithRegex(const std::string& xml) {
+    Extracted result;
+
+    std::regex portRegex("<graphics type='vnc' port='(\\d+)'");
+    std::smatch match;
+    if (std::regex_search(xml, match, portRegex) && match[1].str() != "-1") {
+        result.vncPort = std::stoi(match[1].str());
+    }
+
+    std::regex diskRegex("<source file='([^']+)'");
+    for (std::sregex_iterator it(xml.begin(), xml.end(), diskRegex), end; it != end; ++it) {
+        result.disks.push_back((*it)[1].str());
+    }
+    return result;
+}
+
+Extracted extractWithParser(const std::string& xml) {
+    Extracted result;
+    DomainModel model;
+    if (!parseDomainXML(xml, model)) return result;
+
+    const GraphicsModel* vnc = model.findGraphics("vnc");
+    if (vnc) result.vncPort = vnc->port;
+    for (const auto& disk : model.disks) {
+        if (disk.hasPath()) result.disks.push_back(disk.source);
+    }
+    return result;
+}
+
+SnapshotModel snapshotWithRegex(const std::string& xml) {
+    SnapshotModel snapshot;
+    std::regex timeRegex("<creationTime>(\\d+)</creationTime>");
+    std::regex stateRegex("<state>(\\w+)</state>");
+    std::smatch match;
+    if (std::regex_search(xml, match, timeRegex)) snapshot.creationTime = std::stoll(match[1].str());
+    if (std::regex_search(xml, match, stateRegex)) snapshot.state = match[1].str();
+    return snapshot;
+}
+
+SnapshotModel snapshotWithParser(const std::string& xml) {
+    SnapshotModel snapshot;
+    parseSnapshotXML(xml, snapshot);
+    return snapshot;
+}
+
+// Keeps the optimizer from dropping the calls
+size_t sink = 0;
+
+template <typename F>
+double microsPerCall(F run) {
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < ITERATIONS; i++) {
+        sink += run();
+    }
+    return std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - started).count() / ITERATIONS;
+}
+
+void printRow(const char* what, double regex, double parser) {
+    printf("%-22s %12.2f %12.2f %8.1fx\n", what, regex, parser, parser > 0 ? regex / parser : 0.0);
+}
+
+} // namespace
+
+int main() {
+    const std::string domainXml = DOMAIN_XML;
+    const std::string snapshotXml = SNAPSHOT_XML;
+
+    Extracted viaRegex = extractWithRegex(domainXml);
+    Extracted viaParser = extractWithParser(domainXml);
+    if (viaRegex.vncPort != viaParser.vncPort) {
+        fprintf(stderr, "VNC port differs: regex %d, parser %d\n", viaRegex.vncPort, viaParser.vncPort);
+        return 1;
+    }
+    printf("%zu-byte domain XML: regex finds %zu disk path(s), the parser %zu (backing images excluded)\n",
+           domainXml.size(), viaRegex.disks.size(), viaParser.disks.size());
+
+    printf("%-22s %12s %12s %9s\n", "", "regex us", "parser us", "speedup");
+    printRow("domain: vnc + disks",
+             microsPerCall([&]() { return extractWithRegex(domainXml).disks.size(); }),
+             microsPerCall([&]() { return extractWithParser(domainXml).disks.size(); }));
+    printRow("snapshot metadata",
+             microsPerCall([&]() { return snapshotWithRegex(snapshotXml).state.size(); }),
+             microsPerCall([&]() { return snapshotWithParser(snapshotXml).state.size(); }));
+
+    return sink == 0 ? 1 : 0;
+}
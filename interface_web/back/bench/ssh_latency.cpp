@@ -0,0 +1,128 @@
+// Remote command latency: a fresh ssh connection per command (what every
+// RemoteExecutor call did before) against a channel on the SSHSession
+// master connection.
+//
+// Needs a reachable host, so it only runs when THOTH_BENCH_SSH is set:
+//   THOTH_BENCH_SSH=user@host [THOTH_BENCH_SSH_KEY=~/.ssh/id_ed25519] make bench
+// A local sshd (user@localhost) shows the handshake cost without the
+// network; over a WAN link the gap grows by a few round trips per command.
+
+#include "../include/ssh_session.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using RemoteExec::SSHSession;
+using RemoteExec::SSHTarget;
+
+namespace {
+
+const int RUNS = 20;
+const char* COMMAND = "true";
+
+struct Summary {
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+};
+
+Summary summarize(std::vector<double> times) {
+    Summary summary;
+    if (times.empty()) return summary;
+
+    std::sort(times.begin(), times.end());
+    for (double t : times) summary.mean += t;
+    summary.mean /= times.size();
+    summary.p50 = times[times.size() / 2];
+    summary.p95 = times[std::min(times.size() - 1, times.size() * 95 / 100)];
+    return summary;
+}
+
+template <typename F>
+bool measure(F run, std::vector<double>& times) {
+    for (int i = 0; i < RUNS; i++) {
+        auto started = std::chrono::steady_clock::now();
+        if (!run()) return false;
+        times.push_back(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - started).count());
+    }
+    return true;
+}
+
+// Same options as SSHSession, with multiplexing turned off
+std::string directCommand(const SSHTarget& target) {
+    std::string cmd = "ssh ";
+    if (!target.keyFile.empty()) {
+        cmd += "-i " + SSHSession::shellQuote(target.keyFile) + " ";
+    }
+    cmd += "-o StrictHostKeyChecking=no -o UserKnownHostsFile=/dev/null -o LogLevel=ERROR "
+           "-o ConnectTimeout=10 -o BatchMode=yes -o PasswordAuthentication=no "
+           "-o ControlMaster=no -o ControlPath=none ";
+    return cmd + SSHSession::shellQuote(target.key()) + " " + SSHSession::shellQuote(COMMAND) +
+           " < /dev/null > /dev/null 2>&1";
+}
+
+void print(const char* label, const Summary& summary) {
+    printf("%-24s %10.2f %10.2f %10.2f\n", label, summary.mean, summary.p50, summary.p95);
+}
+
+} // namespace
+
+int main() {
+    const char* destination = getenv("THOTH_BENCH_SSH");
+    if (!destination || !*destination) {
+        printf("THOTH_BENCH_SSH not set (user@host), skipping\n");
+        return 0;
+    }
+
+    std::string value = destination;
+    size_t at = value.find('@');
+    if (at == std::string::npos || at == 0 || at + 1 == value.size()) {
+        fprintf(stderr, "THOTH_BENCH_SSH must be user@host\n");
+        return 1;
+    }
+
+    SSHTarget target;
+    target.user = value.substr(0, at);
+    target.host = value.substr(at + 1);
+    const char* key = getenv("THOTH_BENCH_SSH_KEY");
+    target.keyFile = key && *key ? key : RemoteExec::findDefaultSSHKey();
+
+    SSHSession& session = SSHSession::instance();
+    std::string output;
+
+    // The first command also starts the master; timed on its own
+    auto started = std::chrono::steady_clock::now();
+    if (session.runWithInput(target, COMMAND, "", output) != 0) {
+        fprintf(stderr, "Cannot run a command on %s: %s\n", target.key().c_str(), output.c_str());
+        return 1;
+    }
+    double first = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - started).count();
+
+    std::vector<double> direct, multiplexed;
+    std::string cmd = directCommand(target);
+    if (!measure([&]() { return system(cmd.c_str()) == 0; }, direct)) {
+        fprintf(stderr, "Direct ssh to %s failed\n", target.key().c_str());
+        return 1;
+    }
+    if (!measure([&]() { return session.runWithInput(target, COMMAND, "", output) == 0; }, multiplexed)) {
+        fprintf(stderr, "Multiplexed ssh to %s failed: %s\n", target.key().c_str(), output.c_str());
+        session.closeAll();
+        return 1;
+    }
+
+    printf("%s, %d runs of '%s'%s\n", target.key().c_str(), RUNS, COMMAND,
+           session.isConnected(target) ? "" : " (no master connection, multiplexing inactive)");
+    printf("%-24s %10s %10s %10s\n", "", "mean ms", "p50 ms", "p95 ms");
+    print("new connection", summarize(direct));
+    print("shared session", summarize(multiplexed));
+    printf("%-24s %10.2f\n", "first (starts master)", first);
+
+    session.closeAll();
+    return 0;
+}
@@ -0,0 +1,164 @@
+// StatsStore read throughput with 1 to 16 reader threads while the sampler
+// keeps recording, against the simplest correct alternative: one map behind
+// one mutex. Reads are latest() calls, the hot path of /api/vms and the
+// per-VM stats endpoint.
+//
+// Scaling needs cores: on a single-CPU machine both columns stay flat.
+
+#include "../include/stats_store.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+const int VMS = 256;
+const int THREADS[] = {1, 2, 4, 8, 16};
+const auto DURATION = std::chrono::milliseconds(500);
+const size_t HISTORY = 60;
+
+// Same contents and CPU computation, one lock for everything
+class GlobalLockStore {
+public:
+    void record(const DomainStats::DomainSample& sample) {
+        StatsPoint point;
+        point.timestamp = sample.timestamp;
+        point.memoryUsed = sample.balloonCurrent;
+        point.memoryMax = sample.balloonMaximum;
+        for (const auto& disk : sample.disks) {
+            point.disks.push_back({disk.name, disk.readBytes, disk.writeBytes});
+        }
+        for (const auto& nic : sample.nics) {
+            point.nics.push_back({nic.name, nic.rxBytes, nic.txBytes});
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = series.find(sample.name);
+        if (it == series.end()) {
+            it = series.emplace(sample.name, Series{RingBuffer<StatsPoint>(HISTORY), 0}).first;
+        }
+        if (!it->second.points.empty()) {
+            long long timeDiff = point.timestamp - it->second.points.back().timestamp;
+            if (timeDiff > 0 && sample.cpuTime >= it->second.lastCpuTime) {
+                point.cpuPercent = (sample.cpuTime - it->second.lastCpuTime) / (timeDiff * 1000000.0) * 100.0;
+            }
+        }
+        it->second.lastCpuTime = sample.cpuTime;
+        it->second.points.push(point);
+    }
+
+    bool latest(const std::string& vmName, StatsPoint& out) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = series.find(vmName);
+        if (it == series.end() || it->second.points.empty()) return false;
+        out = it->second.points.back();
+        return true;
+    }
+
+private:
+    struct Series {
+        RingBuffer<StatsPoint> points;
+        unsigned long long lastCpuTime = 0;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Series> series;
+};
+
+std::vector<std::string> names() {
+    std::vector<std::string> result;
+    for (int i = 0; i < VMS; i++) {
+        result.push_back("vm-" + std::to_string(i));
+    }
+    return result;
+}
+
+DomainStats::DomainSample sample(const std::string& name, long long round) {
+    DomainStats::DomainSample s;
+    s.name = name;
+    s.timestamp = round * 1000;
+    s.cpuTime = round * 250000000ULL;
+    s.balloonCurrent = 1048576;
+    s.balloonMaximum = 2097152;
+
+    DomainStats::BlockSample disk;
+    disk.name = "vda";
+    disk.readBytes = round * 4096;
+    s.disks.push_back(disk);
+
+    DomainStats::NetSample nic;
+    nic.name = "vnet0";
+    nic.rxBytes = round * 1500;
+    s.nics.push_back(nic);
+    return s;
+}
+
+// Reads per second over all readers, with one writer recording meanwhile
+template <typename Store>
+double readsPerSecond(Store& store, const std::vector<std::string>& vms, int readers) {
+    std::atomic<bool> running{true};
+    std::atomic<long long> reads{0};
+    std::vector<std::thread> threads;
+
+    threads.emplace_back([&]() {
+        for (long long round = 2; running; round++) {
+            for (const auto& name : vms) {
+                store.record(sample(name, round));
+            }
+        }
+    });
+
+    for (int r = 0; r < readers; r++) {
+        threads.emplace_back([&, r]() {
+            long long count = 0;
+            size_t i = r;
+            StatsPoint point;
+            while (running) {
+                i = (i + 13) % vms.size();
+                store.latest(vms[i], point);
+                count++;
+            }
+            reads += count;
+        });
+    }
+
+    std::this_thread::sleep_for(DURATION);
+    running = false;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    return reads.load() / std::chrono::duration<double>(DURATION).count();
+}
+
+} // namespace
+
+int main() {
+    auto vms = names();
+
+    StatsStore sharded;
+    sharded.setHistoryCapacity(HISTORY);
+    GlobalLockStore global;
+    for (const auto& name : vms) {
+        sharded.record(sample(name, 1));
+        global.record(sample(name, 1));
+    }
+
+    printf("%u hardware threads, %d VMs, one writer\n",
+           std::thread::hardware_concurrency(), VMS);
+    printf("%8s  %16s  %16s  %8s\n", "readers", "sharded Mreads/s", "global Mreads/s", "ratio");
+
+    for (int readers : THREADS) {
+        double shardedRate = readsPerSecond(sharded, vms, readers);
+        double globalRate = readsPerSecond(global, vms, readers);
+        printf("%8d  %16.2f  %16.2f  %7.1fx\n", readers, shardedRate / 1e6, globalRate / 1e6,
+               globalRate > 0 ? shardedRate / globalRate : 0.0);
+    }
+    return 0;
+}
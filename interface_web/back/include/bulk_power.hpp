@@ -0,0 +1,34 @@
+#ifndef BULK_POWER_HPP
+#define BULK_POWER_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+class VMOperations;
+
+// One power action (start, shutdown, destroy, reboot, pause, resume)
+// applied to many VMs with a fixed number of threads sharing the
+// libvirt connections.
+namespace BulkPower {
+
+constexpr size_t DEFAULT_CONCURRENCY = 8;
+constexpr size_t MAX_VMS = 500;
+
+bool isSupportedAction(const std::string& action);
+
+// Per-VM outcomes in input order plus a latency summary:
+// {"results": [{name, success, durationMs, error?}], "summary": {...}}
+// ops[i] is the connection names[i] is reached through; VMs on the same
+// host share one.
+json run(const std::vector<VMOperations*>& ops, const std::string& action,
+         const std::vector<std::string>& names,
+         size_t concurrency = DEFAULT_CONCURRENCY);
+
+} // namespace BulkPower
+
+#endif // BULK_POWER_HPP
@@ -0,0 +1,30 @@
+#ifndef CLOUD_INIT_CONFIG_HPP
+#define CLOUD_INIT_CONFIG_HPP
+
+#include <string>
+#include <vector>
+
+namespace CloudInit {
+
+struct UserDataOptions {
+    std::string hostname;            // guest hostname
+    std::string fqdn;
+    std::string username;
+    std::string authMethod;          // "password" or "ssh-key"
+    std::string passwordHash;        // crypt(3) hash, for "password"
+    std::string sshKey;              // public key, for "ssh-key"
+    bool installPackages = true;     // package update + qemu-guest-agent
+    std::string powerState = "reboot";  // "reboot", "poweroff", or empty to stay up
+    std::vector<std::string> extraCommands;  // appended to runcmd
+};
+
+// NoCloud meta-data. Changing the instance-id makes cloud-init run its
+// per-instance modules (users, hostname, ssh keys) again on next boot.
+std::string buildMetaData(const std::string& instanceId, const std::string& localHostname);
+
+// #cloud-config user-data for a single sudo user
+std::string buildUserData(const UserDataOptions& options);
+
+} // namespace CloudInit
+
+#endif // CLOUD_INIT_CONFIG_HPP
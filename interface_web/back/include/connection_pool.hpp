@@ -0,0 +1,166 @@
+#ifndef CONNECTION_POOL_HPP
+#define CONNECTION_POOL_HPP
+
+#include <libvirt/libvirt.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+// A fixed set of libvirt connections to one URI that request handlers
+// check out one at a time, so concurrent calls travel over separate
+// sockets (separate ssh tunnels for qemu+ssh) instead of queuing behind
+// the connection shared by events and background work.
+//
+// Every connection has keepalive on and a close callback. A monitor
+// thread reopens connections that died, with exponential backoff per
+// connection, so a dropped tunnel only fails the calls that were on it.
+//
+// instance() is the pool for the primary URI; HostRegistry keeps one
+// more per additional hypervisor.
+class ConnectionPool {
+public:
+    static constexpr size_t DEFAULT_SIZE = 4;
+    static constexpr int KEEPALIVE_INTERVAL_SECONDS = 5;
+    static constexpr unsigned int KEEPALIVE_COUNT = 3;
+    static constexpr int MONITOR_INTERVAL_MS = 1000;
+    static constexpr long long MIN_BACKOFF_MS = 1000;
+    static constexpr long long MAX_BACKOFF_MS = 60000;
+
+    // One checked-out connection, returned to the pool on destruction
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease();
+
+        virConnectPtr get() const { return conn; }
+        explicit operator bool() const { return conn != nullptr; }
+
+    private:
+        friend class ConnectionPool;
+        Lease(ConnectionPool* owner, size_t index, virConnectPtr connection)
+            : pool(owner), slot(index), conn(connection) {}
+        void release();
+
+        ConnectionPool* pool = nullptr;
+        size_t slot = 0;
+        virConnectPtr conn = nullptr;
+    };
+
+    ConnectionPool() = default;
+    ~ConnectionPool() { stop(); }
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    static ConnectionPool& instance();
+
+    // THOTH_LIBVIRT_POOL_SIZE, DEFAULT_SIZE when unset; 0 disables the pool
+    static size_t sizeFromEnvironment();
+
+    // Opens what it can right away; the rest is retried in the background
+    bool start(const std::string& uri, size_t size);
+    void stop();
+
+    bool isRunning() const { return running; }
+
+    // A live idle connection, or an empty lease if none is free within
+    // `timeoutMs` (or the pool is not running). 0 does not wait.
+    Lease acquire(long long timeoutMs);
+
+    json status() const;
+
+private:
+    enum class SlotState { Idle, InUse, Broken, Connecting };
+
+    struct Slot {
+        ConnectionPool* pool = nullptr;     // for the close callback
+        virConnectPtr conn = nullptr;
+        SlotState state = SlotState::Broken;
+        std::atomic<bool> closed{false};    // set by the close callback
+        bool opened = false;                // connected at least once
+        int failures = 0;                   // consecutive failed reconnects
+        long long nextAttemptMs = 0;
+    };
+
+    void run();
+    void reconnect(size_t index);
+    void giveBack(size_t index);
+    void closeSlot(Slot& slot);
+
+    static void onClose(virConnectPtr conn, int reason, void* opaque);
+
+    std::string uri;
+    std::vector<std::unique_ptr<Slot>> slots;
+
+    mutable std::mutex mutex;
+    std::condition_variable available;      // a slot became Idle
+    std::condition_variable monitorWake;    // a slot broke, or stop()
+
+    std::atomic<bool> running{false};
+    std::thread monitor;
+
+    size_t reconnects = 0;                  // lifetime counters for status()
+    size_t exhausted = 0;
+};
+
+// The connection kept outside the pool, which events and background
+// work (the inventory, the stats sampler, jobs) travel on. With the event
+// loop running it gets keepalive and a close callback, and a monitor
+// thread reopens it with the pool's backoff once it dies, then hands the
+// new one to the rebind callback so those users move over.
+//
+// Replaced connections stay open until exit: calls that started on them
+// may still be holding them.
+class SharedConnection {
+public:
+    using Rebind = std::function<void(virConnectPtr)>;
+
+    static SharedConnection& instance();
+
+    // `connection` stays owned by the caller; reopened ones belong to this class
+    void start(virConnectPtr connection, Rebind rebind);
+
+    // No more reconnects; get() keeps returning the last connection
+    void stop();
+
+    // The connection to use right now; nullptr before start()
+    virConnectPtr get() const { return conn; }
+    bool isAlive() const;
+
+private:
+    SharedConnection() = default;
+    ~SharedConnection();
+    SharedConnection(const SharedConnection&) = delete;
+    SharedConnection& operator=(const SharedConnection&) = delete;
+
+    void run();
+    void watch(virConnectPtr connection);
+
+    static void onClose(virConnectPtr conn, int reason, void* opaque);
+
+    std::atomic<virConnectPtr> conn{nullptr};
+    virConnectPtr original = nullptr;
+    std::vector<virConnectPtr> retired;
+    std::string uri;
+    Rebind rebind;
+
+    std::mutex mutex;
+    std::condition_variable wake;           // the connection closed, or stop()
+    std::atomic<bool> closed{false};
+    std::atomic<bool> running{false};
+    std::thread monitor;
+};
+
+#endif // CONNECTION_POOL_HPP
@@ -0,0 +1,111 @@
+#ifndef DOMAIN_INVENTORY_HPP
+#define DOMAIN_INVENTORY_HPP
+
+#include <libvirt/libvirt.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "domain_stats.hpp"
+
+struct DomainEntry {
+    std::string name;            // internal libvirt name
+    std::string displayName;     // user-facing hostname, or the name itself
+    std::string owner;           // empty when the name is not userid__hostname__timestamp
+    int id = -1;                 // -1 when inactive
+    int state = VIR_DOMAIN_NOSTATE;
+    unsigned int vcpus = 0;
+    unsigned long long memory = 0;      // KiB
+    unsigned long long maxMemory = 0;   // KiB
+    unsigned long long storage = 0;     // bytes, virtual size of its disks (not CD-ROMs)
+    long long updated = 0;              // ms, last time the entry changed
+
+    bool isRunning() const { return state == VIR_DOMAIN_RUNNING; }
+};
+
+// Process-wide, in-memory view of every domain on the connection.
+// Filled once by start() and kept current by libvirt domain events, so
+// listing and status queries never go back to libvirt. Every change is
+// also passed on to UsageTracker.
+class DomainInventory {
+public:
+    static DomainInventory& instance();
+
+    // Load all domains and subscribe to lifecycle, reboot, device and
+    // balloon events. Requires LibvirtEvents::startEventLoop() before the
+    // connection was opened.
+    bool start(virConnectPtr connection);
+    void stop();
+
+    // True once the initial load succeeded and events are flowing
+    bool isReady() const { return ready; }
+
+    bool get(const std::string& name, DomainEntry& out) const;
+    std::vector<DomainEntry> list() const;
+    std::vector<DomainEntry> listByOwner(const std::string& owner) const;
+
+    // Re-read one domain from libvirt, including its disk sizes (removes
+    // it if it no longer exists)
+    void refresh(const std::string& name);
+
+    // Block until the domain is shut off or gone, woken by lifecycle
+    // events. Returns false if `timeoutMs` passes first.
+    bool waitForShutoff(const std::string& name, long long timeoutMs);
+
+    // Non-blocking variant: `done(true)` runs once the domain is shut off
+    // or gone, `done(false)` when `timeoutMs` passes first, on the event
+    // loop thread (or right away if it is already off). Returns false,
+    // without calling `done`, when events are not available.
+    bool whenShutoff(const std::string& name, long long timeoutMs, std::function<void(bool)> done);
+
+    static DomainEntry makeEntry(const DomainStats::DomainSample& sample);
+
+private:
+    DomainInventory() = default;
+    DomainInventory(const DomainInventory&) = delete;
+    DomainInventory& operator=(const DomainInventory&) = delete;
+
+    // Disk sizes are only re-read when asked for or for a new entry
+    void refreshDomain(virDomainPtr domain, bool rescanDisks = false);
+    void remove(const std::string& name);
+    void upsert(DomainEntry entry);
+
+    struct ShutoffWatch {
+        std::string name;
+        int timer = -1;
+        std::function<void(bool)> done;
+    };
+
+    // Fire the watches of `name` if it is now shut off or gone
+    void checkShutoffWatches(const std::string& name);
+    static void onShutoffTimeout(int timer, void* opaque);
+
+    static void onLifecycle(virConnectPtr, virDomainPtr dom, int event, int detail, void* opaque);
+    static void onReboot(virConnectPtr, virDomainPtr dom, void* opaque);
+    static void onDeviceChange(virConnectPtr, virDomainPtr dom, const char* devAlias, void* opaque);
+    static void onBalloonChange(virConnectPtr, virDomainPtr dom, unsigned long long actual, void* opaque);
+
+    mutable std::shared_mutex mutex;
+    std::condition_variable_any changed;     // notified on every upsert / remove
+    std::unordered_map<std::string, DomainEntry> domains;
+    // While start() loads the snapshot, events already apply; the
+    // snapshot must not undo them
+    bool loading = false;
+    long long loadStarted = 0;
+    std::unordered_set<std::string> removedDuringLoad;
+    std::vector<int> callbackIds;
+    // Kept across stop()/start(): their timers run on the event loop
+    std::mutex watchMutex;
+    std::unordered_map<long long, ShutoffWatch> shutoffWatches;   // by watch ID
+    long long nextWatchId = 0;
+    virConnectPtr conn = nullptr;
+    std::atomic<bool> ready{false};
+};
+
+#endif // DOMAIN_INVENTORY_HPP
@@ -0,0 +1,97 @@
+#ifndef DOMAIN_MODEL_HPP
+#define DOMAIN_MODEL_HPP
+
+#include <libvirt/libvirt.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct DiskModel {
+    std::string type;            // "file", "block", "network", "volume"
+    std::string device;          // "disk", "cdrom", ...
+    std::string driverType;      // "qcow2", "raw", ...
+    std::string source;          // file path, device path, or pool/volume
+    std::string targetDev;       // "vda", ...
+    std::string targetBus;
+    bool readonly = false;
+
+    // Local file or block device, as opposed to network/volume sources
+    bool hasPath() const { return type == "file" || type == "block"; }
+};
+
+struct InterfaceModel {
+    std::string type;            // "network", "bridge", ...
+    std::string mac;
+    std::string source;          // network or bridge name
+    std::string model;
+    std::string target;          // host-side device, e.g. vnet0 (live XML only)
+};
+
+struct GraphicsModel {
+    std::string type;            // "vnc", "spice"
+    int port = -1;               // -1 until the domain runs with autoport
+    bool autoport = false;
+    std::string listen;
+};
+
+struct ChannelModel {
+    std::string type;            // "unix", "spicevmc", ...
+    std::string targetType;
+    std::string targetName;      // e.g. org.qemu.guest_agent.0
+    std::string state;           // "connected" / "disconnected" when running
+};
+
+// The parts of a domain definition the server works with, read in a
+// single pass over the XML. Only top-level disk sources are kept, never
+// the images of their <backingStore> chains.
+struct DomainModel {
+    std::string name;
+    std::string uuid;
+    std::vector<DiskModel> disks;
+    std::vector<InterfaceModel> interfaces;
+    std::vector<GraphicsModel> graphics;
+    std::vector<ChannelModel> channels;
+
+    const GraphicsModel* findGraphics(const std::string& type) const;
+};
+
+struct SnapshotModel {
+    std::string name;
+    std::string state;           // domain state captured, e.g. "running"
+    long long creationTime = -1; // seconds since the epoch
+};
+
+bool parseDomainXML(const std::string& xml, DomainModel& model);
+
+bool parseSnapshotXML(const std::string& xml, SnapshotModel& snapshot);
+
+// Remove every <backingStore> element (they nest along the chain) so that
+// only the top-level image of each disk is left in the XML
+std::string stripBackingStores(const std::string& xml);
+
+// Parsed live XML per domain. Entries are dropped by the domain event
+// callbacks (define, lifecycle, device changes), so they are only kept
+// while DomainInventory is receiving events.
+class DomainModelCache {
+public:
+    static DomainModelCache& instance();
+
+    // Model for the domain's current XML, or nullptr if it cannot be read
+    std::shared_ptr<const DomainModel> get(virDomainPtr domain);
+
+    void invalidate(const std::string& name);
+    void clear();
+
+private:
+    DomainModelCache() = default;
+    DomainModelCache(const DomainModelCache&) = delete;
+    DomainModelCache& operator=(const DomainModelCache&) = delete;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::shared_ptr<const DomainModel>> models;
+    unsigned long long generation = 0;   // bumped by every invalidation
+};
+
+#endif // DOMAIN_MODEL_HPP
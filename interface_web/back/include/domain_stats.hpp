@@ -0,0 +1,63 @@
+#ifndef DOMAIN_STATS_HPP
+#define DOMAIN_STATS_HPP
+
+#include <libvirt/libvirt.h>
+#include <string>
+#include <vector>
+
+namespace DomainStats {
+
+// Stat groups requested for every bulk query
+constexpr unsigned int DEFAULT_STATS = VIR_DOMAIN_STATS_STATE |
+                                       VIR_DOMAIN_STATS_CPU_TOTAL |
+                                       VIR_DOMAIN_STATS_BALLOON |
+                                       VIR_DOMAIN_STATS_VCPU |
+                                       VIR_DOMAIN_STATS_BLOCK |
+                                       VIR_DOMAIN_STATS_INTERFACE;
+
+struct BlockSample {
+    std::string name;          // target device (vda, hdc, ...)
+    std::string path;          // source path, empty for network disks
+    unsigned long long readBytes = 0;
+    unsigned long long writeBytes = 0;
+    unsigned long long capacity = 0;
+    unsigned long long allocation = 0;
+};
+
+struct NetSample {
+    std::string name;          // host-side interface (vnet0, ...)
+    unsigned long long rxBytes = 0;
+    unsigned long long txBytes = 0;
+};
+
+struct DomainSample {
+    std::string name;
+    int id = -1;                              // -1 when the domain is inactive
+    int state = VIR_DOMAIN_NOSTATE;
+    unsigned long long cpuTime = 0;           // ns
+    unsigned long long balloonCurrent = 0;    // KiB
+    unsigned long long balloonMaximum = 0;    // KiB
+    unsigned int vcpus = 0;
+    std::vector<BlockSample> disks;
+    std::vector<NetSample> nics;
+    long long timestamp = 0;                  // ms, when the sample was taken
+
+    bool isRunning() const { return state == VIR_DOMAIN_RUNNING; }
+    unsigned long long totalReadBytes() const;
+    unsigned long long totalWriteBytes() const;
+    unsigned long long totalRxBytes() const;
+    unsigned long long totalTxBytes() const;
+};
+
+// Fetch stats for every domain on the connection in a single RPC.
+// listFlags takes VIR_CONNECT_GET_ALL_DOMAINS_STATS_* filters (0 = all domains).
+bool collectAll(virConnectPtr conn, std::vector<DomainSample>& out,
+                unsigned int listFlags = 0, unsigned int stats = DEFAULT_STATS);
+
+// Fetch stats for an explicit set of domains (all on the same connection) in a single RPC.
+bool collect(virDomainPtr* domains, unsigned int count, std::vector<DomainSample>& out,
+             unsigned int stats = DEFAULT_STATS);
+
+} // namespace DomainStats
+
+#endif // DOMAIN_STATS_HPP
@@ -0,0 +1,18 @@
+#ifndef EVENT_LOOP_HPP
+#define EVENT_LOOP_HPP
+
+namespace LibvirtEvents {
+
+// Register libvirt's default event implementation and run it on a
+// dedicated thread. Must be called BEFORE opening any connection that
+// should receive domain events.
+bool startEventLoop();
+
+// Stop the event thread and wait for it to exit
+void stopEventLoop();
+
+bool isRunning();
+
+} // namespace LibvirtEvents
+
+#endif // EVENT_LOOP_HPP
@@ -0,0 +1,117 @@
+#ifndef HOST_REGISTRY_HPP
+#define HOST_REGISTRY_HPP
+
+#include <libvirt/libvirt.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "connection_pool.hpp"
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+struct HostConfig {
+    std::string name;
+    std::string uri;
+};
+
+// Outcome of one host's part of a gather()
+struct HostResult {
+    std::string host;
+    bool ok = false;
+    json data;                  // what the query returned
+    std::string error;
+    long long elapsedMs = 0;
+};
+
+// Hypervisors beyond the primary connection, each with its own small
+// connection pool. gather() fans a query out to all of them at once and
+// waits for each one at most until a common deadline, so a slow or
+// unreachable node costs an aggregate request its timeout, not its
+// ssh connect time. VMs the placement engine puts on a host are
+// recorded here, so per-VM requests reach the right one.
+class HostRegistry {
+public:
+    static constexpr const char* LOCAL_HOST = "local";
+    static constexpr size_t CONNECTIONS_PER_HOST = 2;
+    static constexpr long long QUERY_TIMEOUT_MS = 3000;
+    // Timed-out queries keep running; past this many a host is skipped
+    // until they finish instead of piling up more threads on it
+    static constexpr int MAX_PENDING_PER_HOST = 4;
+
+    // Runs on a worker thread with a connection to one host. Throws on
+    // failure. It can outlive the gather() call when the host times out,
+    // so it must capture by value.
+    using HostQuery = std::function<json(virConnectPtr)>;
+
+    // A pooled connection to one host; keeps the host and its pool alive
+    // while the lease is out
+    struct Connection {
+        std::shared_ptr<void> host;
+        ConnectionPool::Lease lease;
+
+        virConnectPtr get() const { return lease.get(); }
+        explicit operator bool() const { return static_cast<bool>(lease); }
+    };
+
+    static HostRegistry& instance();
+
+    // THOTH_HOSTS, e.g. "node2=qemu+ssh://root@10.0.0.2/system,node3=..."
+    static std::vector<HostConfig> hostsFromEnvironment();
+
+    // Connects to every host in parallel; unreachable ones are retried
+    // in the background by their pools
+    void start(const std::vector<HostConfig>& configured);
+    void stop();
+
+    bool hasHosts() const;
+
+    // Starts `query` on every host, runs `local` on the calling thread
+    // meanwhile, then collects the host results in configuration order.
+    // Hosts that have not answered `timeoutMs` after the start are
+    // reported as failed.
+    std::vector<HostResult> gather(const HostQuery& query, const std::function<void()>& local,
+                                   long long timeoutMs = QUERY_TIMEOUT_MS);
+
+    // A connection to host `name`, or an empty one if there is no such
+    // host or none of its connections is free within `timeoutMs`
+    Connection acquire(const std::string& name, long long timeoutMs);
+
+    // For work that holds a connection for minutes (jobs): the host's
+    // URI, empty if there is no such host
+    std::string uriOf(const std::string& name) const;
+
+    // Which host a VM lives on, as recorded by placement and the host
+    // refreshes. VMs not recorded are on the primary host (LOCAL_HOST).
+    void assignVM(const std::string& vmName, const std::string& host);
+    void releaseVM(const std::string& vmName);
+    std::string hostOf(const std::string& vmName) const;
+
+    json status() const;
+
+private:
+    struct Host {
+        std::string name;
+        std::string uri;
+        ConnectionPool pool;
+        std::atomic<int> pending{0};            // queries still running
+        std::atomic<size_t> timeouts{0};
+        std::atomic<long long> lastElapsedMs{-1};
+    };
+
+    HostRegistry() = default;
+    HostRegistry(const HostRegistry&) = delete;
+    HostRegistry& operator=(const HostRegistry&) = delete;
+
+    mutable std::mutex mutex;
+    // Shared with query threads, which may finish after stop()
+    std::vector<std::shared_ptr<Host>> hosts;
+    std::unordered_map<std::string, std::string> hostByVM;
+};
+
+#endif // HOST_REGISTRY_HPP
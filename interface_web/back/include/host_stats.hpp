@@ -0,0 +1,86 @@
+#ifndef HOST_STATS_HPP
+#define HOST_STATS_HPP
+
+#include <libvirt/libvirt.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+// What a hypervisor looked like at the last refresh, plus (for the
+// placement engine) the deploys placed on it since
+struct HostState {
+    std::string name;
+    bool reachable = false;
+    unsigned int cpus = 0;
+    double cpuLoad = 0;                         // busy fraction since the previous refresh
+    unsigned long long memoryBytes = 0;
+    unsigned long long freeMemoryBytes = 0;
+    unsigned long long committedMemoryBytes = 0; // maximum memory of every defined VM
+    unsigned int committedVcpus = 0;
+    long long freeDiskBytes = -1;               // on the VM image pool, -1 when unknown
+    std::unordered_map<std::string, unsigned int> vmsByOwner;
+    long long updated = 0;
+};
+
+// Node state of the primary host and every HostRegistry host, refreshed
+// in the background every REFRESH_INTERVAL_MS for /metrics, whether
+// placement is on or not. The placement engine reads hosts through
+// measure() and fill() as well, on its own schedule.
+class HostStats {
+public:
+    static constexpr int REFRESH_INTERVAL_MS = 15000;
+    static constexpr long long REFRESH_TIMEOUT_MS = 5000;
+
+    // Cumulative CPU time of a host, in ns; two readings give its load
+    struct CpuCounters {
+        unsigned long long total = 0;
+        unsigned long long idle = 0;
+    };
+
+    static HostStats& instance();
+
+    // Measures every host once, then keeps refreshing in the background
+    void start(virConnectPtr localConnection);
+    void stop();
+
+    // Every host as of the last refresh, the primary host first
+    std::vector<HostState> snapshot() const;
+
+    // Everything known about one host, in one pass. The primary host
+    // reads its domains from the inventory; the others also list their
+    // VMs under "vms". Throws when the host cannot be read.
+    static json measure(virConnectPtr conn, bool useInventory);
+
+    // Fills a named `state` from a measure() result. The CPU load is
+    // taken over the interval since `previous`, which then becomes this
+    // reading.
+    static void fill(HostState& state, const json& data, CpuCounters& previous);
+
+private:
+    HostStats() = default;
+    HostStats(const HostStats&) = delete;
+    HostStats& operator=(const HostStats&) = delete;
+
+    void run();
+    void refresh();
+
+    virConnectPtr conn = nullptr;
+
+    mutable std::mutex mutex;
+    std::vector<HostState> hosts;
+    std::unordered_map<std::string, CpuCounters> cpuCounters;   // by host, refresher only
+
+    std::condition_variable wake;
+    std::atomic<bool> running{false};
+    std::thread refresher;
+};
+
+#endif // HOST_STATS_HPP
@@ -0,0 +1,132 @@
+#ifndef JOB_MANAGER_HPP
+#define JOB_MANAGER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+enum class JobState { Queued, Running, Succeeded, Failed };
+
+struct JobStep {
+    std::string name;
+    JobState state = JobState::Running;
+    long long startedAt = 0;     // ms
+    long long finishedAt = 0;    // ms, 0 while running
+    long long progressDone = 0;  // e.g. bytes copied so far
+    long long progressTotal = 0; // 0 when the step reports no progress
+    std::string progressUnit;    // "bytes", "disks", ...
+};
+
+struct Job {
+    std::string id;
+    std::string type;            // "deploy", ...
+    std::string owner;           // user that submitted the job
+    std::string target;          // VM the job works on
+    JobState state = JobState::Queued;
+    std::string error;
+    json result;                 // set by the job on success
+    std::vector<JobStep> steps;
+    long long createdAt = 0;     // ms
+    long long startedAt = 0;
+    long long finishedAt = 0;
+};
+
+std::string jobStateToString(JobState state);
+json jobToJson(const Job& job);
+
+// Runs long operations (deploys, ...) on a small fixed pool of worker
+// threads so HTTP handlers can answer immediately with a job ID.
+// Code running inside a job reports progress through the static step
+// helpers, which are no-ops when called outside of a job.
+class JobManager {
+public:
+    // Returns true on success; may fill `result` for the job status
+    using JobFunction = std::function<bool(json& result)>;
+
+    static constexpr size_t DEFAULT_WORKERS = 4;
+    static constexpr size_t MAX_PENDING = 64;
+    static constexpr long long FINISHED_RETENTION_MS = 60LL * 60 * 1000;
+
+    static JobManager& instance();
+
+    void start(size_t workers = DEFAULT_WORKERS);
+    void stop();
+
+    struct JobRequest {
+        std::string target;
+        JobFunction fn;
+    };
+
+    // Returns the job ID, or an empty string if the queue is full
+    std::string submit(const std::string& type, const std::string& owner,
+                       const std::string& target, JobFunction fn);
+
+    // Queue every job or none of them (batches). Returns the IDs in
+    // request order, or an empty vector if the queue lacks room.
+    std::vector<std::string> submitAll(const std::string& type, const std::string& owner,
+                                       std::vector<JobRequest> requests);
+
+    bool get(const std::string& id, Job& out) const;
+    std::vector<Job> listByOwner(const std::string& owner) const;
+
+    // Progress reporting from inside a running job. beginStep() closes
+    // the previous step as succeeded; a failing job marks its open step
+    // as failed.
+    static void beginStep(const std::string& name);
+    static void endStep();
+
+    // Progress of the open step, for steps that can measure it
+    static void reportProgress(long long done, long long total, const std::string& unit = "bytes");
+
+    // From inside a running job that has to wait for something external
+    // (a guest powering off): once the job function returns true, its
+    // worker moves on and the job stays running until resume() queues
+    // `next` to finish it. Returns the job ID to pass to resume(), or an
+    // empty string outside of a job.
+    static std::string suspend(JobFunction next);
+
+    // Queue the rest of a suspended job, ahead of jobs not started yet.
+    // May be called from any thread, even before the job function returned.
+    void resume(const std::string& id);
+
+private:
+    JobManager() = default;
+    JobManager(const JobManager&) = delete;
+    JobManager& operator=(const JobManager&) = delete;
+
+    // Caller holds the mutex
+    std::string enqueue(const std::string& type, const std::string& owner,
+                        const std::string& target, JobFunction fn, long long now);
+
+    struct Suspension {
+        JobFunction next;
+        bool returned = false;   // the job function gave its worker back
+        bool resumed = false;    // resume() came first
+    };
+
+    void workerLoop();
+    void runJob(const std::string& id, JobFunction& fn);
+    void closeOpenStep(Job& job, JobState state, long long now);
+    void pruneFinished(long long now);
+
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+    std::unordered_map<std::string, Job> jobs;
+    std::deque<std::pair<std::string, JobFunction>> pending;
+    std::unordered_map<std::string, Suspension> suspended;   // by job ID
+    std::vector<std::thread> workers;
+    bool running = false;
+    unsigned long long nextId = 0;
+};
+
+#endif // JOB_MANAGER_HPP
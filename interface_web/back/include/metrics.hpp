@@ -0,0 +1,147 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "httplib.h"
+
+// Cumulative histogram with fixed bucket bounds (seconds), updated with
+// atomics only so observing never blocks
+class Histogram {
+public:
+    // Bounds must outlive the histogram (they are static tables)
+    Histogram(const double* bounds, size_t size);
+
+    void observe(double seconds);
+
+    // Appends the _bucket, _sum and _count samples; `labels` is either
+    // empty or a rendered list such as route="/api/vms",method="GET"
+    void render(std::string& out, const char* name, const std::string& labels) const;
+
+private:
+    const double* bounds;
+    size_t size;
+    std::unique_ptr<std::atomic<unsigned long long>[]> buckets;  // per bound, plus +Inf
+    std::atomic<unsigned long long> sumMicros{0};
+};
+
+// libvirt calls whose latency is tracked
+enum class LibvirtCall {
+    ConnectOpen,
+    GetAllDomainStats,
+    DomainListGetStats,
+    NodeGetInfo,
+    NodeGetCPUStats,
+    NodeGetFreeMemory,
+    DomainLookupByName,
+    DomainGetXMLDesc,
+    DomainDefineXML,
+    DomainCreate,
+    DomainShutdown,
+    DomainDestroy,
+    DomainSnapshotCreateXML,
+    DomainSnapshotLookupByName,
+    DomainListAllSnapshots,
+    DomainRevertToSnapshot,
+    DomainSnapshotDelete,
+    Count
+};
+
+// Process-wide metrics exported at /metrics in the Prometheus text
+// format: per-VM stats from the sampler, host state from HostStats, and the latency histograms recorded here for HTTP routes,
+// libvirt calls and job steps.
+//
+// Series are created the first time they are observed and never
+// removed, so their label strings are rendered once. A scrape renders
+// into buffers that keep their capacity between scrapes.
+class Metrics {
+public:
+    static Metrics& instance();
+
+    // `route` is the matched pattern, not the path, so VM names do not
+    // turn into separate series
+    void observeRequest(const std::string& method, const std::string& route,
+                        int status, double seconds);
+    void observeLibvirt(LibvirtCall call, double seconds);
+    void observeJobStep(const std::string& job, const std::string& step,
+                        bool succeeded, double seconds);
+
+    // Render every metric into the response
+    void serve(httplib::Response& res);
+
+private:
+    struct RouteSeries {
+        std::string labels;
+        Histogram latency;
+        std::array<std::atomic<unsigned long long>, 5> responses{};  // by status class 1xx..5xx
+        RouteSeries(std::string rendered);
+    };
+
+    struct StepSeries {
+        std::string labels;
+        Histogram duration;
+        std::atomic<unsigned long long> failures{0};
+        StepSeries(std::string rendered);
+    };
+
+    Metrics();
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    void renderVMs();
+    void renderHosts();
+    void renderRequests();
+    void renderLibvirt();
+    void renderJobSteps();
+
+    mutable std::shared_mutex routesMutex;
+    std::unordered_map<std::string, std::unique_ptr<RouteSeries>> routes;
+
+    std::array<std::unique_ptr<Histogram>, static_cast<size_t>(LibvirtCall::Count)> libvirt;
+
+    mutable std::shared_mutex stepsMutex;
+    std::unordered_map<std::string, std::unique_ptr<StepSeries>> steps;
+
+    // One scrape at a time; the buffers are reused across scrapes
+    static constexpr size_t VM_FAMILIES = 7;
+    std::mutex renderMutex;
+    std::string output;
+    std::array<std::string, VM_FAMILIES> vmFamilies;
+};
+
+// Times one libvirt call for Metrics::observeLibvirt
+class LibvirtTimer {
+public:
+    explicit LibvirtTimer(LibvirtCall call)
+        : call(call), started(std::chrono::steady_clock::now()) {}
+    ~LibvirtTimer();
+
+    LibvirtTimer(const LibvirtTimer&) = delete;
+    LibvirtTimer& operator=(const LibvirtTimer&) = delete;
+
+private:
+    LibvirtCall call;
+    std::chrono::steady_clock::time_point started;
+};
+
+// The result of `libvirtCall()`, timed as `call`, for calls made inline:
+//   virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+//                                     [&] { return virDomainLookupByName(conn, name); });
+template <typename Call>
+auto timeLibvirt(LibvirtCall call, Call&& libvirtCall) -> decltype(libvirtCall()) {
+    LibvirtTimer timer(call);
+    return libvirtCall();
+}
+
+// Register GET /metrics and time every request through `svr`
+void setupMetrics(httplib::Server& svr);
+
+#endif // METRICS_HPP
@@ -0,0 +1,28 @@
+#ifndef NOCLOUD_ISO_HPP
+#define NOCLOUD_ISO_HPP
+
+#include <string>
+#include <vector>
+
+namespace CloudInit {
+
+struct SeedFile {
+    std::string name;   // e.g. "user-data"
+    std::string data;
+};
+
+// Volume label cloud-init looks for on NoCloud seeds
+constexpr const char* NOCLOUD_VOLUME_ID = "cidata";
+
+// Build an ISO9660 image with Joliet extensions, entirely in memory,
+// holding `files` in its root directory. Joliet carries the real
+// (lowercase, hyphenated) names, which is what Linux mounts by default.
+std::string buildISO(const std::string& volumeId, const std::vector<SeedFile>& files);
+
+// NoCloud seed: meta-data, user-data and, if given, network-config
+std::string buildNoCloudSeed(const std::string& metaData, const std::string& userData,
+                             const std::string& networkConfig = "");
+
+} // namespace CloudInit
+
+#endif // NOCLOUD_ISO_HPP
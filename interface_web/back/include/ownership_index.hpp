@@ -0,0 +1,40 @@
+#ifndef OWNERSHIP_INDEX_HPP
+#define OWNERSHIP_INDEX_HPP
+
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// VM -> owner and owner -> VMs maps, so authorization and per-user
+// listings are hash lookups instead of name parsing over every domain.
+//
+// DomainInventory loads it from the domain list and keeps it in step
+// with define/undefine events. Deploy and clone also assign their VM
+// up front, so it can be checked while the job is still running.
+// Ownership is still what the userid__hostname__timestamp name says;
+// the index only caches it, and callers fall back to parsing on a miss.
+class OwnershipIndex {
+public:
+    static OwnershipIndex& instance();
+
+    void assign(const std::string& vmName, const std::string& owner);
+    void release(const std::string& vmName);
+
+    bool ownerOf(const std::string& vmName, std::string& owner) const;
+    std::vector<std::string> vmsOf(const std::string& owner) const;
+
+    void clear();
+
+private:
+    OwnershipIndex() = default;
+    OwnershipIndex(const OwnershipIndex&) = delete;
+    OwnershipIndex& operator=(const OwnershipIndex&) = delete;
+
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, std::string> ownerByVM;
+    std::unordered_map<std::string, std::unordered_set<std::string>> vmsByOwner;
+};
+
+#endif // OWNERSHIP_INDEX_HPP
@@ -0,0 +1,53 @@
+#ifndef PASSWORD_HASH_HPP
+#define PASSWORD_HASH_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace PasswordHash {
+
+// Same parameters mkpasswd --method=SHA-512 --rounds=4096 used
+constexpr int SHA512_ROUNDS = 4096;
+
+// "$6$rounds=4096$<salt>$<hash>" for cloud-init's passwd field.
+// Thread-safe (crypt_r). Returns an empty string on failure.
+std::string sha512Crypt(const std::string& password);
+
+// Fixed set of worker threads for hashing many passwords at once
+// (batch deploys). Each hash costs a few milliseconds of CPU.
+class HashPool {
+public:
+    static HashPool& instance();
+
+    std::future<std::string> submit(const std::string& password);
+
+    // Hash all passwords in parallel; results keep the input order
+    std::vector<std::string> hashAll(const std::vector<std::string>& passwords);
+
+    size_t workerCount() const { return workers.size(); }
+
+private:
+    explicit HashPool(size_t threads);
+    ~HashPool();
+    HashPool(const HashPool&) = delete;
+    HashPool& operator=(const HashPool&) = delete;
+
+    void workerLoop();
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::packaged_task<std::string()>> tasks;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+};
+
+} // namespace PasswordHash
+
+#endif // PASSWORD_HASH_HPP
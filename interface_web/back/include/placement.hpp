@@ -0,0 +1,135 @@
+#ifndef PLACEMENT_HPP
+#define PLACEMENT_HPP
+
+#include <libvirt/libvirt.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "host_stats.hpp"
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+enum class PlacementPolicy {
+    BinPack,    // fill the busiest host that still fits
+    Spread      // use the least loaded host
+};
+
+struct PlacementConfig {
+    bool enabled = false;               // THOTH_PLACEMENT is set
+    PlacementPolicy policy = PlacementPolicy::Spread;
+    double cpuOvercommit = 16.0;        // vCPUs per host CPU
+    double memoryOvercommit = 1.5;      // guest memory per byte of host memory
+    bool ownerAntiAffinity = true;      // prefer hosts without the owner's VMs
+
+    // THOTH_PLACEMENT, e.g. "policy=binpack,cpu_ratio=8,ram_ratio=1,anti_affinity=0".
+    // Placement stays off while it is unset; an empty value keeps the defaults.
+    static PlacementConfig fromEnvironment();
+};
+
+struct PlacementRequest {
+    std::string owner;
+    unsigned int vcpus = 0;
+    unsigned long long memoryBytes = 0;
+    unsigned long long diskBytes = 0;
+
+    // From a deploy body: vcpus, memory in MB, disk in GB (plus 1 GB headroom)
+    static PlacementRequest fromDeployBody(const json& body);
+};
+
+// Capacity-checked placement of each deployment on the primary host or
+// one of the HostRegistry hosts. Host state is refreshed in the
+// background every REFRESH_INTERVAL_MS, so a decision only walks the
+// cached hosts.
+//
+// The primary host's VMs reach UsageTracker through the inventory. For
+// the other hosts the refresh does it: every VM it finds there is
+// counted for its owner and recorded in HostRegistry, so per-VM requests
+// go to that host.
+//
+// Each placed VM is reserved on its host until a refresh sees the
+// domain, so a burst of deploys between two refreshes does not pile
+// onto the same host.
+class PlacementEngine {
+public:
+    static constexpr int REFRESH_INTERVAL_MS = 15000;
+    static constexpr long long REFRESH_TIMEOUT_MS = 5000;
+
+    static PlacementEngine& instance();
+
+    // Measures every host once, then keeps refreshing in the background
+    void start(virConnectPtr localConnection, const PlacementConfig& config);
+    void stop();
+
+    bool isRunning() const { return running; }
+
+    // Index of the best host in `hosts` for `request`, or -1 with the
+    // reason in `error` when none has room. Touches nothing but its arguments.
+    static int choose(const std::vector<HostState>& hosts, const PlacementRequest& request,
+                      const PlacementConfig& config, std::string& error);
+
+    // Pick a host for VM `vmName` and reserve the request on it
+    bool place(const std::string& vmName, const PlacementRequest& request,
+               std::string& host, std::string& error);
+
+    // Deploy of `vmName` ended. A failed one gives its reservation back;
+    // a successful one keeps it until the next refresh measures the VM.
+    void finish(const std::string& vmName, bool deployed);
+
+    // What reserve() took from a host: free memory and disk stop at
+    // zero, so release() gives back exactly this rather than the request
+    struct Held {
+        unsigned long long freeMemoryBytes = 0;
+        long long diskBytes = 0;
+    };
+
+    // Count `request` on `host`, or take it off again. Touch nothing but
+    // their arguments.
+    static Held reserve(HostState& host, const PlacementRequest& request);
+    static void release(HostState& host, const PlacementRequest& request, const Held& held);
+
+    json status() const;
+
+private:
+    struct Reservation {
+        std::string host;
+        PlacementRequest request;
+        long long settledAt = 0;    // ms the deploy finished, 0 while running
+        bool counted = true;        // included in its host's state
+        Held held;                  // what counting it took, while counted
+    };
+
+    PlacementEngine() = default;
+    PlacementEngine(const PlacementEngine&) = delete;
+    PlacementEngine& operator=(const PlacementEngine&) = delete;
+
+    void run();
+    void refresh();
+
+    // Feeds the VMs a refresh found on an additional host to UsageTracker
+    // and HostRegistry
+    void trackHostVMs(const std::string& host, const json& vms);
+
+    virConnectPtr conn = nullptr;
+    PlacementConfig config;
+
+    mutable std::mutex mutex;
+    std::vector<HostState> hosts;
+    std::unordered_map<std::string, Reservation> reservations;  // by VM name
+    std::unordered_map<std::string, HostStats::CpuCounters> cpuCounters;   // by host
+    std::unordered_map<std::string, std::unordered_set<std::string>> hostVMs;  // last seen, by host
+    size_t placed = 0;
+    size_t rejected = 0;
+
+    std::condition_variable wake;
+    std::atomic<bool> running{false};
+    std::thread refresher;
+};
+
+#endif // PLACEMENT_HPP
@@ -0,0 +1,82 @@
+#ifndef PREFLIGHT_HPP
+#define PREFLIGHT_HPP
+
+#include <libvirt/libvirt.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+namespace RemoteExec {
+
+class RemoteExecutor;
+
+struct PreflightRequest {
+    std::vector<std::string> directories;   // must exist
+    std::vector<std::string> tools;         // must be on PATH
+    std::string baseImage;                  // must exist and pass qemu-img info
+    std::string spacePath;                  // filesystem to report free space for
+};
+
+struct PreflightResult {
+    bool completed = false;                 // false if the script itself could not run
+    std::string error;
+    std::vector<std::string> missingDirectories;
+    std::vector<std::string> missingTools;
+    bool baseImageExists = false;
+    bool baseImageValid = false;
+    long long availableBytes = -1;          // -1 when unknown
+    bool cached = false;                    // static checks came from the cache
+
+    bool passed() const {
+        return completed && missingDirectories.empty() && missingTools.empty() &&
+               baseImageExists && baseImageValid;
+    }
+    json toJson() const;
+};
+
+// Runs every deploy precondition on the target host in one round trip.
+// Directories, tools and the base image rarely change, so their results
+// are cached per host for CACHE_TTL_MS; free space is always measured.
+class PreflightChecker {
+public:
+    static constexpr long long CACHE_TTL_MS = 5 * 60 * 1000;
+
+    static PreflightChecker& instance();
+
+    PreflightResult run(const RemoteExecutor& executor, const PreflightRequest& request);
+
+    // Forget cached results for a host (e.g. after a failed deploy step)
+    void invalidate(const RemoteExecutor& executor);
+
+private:
+    PreflightChecker() = default;
+    PreflightChecker(const PreflightChecker&) = delete;
+    PreflightChecker& operator=(const PreflightChecker&) = delete;
+
+    struct CacheEntry {
+        std::string requestKey;
+        PreflightResult result;
+        long long checkedAt = 0;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, CacheEntry> cache;   // by host
+};
+
+// Base cloud image every deployment starts from, on the target host
+constexpr const char* DEPLOY_BASE_IMAGE =
+    "/var/lib/libvirt/images/baseimg/ubuntu-22.04-server-cloudimg-amd64.img";
+
+// Everything a deployment needs on the target host: directories, tools,
+// a valid base image and `requiredBytes` of free disk space. Prints what
+// is missing and how to fix it.
+bool checkDeployTarget(virConnectPtr conn, const RemoteExecutor& executor, long long requiredBytes);
+
+} // namespace RemoteExec
+
+#endif // PREFLIGHT_HPP
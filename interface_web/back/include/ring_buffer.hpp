@@ -0,0 +1,39 @@
+#ifndef RING_BUFFER_HPP
+#define RING_BUFFER_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Fixed-capacity circular buffer; pushing into a full buffer overwrites
+// the oldest element. Slots are reused, so steady-state pushes of types
+// holding vectors/strings do not allocate once capacity has been reached.
+template <typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t capacity = 0) : slots(capacity) {}
+
+    void push(const T& value) {
+        if (slots.empty()) return;
+        slots[head] = value;
+        head = (head + 1) % slots.size();
+        if (count < slots.size()) count++;
+    }
+
+    // Index 0 is the oldest element
+    const T& at(size_t index) const {
+        return slots[(head + slots.size() - count + index) % slots.size()];
+    }
+
+    const T& back() const { return at(count - 1); }
+
+    size_t size() const { return count; }
+    size_t capacity() const { return slots.size(); }
+    bool empty() const { return count == 0; }
+
+private:
+    std::vector<T> slots;
+    size_t head = 0;
+    size_t count = 0;
+};
+
+#endif // RING_BUFFER_HPP
@@ -0,0 +1,87 @@
+#ifndef SSH_SESSION_HPP
+#define SSH_SESSION_HPP
+
+#include <libvirt/libvirt.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace RemoteExec {
+
+struct SSHTarget {
+    std::string user;
+    std::string host;
+    std::string keyFile;    // empty: let ssh pick its defaults
+
+    std::string key() const { return user + "@" + host; }
+};
+
+// Fill `target` from a qemu+ssh:// connection URI. Returns false for
+// local connections.
+bool resolveTarget(virConnectPtr conn, SSHTarget& target);
+
+// First existing key among the usual ~/.ssh locations, or empty
+std::string findDefaultSSHKey();
+
+// Write `data` to `path` on the connection's host in a single transfer
+// (streamed over the shared SSH session for remote hosts). The file is
+// written next to its destination and renamed into place.
+bool uploadFile(virConnectPtr conn, const std::string& path, const std::string& data,
+                std::string& error);
+
+// Keeps one multiplexed OpenSSH connection (ControlMaster) per target
+// host. The master is started in the background on first use, and every
+// command from any RemoteExecutor then only opens a channel on it, so
+// commands no longer pay for a TCP connect and key exchange each. If
+// the master is unavailable commands silently use direct connections.
+class SSHSession {
+public:
+    // Idle time after which ssh tears a master connection down by itself
+    static constexpr int PERSIST_SECONDS = 600;
+
+    static SSHSession& instance();
+
+    // Full local command line running `command` on the target
+    std::string buildCommand(const SSHTarget& target, const std::string& command);
+
+    // Run `command` on the target with `input` as its stdin. Returns the
+    // exit code (-1 if ssh could not be started); stdout and stderr go to `output`.
+    int runWithInput(const SSHTarget& target, const std::string& command,
+                     const std::string& input, std::string& output);
+
+    // True if a master connection to the target is currently up
+    bool isConnected(const SSHTarget& target) const;
+
+    // Close every master connection opened by this process
+    void closeAll();
+
+    bool multiplexingEnabled() const { return !controlDir.empty(); }
+
+    // Quote a string for a POSIX shell
+    static std::string shellQuote(const std::string& value);
+
+private:
+    SSHSession();
+    SSHSession(const SSHSession&) = delete;
+    SSHSession& operator=(const SSHSession&) = delete;
+
+    struct TargetState {
+        SSHTarget target;
+        bool masterStarted = false;
+        std::chrono::steady_clock::time_point lastUsed;
+    };
+
+    std::string baseOptions(const SSHTarget& target) const;
+    void ensureMaster(const SSHTarget& target);
+    bool startMaster(const SSHTarget& target) const;
+
+    std::string controlDir;   // empty when multiplexing is unavailable
+    mutable std::mutex mutex;
+    std::mutex connectMutex;  // one master start at a time
+    std::unordered_map<std::string, TargetState> targets;
+};
+
+} // namespace RemoteExec
+
+#endif // SSH_SESSION_HPP
@@ -0,0 +1,53 @@
+#ifndef STATS_SAMPLER_HPP
+#define STATS_SAMPLER_HPP
+
+#include <libvirt/libvirt.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "stats_store.hpp"
+
+// Collects stats for every running domain at a fixed interval into
+// StatsStore, so HTTP handlers never query libvirt for stats.
+class StatsSampler {
+public:
+    static constexpr int DEFAULT_INTERVAL_MS = 2000;
+
+    StatsSampler(virConnectPtr connection,
+                 int intervalMs = DEFAULT_INTERVAL_MS,
+                 size_t historySize = StatsStore::DEFAULT_HISTORY_SIZE);
+    ~StatsSampler();
+
+    bool start();
+    void stop();
+
+    int getIntervalMs() const { return intervalMs; }
+
+    // Only while stopped, e.g. after the shared connection was reopened
+    void setConnection(virConnectPtr connection) { conn = connection; }
+
+    // Called on the sampler thread after each successful tick.
+    // Must be set before start().
+    void setOnSampled(std::function<void()> callback) { onSampled = std::move(callback); }
+
+    // Take one sample of all running domains right now
+    bool sampleOnce();
+
+private:
+    void run();
+
+    virConnectPtr conn;
+    int intervalMs;
+    size_t historySize;
+    std::function<void()> onSampled;
+
+    std::atomic<bool> running{false};
+    std::thread worker;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCv;
+};
+
+#endif // STATS_SAMPLER_HPP
@@ -0,0 +1,92 @@
+#ifndef STATS_STORE_HPP
+#define STATS_STORE_HPP
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "domain_stats.hpp"
+#include "ring_buffer.hpp"
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+struct DiskPoint {
+    std::string name;
+    unsigned long long readBytes = 0;
+    unsigned long long writeBytes = 0;
+};
+
+struct NicPoint {
+    std::string name;
+    unsigned long long rxBytes = 0;
+    unsigned long long txBytes = 0;
+};
+
+struct StatsPoint {
+    long long timestamp = 0;          // ms
+    double cpuPercent = 0.0;          // % of one host CPU since the previous point
+    unsigned long long memoryUsed = 0;  // KiB
+    unsigned long long memoryMax = 0;   // KiB
+    std::vector<DiskPoint> disks;
+    std::vector<NicPoint> nics;
+};
+
+// Per-VM time series shared by the sampler (single writer) and every
+// HTTP worker thread (readers). Entries are spread over independently
+// locked shards so readers of different VMs never contend, and readers
+// only take a shared lock.
+class StatsStore {
+public:
+    static constexpr size_t SHARD_COUNT = 16;
+    static constexpr size_t DEFAULT_HISTORY_SIZE = 1800;
+
+    static StatsStore& instance();
+
+    // Points kept per VM; applies to series created afterwards
+    void setHistoryCapacity(size_t capacity) { historyCapacity = capacity; }
+    size_t getHistoryCapacity() const { return historyCapacity; }
+
+    // Append a sample, computing CPU usage against the VM's previous point
+    void record(const DomainStats::DomainSample& sample);
+
+    bool latest(const std::string& vmName, StatsPoint& out) const;
+    std::vector<StatsPoint> history(const std::string& vmName, long long sinceMs) const;
+
+    // Newest point of every VM. `visit` runs under a shard's shared lock
+    // and must not call back into the store.
+    void forEachLatest(const std::function<void(const std::string&, const StatsPoint&)>& visit) const;
+
+    void remove(const std::string& vmName);
+
+    // Drop series whose newest point is older than cutoffMs
+    void pruneOlderThan(long long cutoffMs);
+
+    size_t size() const;
+
+private:
+    struct Series {
+        RingBuffer<StatsPoint> points;
+        unsigned long long lastCpuTime = 0;
+    };
+
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<std::string, Series> series;
+    };
+
+    Shard& shardFor(const std::string& vmName);
+    const Shard& shardFor(const std::string& vmName) const;
+
+    std::array<Shard, SHARD_COUNT> shards;
+    size_t historyCapacity = DEFAULT_HISTORY_SIZE;
+};
+
+// JSON shape served by /api/vms/:name/stats
+json statsToJson(const StatsPoint& point);
+
+#endif // STATS_STORE_HPP
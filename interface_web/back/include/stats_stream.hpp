@@ -0,0 +1,63 @@
+#ifndef STATS_STREAM_HPP
+#define STATS_STREAM_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "httplib.h"
+
+// Fan-out point between the stats sampler (single producer) and any
+// number of Server-Sent Events subscribers. Each VM's payload is
+// rendered once per sampler tick and shared by every subscriber.
+class StatsBroadcaster {
+public:
+    // Streams beyond this are refused so they cannot starve the API workers
+    static constexpr size_t MAX_SUBSCRIBERS = 64;
+
+    // Comment line sent when nothing was published for this long, which
+    // also detects clients that went away
+    static constexpr std::chrono::seconds HEARTBEAT_INTERVAL{15};
+
+    static StatsBroadcaster& instance();
+
+    // Called by the sampler after every tick
+    void publish();
+
+    // Block until a generation newer than `seen` is published, the
+    // timeout expires or shutdown() is called. Returns the current generation.
+    uint64_t waitForUpdate(uint64_t seen, std::chrono::milliseconds timeout);
+    uint64_t currentGeneration();
+
+    // JSON payload for one VM at the current generation ("null" if not sampled)
+    std::string renderVM(const std::string& vmName);
+
+    bool tryAddSubscriber();
+    void removeSubscriber();
+    size_t subscriberCount() const { return subscribers; }
+
+    bool isClosed() const { return closed; }
+    void shutdown();
+
+private:
+    StatsBroadcaster() = default;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint64_t generation = 0;
+    std::atomic<bool> closed{false};
+    std::atomic<size_t> subscribers{0};
+
+    std::mutex renderMutex;
+    uint64_t renderedGeneration = 0;
+    std::unordered_map<std::string, std::string> rendered;
+};
+
+// Register GET /api/stream/stats?vms=a,b,c
+void setupStatsStream(httplib::Server& svr);
+
+#endif // STATS_STREAM_HPP
@@ -0,0 +1,54 @@
+#ifndef STORAGE_BACKEND_HPP
+#define STORAGE_BACKEND_HPP
+
+#include <libvirt/libvirt.h>
+#include <string>
+
+// Disk provisioning through libvirt storage pools, so image creation,
+// space checks and deletion go over the existing libvirt connection
+// instead of per-step ssh processes. Directories that are not covered
+// by a pool yet get a transient 'dir' pool when a disk is provisioned
+// there; lookups, space checks and deletion only use existing pools.
+class StorageBackend {
+public:
+    explicit StorageBackend(virConnectPtr connection);
+
+    // Free bytes on the pool holding `dir`, -1 if unknown
+    long long availableBytes(const std::string& dir);
+
+    // qcow2 volume `name` in `dir` backed by `backingPath`, `capacity` bytes large
+    bool createOverlay(const std::string& dir, const std::string& name,
+                       unsigned long long capacity, const std::string& backingPath,
+                       std::string& error);
+
+    // Full qcow2 copy of `sourcePath` as `name` in `dir`, grown to `capacity` bytes
+    bool cloneImage(const std::string& dir, const std::string& name,
+                    const std::string& sourcePath, unsigned long long capacity,
+                    std::string& error);
+
+    // Virtual size of the volume at `path` in bytes, -1 if no pool has it
+    long long volumeCapacity(const std::string& path);
+
+    // Delete the volume at `path`. `managed` is set to false when no
+    // pool can reach the path, in which case nothing was attempted.
+    bool deleteVolume(const std::string& path, bool& managed, std::string& error);
+
+    // Delete the block device at `path` through the pool that provides
+    // it, such as a logical pool. `managed` is false, and nothing is
+    // attempted, unless such a pool already lists the device.
+    bool deleteDeviceVolume(const std::string& path, bool& managed, std::string& error);
+
+private:
+    // Active pool whose target is `dir` (caller frees), or nullptr. With
+    // `create`, a transient pool is defined when none covers `dir` yet.
+    virStoragePoolPtr poolForDirectory(const std::string& dir, bool create);
+    virStoragePoolPtr findPool(const std::string& dir);
+    virStoragePoolPtr createTransientPool(const std::string& dir);
+
+    // Volume at `path`, refreshing its pool once if libvirt has not seen it yet
+    virStorageVolPtr lookupVolume(const std::string& path);
+
+    virConnectPtr conn;
+};
+
+#endif // STORAGE_BACKEND_HPP
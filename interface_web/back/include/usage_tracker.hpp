@@ -0,0 +1,60 @@
+#ifndef USAGE_TRACKER_HPP
+#define USAGE_TRACKER_HPP
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct DomainEntry;
+
+struct ResourceUsage {
+    int vms = 0;
+    int cpu = 0;                 // vCPUs
+    long long ram = 0;           // MB
+    long long storage = 0;       // bytes, virtual size of the disks
+};
+
+// Per-owner totals of what their domains hold. DomainInventory feeds
+// every change of a domain entry (define, undefine, hotplug, balloon)
+// through update(), which swaps that domain's old contribution for its
+// new one, so quota checks read the totals without touching libvirt.
+//
+// Deploys that are queued or running have no domain yet; they hold a
+// reservation from submission until their job ends, so requests posted
+// back to back cannot all fit in the same headroom.
+class UsageTracker {
+public:
+    static UsageTracker& instance();
+
+    // `entry` is the domain's new state, nullptr once it is gone
+    void update(const std::string& name, const DomainEntry* entry);
+
+    ResourceUsage get(const std::string& owner) const;
+
+    // Hold `usage` for VM `name` of `owner` until release(name)
+    void reserve(const std::string& name, const std::string& owner, const ResourceUsage& usage);
+    void release(const std::string& name);
+
+    // What the owner's queued and running deploys hold
+    ResourceUsage reserved(const std::string& owner) const;
+
+    void clear();
+
+private:
+    UsageTracker() = default;
+    UsageTracker(const UsageTracker&) = delete;
+    UsageTracker& operator=(const UsageTracker&) = delete;
+
+    struct Contribution {
+        std::string owner;
+        ResourceUsage usage;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Contribution> byDomain;
+    std::unordered_map<std::string, ResourceUsage> byOwner;
+    std::unordered_map<std::string, Contribution> reservations;     // by VM name
+    std::unordered_map<std::string, ResourceUsage> reservedByOwner;
+};
+
+#endif // USAGE_TRACKER_HPP
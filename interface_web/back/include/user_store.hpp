@@ -0,0 +1,86 @@
+#ifndef USER_STORE_HPP
+#define USER_STORE_HPP
+
+#include <functional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+// Process-wide user records, indexed by username and kept in memory so
+// reads never touch disk.
+//
+// Persistence is users.json (a snapshot, same format as before) plus an
+// append-only journal next to it with one JSON record per line: a whole
+// user object per write, or a delete. Loading replays the journal over
+// the snapshot. Once the journal is long enough it is compacted: a new
+// snapshot is written to a temporary file, synced and renamed over the
+// old one, then the journal is truncated. Replaying records that are
+// already in the snapshot is harmless, so a crash at any point loses at
+// most the record being written.
+class UserStore {
+public:
+    static constexpr const char* DEFAULT_PATH = "/var/lib/thoth-cloud/users.json";
+    static constexpr size_t COMPACT_AFTER_RECORDS = 256;
+
+    static UserStore& instance();
+
+    // Load the snapshot and journal; later calls are no-ops
+    bool open(const std::string& snapshotPath = DEFAULT_PATH);
+
+    // Compact and close the journal
+    void close();
+
+    bool get(const std::string& username, json& user) const;
+    bool exists(const std::string& username) const;
+
+    // Every user, in creation order
+    json list() const;
+    std::vector<std::string> usernames() const;
+
+    // Add a user, assigning its "id". Fails if the username is taken.
+    bool insert(json& user, std::string& error);
+
+    // Apply `mutate` to the user and persist the result, returned in `updated`
+    bool update(const std::string& username, const std::function<void(json&)>& mutate,
+                json& updated, std::string& error);
+
+    bool remove(const std::string& username, std::string& error);
+
+    // Last measured usage; derived from the VMs, so kept in memory only.
+    // get() and list() return it in place of the stored "usage".
+    void setUsage(const std::string& username, const json& measured);
+
+    bool compact();
+
+private:
+    UserStore() = default;
+    UserStore(const UserStore&) = delete;
+    UserStore& operator=(const UserStore&) = delete;
+
+    // Callers hold the lock exclusively
+    bool appendRecord(const json& record, std::string& error);
+    void compactIfDue();     // after the record is applied in memory
+    bool writeSnapshot();
+    bool applyRecord(const json& record);
+    void put(const json& user);
+    json withUsage(const json& user) const;
+
+    mutable std::shared_mutex mutex;
+    std::unordered_map<std::string, json> users;
+    std::vector<std::string> order;     // usernames in creation order
+    std::unordered_map<std::string, json> usage;    // never journaled
+    long long nextId = 1;
+
+    bool loaded = false;
+    std::string snapshotPath;
+    std::string journalPath;
+    int journalFd = -1;
+    size_t journalRecords = 0;
+};
+
+#endif // USER_STORE_HPP
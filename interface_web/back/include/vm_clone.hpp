@@ -0,0 +1,86 @@
+#ifndef VM_CLONE_HPP
+#define VM_CLONE_HPP
+
+#include <libvirt/libvirt.h>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ssh_session.hpp"
+
+struct DomainModel;
+
+enum class CloneMode {
+    // Copy every writable disk; the source must be shut off
+    Full,
+    // Freeze the source's disks with an external snapshot and give the
+    // clone qcow2 overlays on them. Instant, and works on running VMs.
+    Linked
+};
+
+// "full" or "linked"
+bool parseCloneMode(const std::string& value, CloneMode& mode);
+const char* cloneModeName(CloneMode mode);
+
+// Disk images are named after their VM ("<vm>.qcow2", "<vm>-cloudinit.iso");
+// anything else gets "<clone>-<dev>" with the original extension
+std::string clonePathFor(const std::string& path, const std::string& source,
+                         const std::string& cloneName, const std::string& targetDev);
+
+// New top image the source continues on after its disk is frozen
+std::string frozenTopPath(const std::string& path, long long stamp);
+
+// Definition for the clone: new name, no UUID or MACs (libvirt generates
+// them), and the disk paths (old, new) swapped for the clone's images
+std::string buildCloneXML(std::string xml, const std::string& source, const std::string& cloneName,
+                          const std::vector<std::pair<std::string, std::string>>& paths);
+
+// Defines a copy of a domain under a new name. Runs inside a "clone"
+// job when there is one: steps and copy progress are reported to it.
+//
+// Full copies run in parallel, one thread per disk. On the local host
+// each copy tries a reflink first and otherwise copies only the
+// allocated extents; remote hosts use cp --reflink=auto --sparse=always.
+//
+// Linked clones leave the source running on a new top image: its frozen
+// images now back both VMs and are not removed with either of them.
+class CloneOperations {
+public:
+    static constexpr size_t MAX_PARALLEL_COPIES = 4;
+
+    explicit CloneOperations(virConnectPtr connection);
+
+    bool clone(const std::string& source, const std::string& cloneName,
+               CloneMode mode, std::string& error);
+
+private:
+    struct DiskPlan {
+        std::string targetDev;
+        std::string format;       // driver type, e.g. "qcow2"
+        std::string sourcePath;   // image the clone's disk is made from
+        std::string clonePath;
+        bool overlay = false;     // linked: overlay on the frozen image instead of a copy
+        bool created = false;     // clonePath was written and must go on failure
+    };
+
+    bool planDisks(const DomainModel& model, const std::string& source,
+                   const std::string& cloneName, CloneMode mode,
+                   std::vector<DiskPlan>& plans, std::string& error);
+
+    // External disk-only snapshot moving the source onto new top images
+    bool freezeSource(virDomainPtr domain, const DomainModel& model,
+                      const std::vector<DiskPlan>& plans, std::string& error);
+
+    bool createOverlays(std::vector<DiskPlan>& plans, std::string& error);
+    bool copyDisks(std::vector<DiskPlan>& plans, std::string& error);
+    bool copyDisk(const DiskPlan& plan, std::atomic<long long>& copied, std::string& error);
+    void removeCreated(const std::vector<DiskPlan>& plans);
+
+    virConnectPtr conn;
+    RemoteExec::SSHTarget target;
+    bool remote;
+};
+
+#endif // VM_CLONE_HPP
@@ -0,0 +1,109 @@
+#ifndef WARM_POOL_HPP
+#define WARM_POOL_HPP
+
+#include <libvirt/libvirt.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "json.hpp"
+
+using json = nlohmann::json;
+
+// A VM size kept ready in the pool; matched exactly against deploy requests
+struct WarmFlavor {
+    std::string name;        // "small", "medium", ...
+    int memory = 0;          // MB
+    int vcpus = 0;
+    int disk = 0;            // GB
+    size_t target = 0;       // VMs to keep ready, 0 disables the flavor
+};
+
+// Keeps a few already-booted VMs per flavor so deployments skip define,
+// first boot, the package update and the cloud-init reboot.
+//
+// Warm VMs are deployed normally with cloud-init powering them off once
+// first boot is done, and are kept shut off: libvirt only renames
+// inactive domains without a managed save image, so neither paused nor
+// managed-saved VMs could be handed over under the user's name.
+// Claiming renames the domain, swaps its NoCloud seed for one with a new
+// instance-id and the user's credentials, and starts it; cloud-init then
+// only runs its per-instance modules, which takes seconds.
+class WarmPool {
+public:
+    static constexpr const char* NAME_PREFIX = "warm-";
+    static constexpr const char* OWNER = "warm";
+    static constexpr const char* WARM_USERNAME = "thoth-warm";
+
+    // Provisioning VMs that have not powered off by then are discarded
+    static constexpr long long PROVISION_TIMEOUT_MS = 15LL * 60 * 1000;
+    static constexpr int REFILL_INTERVAL_SECONDS = 30;
+    static constexpr size_t MAX_CONCURRENT_PROVISIONING = 2;
+
+    static WarmPool& instance();
+
+    // Flavors match the frontend presets; targets come from
+    // THOTH_WARM_POOL, e.g. "small=2,medium=1". Unset means no pool.
+    static std::vector<WarmFlavor> flavorsFromEnvironment();
+
+    // Adopts warm VMs left by a previous run, then refills in the background
+    void start(virConnectPtr connection, std::vector<WarmFlavor> flavors);
+    void stop();
+
+    bool isEnabled() const;
+
+    // Hand a ready VM over to a deploy request (same parameters deployVM
+    // takes). Returns false when nothing matches, so the caller falls
+    // back to a regular deployment.
+    bool claim(const json& vmParams);
+
+    json status() const;
+
+private:
+    enum class WarmState { Provisioning, Ready, Claimed };
+
+    struct WarmVM {
+        std::string name;
+        std::string flavor;
+        WarmState state = WarmState::Provisioning;
+        long long createdAt = 0;     // ms
+    };
+
+    WarmPool() = default;
+    WarmPool(const WarmPool&) = delete;
+    WarmPool& operator=(const WarmPool&) = delete;
+
+    void run();
+    void wake();
+    void adoptExisting();
+    void updateProvisioning();
+    void refill();
+    bool provision(const WarmFlavor& flavor);
+    void discard(const std::string& name);
+    bool handOver(const std::string& warmName, const json& vmParams);
+
+    const WarmFlavor* findFlavor(int memory, int vcpus, int disk) const;
+    size_t countFlavor(const std::string& flavor, WarmState state) const;
+
+    static std::string seedPath(const std::string& name);
+
+    virConnectPtr conn = nullptr;
+    std::vector<WarmFlavor> flavors;
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, WarmVM> vms;
+    size_t claimed = 0;          // lifetime counters for status()
+    size_t missed = 0;
+
+    std::atomic<bool> running{false};
+    std::thread worker;
+    std::mutex wakeMutex;
+    std::condition_variable wakeCv;
+    bool wakeRequested = false;  // refill now, e.g. after a claim
+};
+
+#endif // WARM_POOL_HPP
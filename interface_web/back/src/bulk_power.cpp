@@ -0,0 +1,109 @@
+#include "../include/bulk_power.hpp"
+#include "../include/vm_operations.hpp"
+#include "../include/utils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+
+namespace BulkPower {
+
+namespace {
+
+bool apply(VMOperations* ops, const std::string& action, const std::string& name) {
+    if (action == "start") return ops->startVM(name);
+    if (action == "shutdown") return ops->shutdownVM(name);
+    if (action == "destroy") return ops->destroyVM(name);
+    if (action == "reboot") return ops->rebootVM(name);
+    if (action == "pause") return ops->pauseVM(name);
+    if (action == "resume") return ops->resumeVM(name);
+    return false;
+}
+
+// Nearest-rank percentile of sorted durations
+long long percentile(const std::vector<long long>& sorted, int pct) {
+    if (sorted.empty()) return 0;
+    size_t rank = (sorted.size() * pct + 99) / 100;
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+} // namespace
+
+bool isSupportedAction(const std::string& action) {
+    return action == "start" || action == "shutdown" || action == "destroy" ||
+           action == "reboot" || action == "pause" || action == "resume";
+}
+
+json run(const std::vector<VMOperations*>& ops, const std::string& action,
+         const std::vector<std::string>& names, size_t concurrency) {
+    struct Outcome {
+        bool success = false;
+        long long durationMs = 0;
+    };
+    std::vector<Outcome> outcomes(names.size());
+
+    long long started = getCurrentTimeMs();
+
+    // Workers pull the next VM index until the list is exhausted
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < names.size(); i = next++) {
+            long long begin = getCurrentTimeMs();
+            outcomes[i].success = apply(ops[i], action, names[i]);
+            outcomes[i].durationMs = getCurrentTimeMs() - begin;
+        }
+    };
+
+    size_t threadCount = std::min(std::max<size_t>(concurrency, 1), names.size());
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; t++) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    long long wallMs = getCurrentTimeMs() - started;
+
+    json results = json::array();
+    std::vector<long long> durations;
+    size_t succeeded = 0;
+
+    for (size_t i = 0; i < names.size(); i++) {
+        json entry = {
+            {"name", names[i]},
+            {"success", outcomes[i].success},
+            {"durationMs", outcomes[i].durationMs}
+        };
+        if (outcomes[i].success) {
+            succeeded++;
+        } else {
+            entry["error"] = "Failed to " + action + " domain";
+        }
+        results.push_back(entry);
+        durations.push_back(outcomes[i].durationMs);
+    }
+
+    std::sort(durations.begin(), durations.end());
+
+    json summary = {
+        {"action", action},
+        {"total", names.size()},
+        {"succeeded", succeeded},
+        {"failed", names.size() - succeeded},
+        {"concurrency", threadCount},
+        {"wallMs", wallMs},
+        {"minMs", durations.empty() ? 0 : durations.front()},
+        {"p50Ms", percentile(durations, 50)},
+        {"p95Ms", percentile(durations, 95)},
+        {"maxMs", durations.empty() ? 0 : durations.back()}
+    };
+
+    fprintf(stdout, "Bulk %s: %zu/%zu succeeded in %lld ms\n", action.c_str(),
+            succeeded, names.size(), wallMs);
+
+    return {{"results", results}, {"summary", summary}};
+}
+
+} // namespace BulkPower
@@ -0,0 +1,67 @@
+#include "../include/cloud_init_config.hpp"
+
+#include <sstream>
+
+namespace CloudInit {
+
+std::string buildMetaData(const std::string& instanceId, const std::string& localHostname) {
+    std::stringstream metaData;
+    metaData << "instance-id: " << instanceId << "\n"
+             << "local-hostname: " << localHostname << "\n";
+    return metaData.str();
+}
+
+std::string buildUserData(const UserDataOptions& options) {
+    std::stringstream userData;
+    userData << "#cloud-config\n"
+             << "hostname: " << options.hostname << "\n"
+             << "fqdn: " << options.fqdn << "\n"
+             << "manage_etc_hosts: true\n\n"
+             << "users:\n"
+             << "  - name: " << options.username << "\n"
+             << "    sudo: ALL=(ALL) NOPASSWD:ALL\n"
+             << "    groups: users, admin\n"
+             << "    shell: /bin/bash\n";
+
+    if (options.authMethod == "password" && !options.passwordHash.empty()) {
+        userData << "    passwd: " << options.passwordHash << "\n"
+                 << "    lock_passwd: false\n";
+    } else if (options.authMethod == "ssh-key" && !options.sshKey.empty()) {
+        userData << "    ssh_authorized_keys:\n"
+                 << "      - " << options.sshKey << "\n";
+    }
+
+    userData << "\n"
+             << "ssh_pwauth: " << (options.authMethod == "password" ? "true" : "false") << "\n"
+             << "disable_root: false\n"
+             << "chpasswd:\n"
+             << "  expire: false\n\n";
+
+    if (options.installPackages) {
+        userData << "package_update: true\n"
+                 << "package_upgrade: false\n\n"
+                 << "packages:\n"
+                 << "  - qemu-guest-agent\n"
+                 << "  - cloud-init\n\n";
+    }
+
+    userData << "runcmd:\n"
+             << "  - systemctl enable qemu-guest-agent\n"
+             << "  - systemctl start qemu-guest-agent\n";
+    for (const auto& command : options.extraCommands) {
+        userData << "  - " << command << "\n";
+    }
+    userData << "  - echo 'Cloud-init setup complete' > /var/log/cloudinit-done\n";
+
+    if (!options.powerState.empty()) {
+        userData << "\n"
+                 << "power_state:\n"
+                 << "  mode: " << options.powerState << "\n"
+                 << "  timeout: 30\n"
+                 << "  condition: true\n";
+    }
+
+    return userData.str();
+}
+
+} // namespace CloudInit
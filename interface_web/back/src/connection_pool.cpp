@@ -0,0 +1,452 @@
+#include "../include/connection_pool.hpp"
+#include "../include/utils.hpp"
+#include "../include/event_loop.hpp"
+#include "../include/metrics.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <libvirt/virterror.h>
+
+namespace {
+
+std::string lastError() {
+    virErrorPtr err = virGetLastError();
+    return err && err->message ? err->message : "unknown libvirt error";
+}
+
+const char* closeReason(int reason) {
+    switch (reason) {
+        case VIR_CONNECT_CLOSE_REASON_ERROR: return "I/O error";
+        case VIR_CONNECT_CLOSE_REASON_EOF: return "end of file";
+        case VIR_CONNECT_CLOSE_REASON_KEEPALIVE: return "keepalive timeout";
+        case VIR_CONNECT_CLOSE_REASON_CLIENT: return "closed by client";
+        default: return "unknown reason";
+    }
+}
+
+// Doubling delay per consecutive failure, with a per-slot offset so the
+// connections of one pool do not all retry in the same instant
+long long backoffMs(int failures, size_t index) {
+    long long delay = ConnectionPool::MIN_BACKOFF_MS << std::min(failures - 1, 6);
+    delay = std::min(delay, ConnectionPool::MAX_BACKOFF_MS);
+    return delay + delay * static_cast<long long>(index % 4) / 8;
+}
+
+} // namespace
+
+// ========================================
+// LEASE
+// ========================================
+
+ConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : pool(other.pool), slot(other.slot), conn(other.conn) {
+    other.pool = nullptr;
+    other.conn = nullptr;
+}
+
+ConnectionPool::Lease& ConnectionPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool = other.pool;
+        slot = other.slot;
+        conn = other.conn;
+        other.pool = nullptr;
+        other.conn = nullptr;
+    }
+    return *this;
+}
+
+ConnectionPool::Lease::~Lease() {
+    release();
+}
+
+void ConnectionPool::Lease::release() {
+    if (pool && conn) {
+        pool->giveBack(slot);
+    }
+    pool = nullptr;
+    conn = nullptr;
+}
+
+// ========================================
+// POOL
+// ========================================
+
+ConnectionPool& ConnectionPool::instance() {
+    static ConnectionPool pool;
+    return pool;
+}
+
+size_t ConnectionPool::sizeFromEnvironment() {
+    const char* value = getenv("THOTH_LIBVIRT_POOL_SIZE");
+    if (!value || !*value) return DEFAULT_SIZE;
+
+    long size = strtol(value, nullptr, 10);
+    return size > 0 ? static_cast<size_t>(size) : 0;
+}
+
+bool ConnectionPool::start(const std::string& connectUri, size_t size) {
+    if (running || size == 0) return running;
+
+    uri = connectUri;
+    slots.clear();
+    for (size_t i = 0; i < size; i++) {
+        slots.push_back(std::make_unique<Slot>());
+        slots.back()->pool = this;
+        slots.back()->state = SlotState::Connecting;
+    }
+
+    running = true;
+
+    // First connections inline, so requests can use them right away
+    for (size_t i = 0; i < size; i++) {
+        reconnect(i);
+    }
+
+    size_t opened = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& slot : slots) {
+            if (slot->state == SlotState::Idle) opened++;
+        }
+    }
+
+    monitor = std::thread(&ConnectionPool::run, this);
+
+    fprintf(stdout, "Libvirt connection pool: %zu/%zu connection(s) to %s\n",
+            opened, size, uri.c_str());
+    return opened > 0;
+}
+
+void ConnectionPool::stop() {
+    if (!running) return;
+
+    running = false;
+    monitorWake.notify_all();
+    available.notify_all();
+    if (monitor.joinable()) {
+        monitor.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& slot : slots) {
+        // Leases still out close their connection when they come back
+        if (slot->state != SlotState::InUse) {
+            closeSlot(*slot);
+            slot->state = SlotState::Broken;
+        }
+    }
+}
+
+ConnectionPool::Lease ConnectionPool::acquire(long long timeoutMs) {
+    if (!running) return Lease();
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    std::vector<virConnectPtr> dead;
+    Lease lease;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (running) {
+            for (size_t i = 0; i < slots.size() && !lease; i++) {
+                Slot& slot = *slots[i];
+                if (slot.state != SlotState::Idle) continue;
+
+                // Keepalive may have noticed the peer is gone in the meantime
+                if (slot.closed || virConnectIsAlive(slot.conn) != 1) {
+                    dead.push_back(slot.conn);
+                    slot.conn = nullptr;
+                    slot.state = SlotState::Broken;
+                    slot.nextAttemptMs = 0;
+                    continue;
+                }
+
+                slot.state = SlotState::InUse;
+                lease = Lease(this, i, slot.conn);
+            }
+            if (lease) break;
+
+            if (available.wait_until(lock, deadline) == std::cv_status::timeout) {
+                exhausted++;
+                break;
+            }
+        }
+    }
+
+    if (!dead.empty()) {
+        monitorWake.notify_all();
+        for (virConnectPtr conn : dead) {
+            virConnectUnregisterCloseCallback(conn, onClose);
+            virConnectClose(conn);
+        }
+    }
+    return lease;
+}
+
+void ConnectionPool::giveBack(size_t index) {
+    virConnectPtr dead = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Slot& slot = *slots[index];
+
+        if (!running || slot.closed || virConnectIsAlive(slot.conn) != 1) {
+            dead = slot.conn;
+            slot.conn = nullptr;
+            slot.state = SlotState::Broken;
+            slot.nextAttemptMs = 0;
+        } else {
+            slot.state = SlotState::Idle;
+        }
+    }
+
+    if (dead) {
+        monitorWake.notify_all();
+        virConnectUnregisterCloseCallback(dead, onClose);
+        virConnectClose(dead);
+    } else {
+        available.notify_one();
+    }
+}
+
+json ConnectionPool::status() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    size_t idle = 0, inUse = 0, down = 0;
+    for (const auto& slot : slots) {
+        switch (slot->state) {
+            case SlotState::Idle: idle++; break;
+            case SlotState::InUse: inUse++; break;
+            default: down++; break;
+        }
+    }
+
+    return {
+        {"enabled", running.load()},
+        {"uri", uri},
+        {"size", slots.size()},
+        {"idle", idle},
+        {"inUse", inUse},
+        {"down", down},
+        {"reconnects", reconnects},
+        {"exhausted", exhausted}
+    };
+}
+
+void ConnectionPool::run() {
+    while (running) {
+        std::vector<size_t> due;
+        std::vector<virConnectPtr> dead;
+        long long now = getCurrentTimeMs();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = 0; i < slots.size(); i++) {
+                Slot& slot = *slots[i];
+
+                // Idle connections are probed here; in-use ones when they come back
+                if (slot.state == SlotState::Idle &&
+                    (slot.closed || virConnectIsAlive(slot.conn) != 1)) {
+                    dead.push_back(slot.conn);
+                    slot.conn = nullptr;
+                    slot.state = SlotState::Broken;
+                    slot.nextAttemptMs = 0;
+                }
+
+                if (slot.state == SlotState::Broken && slot.nextAttemptMs <= now) {
+                    slot.state = SlotState::Connecting;
+                    due.push_back(i);
+                }
+            }
+        }
+
+        for (virConnectPtr conn : dead) {
+            fprintf(stderr, "Libvirt pool: dropping dead connection to %s\n", uri.c_str());
+            virConnectUnregisterCloseCallback(conn, onClose);
+            virConnectClose(conn);
+        }
+        for (size_t index : due) {
+            if (!running) break;
+            reconnect(index);
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        monitorWake.wait_for(lock, std::chrono::milliseconds(MONITOR_INTERVAL_MS));
+    }
+}
+
+// Opens the connection of a slot in the Connecting state, outside the lock
+// (an ssh handshake can take seconds)
+void ConnectionPool::reconnect(size_t index) {
+    Slot& slot = *slots[index];
+
+    virConnectPtr conn;
+    {
+        LibvirtTimer timer(LibvirtCall::ConnectOpen);
+        conn = virConnectOpen(uri.c_str());
+    }
+    std::string error = conn ? "" : lastError();
+
+    if (conn) {
+        // Keepalive is driven by the event loop. Without it the connection
+        // still works, but dead peers are only noticed by the next call.
+        if (LibvirtEvents::isRunning() &&
+            virConnectSetKeepAlive(conn, KEEPALIVE_INTERVAL_SECONDS, KEEPALIVE_COUNT) < 0) {
+            fprintf(stderr, "Libvirt pool: keepalive unavailable: %s\n", lastError().c_str());
+        }
+        slot.closed = false;
+        virConnectRegisterCloseCallback(conn, onClose, &slot, nullptr);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (conn) {
+            if (slot.opened) {
+                fprintf(stdout, "Libvirt pool: reconnected to %s\n", uri.c_str());
+                reconnects++;
+            }
+            slot.opened = true;
+            slot.conn = conn;
+            slot.state = SlotState::Idle;
+            slot.failures = 0;
+        } else {
+            slot.failures++;
+            slot.state = SlotState::Broken;
+            slot.nextAttemptMs = getCurrentTimeMs() + backoffMs(slot.failures, index);
+            fprintf(stderr, "Libvirt pool: cannot connect to %s (attempt %d, retrying in %lld ms): %s\n",
+                    uri.c_str(), slot.failures, slot.nextAttemptMs - getCurrentTimeMs(), error.c_str());
+        }
+    }
+
+    if (conn) available.notify_one();
+}
+
+void ConnectionPool::closeSlot(Slot& slot) {
+    if (!slot.conn) return;
+    virConnectUnregisterCloseCallback(slot.conn, onClose);
+    virConnectClose(slot.conn);
+    slot.conn = nullptr;
+}
+
+// Runs on the event loop thread
+void ConnectionPool::onClose(virConnectPtr, int reason, void* opaque) {
+    auto* slot = static_cast<Slot*>(opaque);
+    slot->closed = true;
+    fprintf(stderr, "Libvirt pool: connection to %s closed (%s)\n",
+            slot->pool->uri.c_str(), closeReason(reason));
+    slot->pool->monitorWake.notify_all();
+}
+
+// ========================================
+// SHARED CONNECTION
+// ========================================
+
+SharedConnection& SharedConnection::instance() {
+    static SharedConnection shared;
+    return shared;
+}
+
+void SharedConnection::start(virConnectPtr connection, Rebind onReconnected) {
+    if (running || !connection) return;
+
+    conn = connection;
+    original = connection;
+    rebind = std::move(onReconnected);
+
+    // Keepalive and close callbacks are driven by the event loop
+    if (!LibvirtEvents::isRunning()) return;
+
+    char* connectUri = virConnectGetURI(connection);
+    if (!connectUri) return;
+    uri = connectUri;
+    free(connectUri);
+
+    watch(connection);
+    closed = false;
+    running = true;
+    monitor = std::thread(&SharedConnection::run, this);
+}
+
+SharedConnection::~SharedConnection() {
+    stop();
+
+    virConnectPtr current = conn.exchange(nullptr);
+    if (current && current != original) retired.push_back(current);
+    for (virConnectPtr old : retired) {
+        virConnectClose(old);
+    }
+}
+
+void SharedConnection::stop() {
+    if (!running) return;
+
+    running = false;
+    wake.notify_all();
+    if (monitor.joinable()) {
+        monitor.join();
+    }
+    virConnectUnregisterCloseCallback(conn, onClose);
+}
+
+bool SharedConnection::isAlive() const {
+    virConnectPtr current = conn;
+    return current && !closed && virConnectIsAlive(current) == 1;
+}
+
+void SharedConnection::watch(virConnectPtr connection) {
+    // Without keepalive a dead peer is only noticed by the next call
+    if (virConnectSetKeepAlive(connection, ConnectionPool::KEEPALIVE_INTERVAL_SECONDS,
+                               ConnectionPool::KEEPALIVE_COUNT) < 0) {
+        fprintf(stderr, "Libvirt keepalive unavailable: %s\n", lastError().c_str());
+    }
+    virConnectRegisterCloseCallback(connection, onClose, this, nullptr);
+}
+
+void SharedConnection::onClose(virConnectPtr connection, int reason, void* opaque) {
+    auto* shared = static_cast<SharedConnection*>(opaque);
+    if (connection != shared->conn) return;
+
+    fprintf(stderr, "Shared libvirt connection lost (%s), reconnecting\n", closeReason(reason));
+    shared->closed = true;
+    shared->wake.notify_all();
+}
+
+void SharedConnection::run() {
+    int failures = 0;
+
+    while (running) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            long long waitMs = failures ? backoffMs(failures, 0) : ConnectionPool::MONITOR_INTERVAL_MS;
+            wake.wait_for(lock, std::chrono::milliseconds(waitMs), [this, failures]() {
+                return !running || (closed && failures == 0);
+            });
+        }
+        if (!running) break;
+        if (failures == 0 && isAlive()) continue;
+
+        virConnectPtr fresh;
+        {
+            LibvirtTimer timer(LibvirtCall::ConnectOpen);
+            fresh = virConnectOpen(uri.c_str());
+        }
+        if (!fresh) {
+            failures++;
+            fprintf(stderr, "Shared libvirt connection: reconnecting to %s failed (attempt %d): %s\n",
+                    uri.c_str(), failures, lastError().c_str());
+            continue;
+        }
+
+        failures = 0;
+        watch(fresh);
+        virConnectPtr old = conn.exchange(fresh);
+        closed = false;
+
+        virConnectUnregisterCloseCallback(old, onClose);
+        if (old != original) retired.push_back(old);
+
+        fprintf(stdout, "Shared libvirt connection: reconnected to %s\n", uri.c_str());
+        if (rebind) rebind(fresh);
+    }
+}
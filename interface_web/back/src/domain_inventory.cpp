@@ -0,0 +1,407 @@
+#include "../include/domain_inventory.hpp"
+#include "../include/vm_lookup.hpp"
+#include "../include/domain_model.hpp"
+#include "../include/usage_tracker.hpp"
+#include "../include/ownership_index.hpp"
+#include "../include/utils.hpp"
+#include "../include/metrics.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <libvirt/virterror.h>
+
+namespace {
+
+void fillOwner(DomainEntry& entry) {
+    VMNameManager nameManager;
+    auto nameInfo = nameManager.parseVMName(entry.name);
+    entry.displayName = nameInfo.valid ? nameInfo.vmName : entry.name;
+    entry.owner = nameInfo.valid ? nameInfo.username : "";
+}
+
+// Capacity of the sample's block devices that the definition lists as
+// disks; CD-ROMs (seed and install ISOs) do not count
+unsigned long long diskCapacity(const DomainModel& model, const DomainStats::DomainSample& sample) {
+    unsigned long long total = 0;
+    for (const auto& block : sample.disks) {
+        for (const auto& disk : model.disks) {
+            if (disk.targetDev == block.name && disk.device == "disk") {
+                total += block.capacity;
+                break;
+            }
+        }
+    }
+    return total;
+}
+
+unsigned long long measureStorage(virDomainPtr domain) {
+    auto model = DomainModelCache::instance().get(domain);
+    std::vector<DomainStats::DomainSample> samples;
+    if (!model || !DomainStats::collect(&domain, 1, samples, VIR_DOMAIN_STATS_BLOCK) || samples.empty()) {
+        return 0;
+    }
+    return diskCapacity(*model, samples[0]);
+}
+
+} // namespace
+
+DomainInventory& DomainInventory::instance() {
+    static DomainInventory inventory;
+    return inventory;
+}
+
+DomainEntry DomainInventory::makeEntry(const DomainStats::DomainSample& sample) {
+    DomainEntry entry;
+    entry.name = sample.name;
+    entry.id = sample.id;
+    entry.state = sample.state;
+    entry.vcpus = sample.vcpus;
+    entry.memory = sample.balloonCurrent;
+    entry.maxMemory = sample.balloonMaximum;
+    entry.updated = sample.timestamp;
+    fillOwner(entry);
+    return entry;
+}
+
+bool DomainInventory::start(virConnectPtr connection) {
+    if (ready) return true;
+    if (!connection) return false;
+
+    conn = connection;
+
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        loading = true;
+        loadStarted = getCurrentTimeMs();
+        removedDuringLoad.clear();
+    }
+
+    // Subscribe first so nothing that happens during the initial load is
+    // lost; the snapshot is merged under what the events applied meanwhile
+    struct Registration {
+        int eventId;
+        virConnectDomainEventGenericCallback callback;
+    };
+    const Registration registrations[] = {
+        {VIR_DOMAIN_EVENT_ID_LIFECYCLE, VIR_DOMAIN_EVENT_CALLBACK(onLifecycle)},
+        {VIR_DOMAIN_EVENT_ID_REBOOT, VIR_DOMAIN_EVENT_CALLBACK(onReboot)},
+        {VIR_DOMAIN_EVENT_ID_DEVICE_ADDED, VIR_DOMAIN_EVENT_CALLBACK(onDeviceChange)},
+        {VIR_DOMAIN_EVENT_ID_DEVICE_REMOVED, VIR_DOMAIN_EVENT_CALLBACK(onDeviceChange)},
+        {VIR_DOMAIN_EVENT_ID_BALLOON_CHANGE, VIR_DOMAIN_EVENT_CALLBACK(onBalloonChange)},
+    };
+
+    for (const auto& reg : registrations) {
+        int id = virConnectDomainEventRegisterAny(conn, nullptr, reg.eventId, reg.callback, this, nullptr);
+        if (id < 0) {
+            virErrorPtr err = virGetLastError();
+            fprintf(stderr, "Failed to register domain event %d: %s\n", reg.eventId,
+                    err && err->message ? err->message : "unknown error");
+            stop();
+            return false;
+        }
+        callbackIds.push_back(id);
+    }
+
+    // Initial load: one RPC for every domain
+    std::vector<DomainStats::DomainSample> samples;
+    if (!DomainStats::collectAll(conn, samples, 0,
+                                 VIR_DOMAIN_STATS_STATE | VIR_DOMAIN_STATS_BALLOON |
+                                 VIR_DOMAIN_STATS_VCPU | VIR_DOMAIN_STATS_BLOCK)) {
+        stop();
+        return false;
+    }
+
+    std::vector<DomainEntry> entries;
+    for (const auto& sample : samples) {
+        DomainEntry entry = makeEntry(sample);
+
+        // Which block devices are disks is only in the definition
+        virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                          [&] { return virDomainLookupByName(conn, sample.name.c_str()); });
+        if (domain) {
+            auto model = DomainModelCache::instance().get(domain);
+            if (model) entry.storage = diskCapacity(*model, sample);
+            virDomainFree(domain);
+        }
+        entries.push_back(std::move(entry));
+    }
+
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        for (auto& entry : entries) {
+            // An event since the load started is newer than the snapshot
+            auto it = domains.find(entry.name);
+            if (it != domains.end() && it->second.updated >= loadStarted) continue;
+            if (removedDuringLoad.count(entry.name)) continue;
+
+            UsageTracker::instance().update(entry.name, &entry);
+            OwnershipIndex::instance().assign(entry.name, entry.owner);
+            domains[entry.name] = std::move(entry);
+        }
+        loading = false;
+        removedDuringLoad.clear();
+    }
+    changed.notify_all();
+
+    // Domains that stopped while no events were received
+    std::vector<std::string> watched;
+    {
+        std::lock_guard<std::mutex> lock(watchMutex);
+        for (const auto& [id, watch] : shutoffWatches) {
+            watched.push_back(watch.name);
+        }
+    }
+    for (const auto& name : watched) {
+        checkShutoffWatches(name);
+    }
+
+    ready = true;
+    fprintf(stdout, "Domain inventory loaded: %zu domain(s)\n", samples.size());
+    return true;
+}
+
+void DomainInventory::stop() {
+    ready = false;
+
+    for (int id : callbackIds) {
+        virConnectDomainEventDeregisterAny(conn, id);
+    }
+    callbackIds.clear();
+    DomainModelCache::instance().clear();
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    domains.clear();
+    loading = false;
+    removedDuringLoad.clear();
+    UsageTracker::instance().clear();
+    OwnershipIndex::instance().clear();
+}
+
+bool DomainInventory::get(const std::string& name, DomainEntry& out) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = domains.find(name);
+    if (it == domains.end()) return false;
+    out = it->second;
+    return true;
+}
+
+std::vector<DomainEntry> DomainInventory::list() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<DomainEntry> entries;
+    entries.reserve(domains.size());
+    for (const auto& [name, entry] : domains) {
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+std::vector<DomainEntry> DomainInventory::listByOwner(const std::string& owner) const {
+    // The index may also name VMs whose deploy has not defined them yet
+    auto names = OwnershipIndex::instance().vmsOf(owner);
+
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<DomainEntry> entries;
+    for (const auto& name : names) {
+        auto it = domains.find(name);
+        if (it != domains.end()) {
+            entries.push_back(it->second);
+        }
+    }
+    return entries;
+}
+
+void DomainInventory::refresh(const std::string& name) {
+    if (!conn) return;
+
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
+    if (!domain) {
+        remove(name);
+        return;
+    }
+
+    refreshDomain(domain, true);
+    virDomainFree(domain);
+}
+
+void DomainInventory::refreshDomain(virDomainPtr domain, bool rescanDisks) {
+    const char* name = virDomainGetName(domain);
+    if (!name) return;
+
+    virDomainInfo info;
+    if (virDomainGetInfo(domain, &info) < 0) {
+        // Transient domains disappear as soon as they stop
+        remove(name);
+        return;
+    }
+
+    DomainEntry entry;
+    entry.name = name;
+    entry.id = static_cast<int>(virDomainGetID(domain));
+    entry.state = info.state;
+    entry.vcpus = info.nrVirtCpu;
+    entry.memory = info.memory;
+    entry.maxMemory = info.maxMem;
+    entry.updated = getCurrentTimeMs();
+    fillOwner(entry);
+
+    if (!rescanDisks) {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = domains.find(entry.name);
+        if (it != domains.end()) {
+            entry.storage = it->second.storage;
+        } else {
+            rescanDisks = true;
+        }
+    }
+    if (rescanDisks) {
+        entry.storage = measureStorage(domain);
+    }
+
+    upsert(std::move(entry));
+}
+
+bool DomainInventory::waitForShutoff(const std::string& name, long long timeoutMs) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    return changed.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]() {
+        auto it = domains.find(name);
+        return it == domains.end() || it->second.state == VIR_DOMAIN_SHUTOFF;
+    });
+}
+
+bool DomainInventory::whenShutoff(const std::string& name, long long timeoutMs,
+                                  std::function<void(bool)> done) {
+    if (!ready) return false;
+
+    // Under watchMutex, so a state change either shows here or fires the watch
+    std::unique_lock<std::mutex> lock(watchMutex);
+    {
+        std::shared_lock<std::shared_mutex> domainsLock(mutex);
+        auto it = domains.find(name);
+        if (it == domains.end() || it->second.state == VIR_DOMAIN_SHUTOFF) {
+            domainsLock.unlock();
+            lock.unlock();
+            done(true);
+            return true;
+        }
+    }
+
+    long long id = ++nextWatchId;
+    int timer = virEventAddTimeout(static_cast<int>(timeoutMs), onShutoffTimeout,
+                                   reinterpret_cast<void*>(static_cast<intptr_t>(id)), nullptr);
+    if (timer < 0) return false;
+
+    shutoffWatches[id] = {name, timer, std::move(done)};
+    return true;
+}
+
+void DomainInventory::checkShutoffWatches(const std::string& name) {
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = domains.find(name);
+        if (it != domains.end() && it->second.state != VIR_DOMAIN_SHUTOFF) return;
+    }
+
+    std::vector<std::function<void(bool)>> fired;
+    {
+        std::lock_guard<std::mutex> lock(watchMutex);
+        for (auto it = shutoffWatches.begin(); it != shutoffWatches.end();) {
+            if (it->second.name != name) {
+                ++it;
+                continue;
+            }
+            virEventRemoveTimeout(it->second.timer);
+            fired.push_back(std::move(it->second.done));
+            it = shutoffWatches.erase(it);
+        }
+    }
+
+    for (auto& done : fired) {
+        done(true);
+    }
+}
+
+// Runs on the event loop thread
+void DomainInventory::onShutoffTimeout(int timer, void* opaque) {
+    auto& self = instance();
+    long long id = static_cast<long long>(reinterpret_cast<intptr_t>(opaque));
+
+    std::function<void(bool)> done;
+    {
+        std::lock_guard<std::mutex> lock(self.watchMutex);
+        virEventRemoveTimeout(timer);
+        auto it = self.shutoffWatches.find(id);
+        if (it == self.shutoffWatches.end()) return;
+        done = std::move(it->second.done);
+        self.shutoffWatches.erase(it);
+    }
+
+    done(false);
+}
+
+void DomainInventory::remove(const std::string& name) {
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        domains.erase(name);
+        if (loading) removedDuringLoad.insert(name);
+        UsageTracker::instance().update(name, nullptr);
+        OwnershipIndex::instance().release(name);
+    }
+    changed.notify_all();
+    checkShutoffWatches(name);
+}
+
+void DomainInventory::upsert(DomainEntry entry) {
+    std::string name = entry.name;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        UsageTracker::instance().update(name, &entry);
+        if (entry.owner.empty()) {
+            OwnershipIndex::instance().release(name);
+        } else {
+            OwnershipIndex::instance().assign(name, entry.owner);
+        }
+        domains[name] = std::move(entry);
+    }
+    changed.notify_all();
+    checkShutoffWatches(name);
+}
+
+// ========================================
+// EVENT CALLBACKS (run on the event loop thread)
+// ========================================
+
+void DomainInventory::onLifecycle(virConnectPtr, virDomainPtr dom, int event, int, void* opaque) {
+    auto* self = static_cast<DomainInventory*>(opaque);
+
+    // Definitions change on define/undefine, and the live XML (ports,
+    // host devices) on every start and stop
+    const char* name = virDomainGetName(dom);
+    if (name) DomainModelCache::instance().invalidate(name);
+
+    if (event == VIR_DOMAIN_EVENT_UNDEFINED) {
+        if (name) self->remove(name);
+        return;
+    }
+
+    // A new definition may come with different disks
+    self->refreshDomain(dom, event == VIR_DOMAIN_EVENT_DEFINED);
+}
+
+void DomainInventory::onReboot(virConnectPtr, virDomainPtr dom, void* opaque) {
+    static_cast<DomainInventory*>(opaque)->refreshDomain(dom);
+}
+
+void DomainInventory::onDeviceChange(virConnectPtr, virDomainPtr dom, const char*, void* opaque) {
+    const char* name = virDomainGetName(dom);
+    if (name) DomainModelCache::instance().invalidate(name);
+
+    // vCPU / memory / disk hotplug changes what we report
+    static_cast<DomainInventory*>(opaque)->refreshDomain(dom, true);
+}
+
+void DomainInventory::onBalloonChange(virConnectPtr, virDomainPtr dom, unsigned long long, void* opaque) {
+    static_cast<DomainInventory*>(opaque)->refreshDomain(dom);
+}
@@ -0,0 +1,461 @@
+#include "../include/domain_model.hpp"
+#include "../include/domain_inventory.hpp"
+#include "../include/metrics.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+// Append `in` to `out`, decoding the predefined and numeric entities
+void appendDecoded(const char* begin, const char* end, std::string& out) {
+    while (begin < end) {
+        const char* amp = static_cast<const char*>(memchr(begin, '&', end - begin));
+        if (!amp) {
+            out.append(begin, end);
+            return;
+        }
+        out.append(begin, amp);
+
+        const char* semi = static_cast<const char*>(memchr(amp, ';', end - amp));
+        if (!semi) {
+            out.append(amp, end);
+            return;
+        }
+
+        std::string entity(amp + 1, semi);
+        if (entity == "lt") out += '<';
+        else if (entity == "gt") out += '>';
+        else if (entity == "amp") out += '&';
+        else if (entity == "quot") out += '"';
+        else if (entity == "apos") out += '\'';
+        else if (entity.size() > 1 && entity[0] == '#') {
+            long code = entity[1] == 'x' ? strtol(entity.c_str() + 2, nullptr, 16)
+                                         : strtol(entity.c_str() + 1, nullptr, 10);
+            // Names and paths libvirt emits are ASCII; keep anything else verbatim
+            if (code > 0 && code < 0x80) out += static_cast<char>(code);
+            else out.append(amp, semi + 1);
+        } else {
+            out.append(amp, semi + 1);
+        }
+        begin = semi + 1;
+    }
+}
+
+// Minimal pull parser for the XML libvirt produces: elements, attributes,
+// text, comments, CDATA and processing instructions. No DTDs or namespaces.
+class XmlReader {
+public:
+    enum class Event { StartElement, EndElement, Text, End, Error };
+
+    explicit XmlReader(const std::string& xml)
+        : pos(xml.data()), end(xml.data() + xml.size()) {}
+
+    Event next() {
+        if (pendingEnd) {
+            pendingEnd = false;
+            return Event::EndElement;
+        }
+
+        while (pos < end) {
+            if (*pos != '<') {
+                const char* lt = static_cast<const char*>(memchr(pos, '<', end - pos));
+                if (!lt) lt = end;
+                textValue.clear();
+                appendDecoded(pos, lt, textValue);
+                pos = lt;
+                return Event::Text;
+            }
+
+            if (startsWith("<!--")) {
+                if (!skipPast("-->")) return Event::Error;
+                continue;
+            }
+            if (startsWith("<![CDATA[")) {
+                const char* start = pos + 9;
+                if (!skipPast("]]>")) return Event::Error;
+                textValue.assign(start, pos - 3);
+                return Event::Text;
+            }
+            if (startsWith("<?") || startsWith("<!")) {
+                if (!skipPast(">")) return Event::Error;
+                continue;
+            }
+            if (startsWith("</")) {
+                pos += 2;
+                const char* nameStart = pos;
+                while (pos < end && *pos != '>' && !isSpace(*pos)) pos++;
+                elementName.assign(nameStart, pos);
+                if (!skipPast(">")) return Event::Error;
+                return Event::EndElement;
+            }
+            return readStartTag() ? Event::StartElement : Event::Error;
+        }
+
+        return Event::End;
+    }
+
+    const std::string& name() const { return elementName; }
+    const std::string& text() const { return textValue; }
+
+    // Attribute of the current start tag, empty if absent
+    const std::string& attribute(const char* key) const {
+        for (const auto& attr : attributes) {
+            if (attr.first == key) return attr.second;
+        }
+        return empty;
+    }
+
+private:
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+    bool startsWith(const char* prefix) const {
+        size_t len = strlen(prefix);
+        return static_cast<size_t>(end - pos) >= len && memcmp(pos, prefix, len) == 0;
+    }
+
+    bool skipPast(const char* marker) {
+        size_t len = strlen(marker);
+        for (const char* p = pos; p + len <= end; p++) {
+            if (memcmp(p, marker, len) == 0) {
+                pos = p + len;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool readStartTag() {
+        pos++;  // '<'
+        const char* nameStart = pos;
+        while (pos < end && *pos != '>' && *pos != '/' && !isSpace(*pos)) pos++;
+        elementName.assign(nameStart, pos);
+        attributes.clear();
+
+        while (pos < end) {
+            while (pos < end && isSpace(*pos)) pos++;
+            if (pos >= end) return false;
+
+            if (*pos == '>') {
+                pos++;
+                return true;
+            }
+            if (*pos == '/') {
+                if (pos + 1 >= end || pos[1] != '>') return false;
+                pos += 2;
+                pendingEnd = true;   // <x/> reads as <x></x>
+                return true;
+            }
+
+            const char* keyStart = pos;
+            while (pos < end && *pos != '=' && !isSpace(*pos)) pos++;
+            std::string key(keyStart, pos);
+            while (pos < end && isSpace(*pos)) pos++;
+            if (pos >= end || *pos != '=') return false;
+            pos++;
+            while (pos < end && isSpace(*pos)) pos++;
+            if (pos >= end || (*pos != '\'' && *pos != '"')) return false;
+
+            char quote = *pos++;
+            const char* valueEnd = static_cast<const char*>(memchr(pos, quote, end - pos));
+            if (!valueEnd) return false;
+
+            std::string value;
+            appendDecoded(pos, valueEnd, value);
+            attributes.emplace_back(std::move(key), std::move(value));
+            pos = valueEnd + 1;
+        }
+        return false;
+    }
+
+    const char* pos;
+    const char* end;
+    bool pendingEnd = false;
+    std::string elementName;
+    std::string textValue;
+    std::vector<std::pair<std::string, std::string>> attributes;
+    const std::string empty;
+};
+
+// Element path from the root, e.g. {"domain", "devices", "disk"}
+using ElementPath = std::vector<std::string>;
+
+bool isPath(const ElementPath& path, std::initializer_list<const char*> expected) {
+    if (path.size() != expected.size()) return false;
+    size_t i = 0;
+    for (const char* part : expected) {
+        if (path[i++] != part) return false;
+    }
+    return true;
+}
+
+// Child element of /domain/devices/<device>
+bool isDeviceChild(const ElementPath& path, const char* device) {
+    return path.size() == 4 && path[1] == "devices" && path[2] == device;
+}
+
+int toInt(const std::string& value, int fallback) {
+    if (value.empty()) return fallback;
+    char* endPtr = nullptr;
+    long parsed = strtol(value.c_str(), &endPtr, 10);
+    return *endPtr == '\0' ? static_cast<int>(parsed) : fallback;
+}
+
+void readDiskChild(const XmlReader& reader, const std::string& element, DiskModel& disk) {
+    if (element == "driver") {
+        disk.driverType = reader.attribute("type");
+    } else if (element == "source") {
+        if (disk.type == "file") {
+            disk.source = reader.attribute("file");
+        } else if (disk.type == "block") {
+            disk.source = reader.attribute("dev");
+        } else if (disk.type == "volume") {
+            disk.source = reader.attribute("pool") + "/" + reader.attribute("volume");
+        } else {
+            disk.source = reader.attribute("protocol") + ":" + reader.attribute("name");
+        }
+    } else if (element == "target") {
+        disk.targetDev = reader.attribute("dev");
+        disk.targetBus = reader.attribute("bus");
+    } else if (element == "readonly") {
+        disk.readonly = true;
+    }
+}
+
+void readInterfaceChild(const XmlReader& reader, const std::string& element, InterfaceModel& nic) {
+    if (element == "mac") {
+        nic.mac = reader.attribute("address");
+    } else if (element == "source") {
+        const std::string& network = reader.attribute("network");
+        const std::string& bridge = reader.attribute("bridge");
+        nic.source = !network.empty() ? network : !bridge.empty() ? bridge : reader.attribute("dev");
+    } else if (element == "model") {
+        nic.model = reader.attribute("type");
+    } else if (element == "target") {
+        nic.target = reader.attribute("dev");
+    }
+}
+
+} // namespace
+
+const GraphicsModel* DomainModel::findGraphics(const std::string& type) const {
+    for (const auto& entry : graphics) {
+        if (entry.type == type) return &entry;
+    }
+    return nullptr;
+}
+
+bool parseDomainXML(const std::string& xml, DomainModel& model) {
+    model = DomainModel();
+
+    XmlReader reader(xml);
+    ElementPath path;
+
+    while (true) {
+        switch (reader.next()) {
+            case XmlReader::Event::End:
+                return path.empty() && !model.name.empty();
+
+            case XmlReader::Event::Error:
+                return false;
+
+            case XmlReader::Event::StartElement: {
+                const std::string& element = reader.name();
+                path.push_back(element);
+
+                if (path.size() == 1 && element != "domain") return false;
+
+                if (isPath(path, {"domain", "devices", "disk"})) {
+                    DiskModel disk;
+                    disk.type = reader.attribute("type");
+                    disk.device = reader.attribute("device");
+                    model.disks.push_back(disk);
+                } else if (isPath(path, {"domain", "devices", "interface"})) {
+                    InterfaceModel nic;
+                    nic.type = reader.attribute("type");
+                    model.interfaces.push_back(nic);
+                } else if (isPath(path, {"domain", "devices", "graphics"})) {
+                    GraphicsModel graphics;
+                    graphics.type = reader.attribute("type");
+                    graphics.port = toInt(reader.attribute("port"), -1);
+                    graphics.autoport = reader.attribute("autoport") == "yes";
+                    graphics.listen = reader.attribute("listen");
+                    model.graphics.push_back(graphics);
+                } else if (isPath(path, {"domain", "devices", "channel"})) {
+                    ChannelModel channel;
+                    channel.type = reader.attribute("type");
+                    model.channels.push_back(channel);
+                } else if (isDeviceChild(path, "disk")) {
+                    readDiskChild(reader, element, model.disks.back());
+                } else if (isDeviceChild(path, "interface")) {
+                    readInterfaceChild(reader, element, model.interfaces.back());
+                } else if (isDeviceChild(path, "channel") && element == "target") {
+                    ChannelModel& channel = model.channels.back();
+                    channel.targetType = reader.attribute("type");
+                    channel.targetName = reader.attribute("name");
+                    channel.state = reader.attribute("state");
+                }
+                break;
+            }
+
+            case XmlReader::Event::EndElement:
+                if (path.empty()) return false;
+                path.pop_back();
+                break;
+
+            case XmlReader::Event::Text:
+                if (isPath(path, {"domain", "name"})) {
+                    model.name += reader.text();
+                } else if (isPath(path, {"domain", "uuid"})) {
+                    model.uuid += reader.text();
+                }
+                break;
+        }
+    }
+}
+
+bool parseSnapshotXML(const std::string& xml, SnapshotModel& snapshot) {
+    snapshot = SnapshotModel();
+
+    XmlReader reader(xml);
+    ElementPath path;
+    std::string creationTime;
+
+    while (true) {
+        switch (reader.next()) {
+            case XmlReader::Event::End:
+                if (!creationTime.empty()) {
+                    snapshot.creationTime = strtoll(creationTime.c_str(), nullptr, 10);
+                }
+                return path.empty() && !snapshot.name.empty();
+
+            case XmlReader::Event::Error:
+                return false;
+
+            case XmlReader::Event::StartElement:
+                path.push_back(reader.name());
+                if (path.size() == 1 && path[0] != "domainsnapshot") return false;
+                break;
+
+            case XmlReader::Event::EndElement:
+                if (path.empty()) return false;
+                path.pop_back();
+                break;
+
+            case XmlReader::Event::Text:
+                // Only direct children: the embedded <domain> has a <name> too
+                if (isPath(path, {"domainsnapshot", "name"})) {
+                    snapshot.name += reader.text();
+                } else if (isPath(path, {"domainsnapshot", "state"})) {
+                    snapshot.state += reader.text();
+                } else if (isPath(path, {"domainsnapshot", "creationTime"})) {
+                    creationTime += reader.text();
+                }
+                break;
+        }
+    }
+}
+
+std::string stripBackingStores(const std::string& xml) {
+    std::string result;
+    result.reserve(xml.size());
+
+    size_t pos = 0;
+    while (true) {
+        size_t start = xml.find("<backingStore", pos);
+        if (start == std::string::npos) {
+            result.append(xml, pos, std::string::npos);
+            break;
+        }
+        result.append(xml, pos, start - pos);
+
+        size_t tagEnd = xml.find('>', start);
+        if (tagEnd == std::string::npos) break;
+
+        // <backingStore/> terminates a chain
+        if (xml[tagEnd - 1] == '/') {
+            pos = tagEnd + 1;
+            continue;
+        }
+
+        int depth = 1;
+        size_t cursor = tagEnd + 1;
+        while (depth > 0) {
+            size_t open = xml.find("<backingStore", cursor);
+            size_t close = xml.find("</backingStore>", cursor);
+            if (close == std::string::npos) {
+                return result;
+            }
+            if (open != std::string::npos && open < close) {
+                size_t openEnd = xml.find('>', open);
+                if (openEnd == std::string::npos) return result;
+                if (xml[openEnd - 1] != '/') depth++;
+                cursor = openEnd + 1;
+            } else {
+                depth--;
+                cursor = close + std::string("</backingStore>").size();
+            }
+        }
+        pos = cursor;
+    }
+
+    return result;
+}
+
+DomainModelCache& DomainModelCache::instance() {
+    static DomainModelCache cache;
+    return cache;
+}
+
+std::shared_ptr<const DomainModel> DomainModelCache::get(virDomainPtr domain) {
+    if (!domain) return nullptr;
+
+    const char* rawName = virDomainGetName(domain);
+    if (!rawName) return nullptr;
+    std::string name = rawName;
+
+    // Without events nothing would ever invalidate an entry
+    bool cacheable = DomainInventory::instance().isReady();
+
+    unsigned long long seenGeneration;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cacheable) {
+            auto it = models.find(name);
+            if (it != models.end()) return it->second;
+        }
+        seenGeneration = generation;
+    }
+
+    char* xmlDesc = timeLibvirt(LibvirtCall::DomainGetXMLDesc,
+                                [&] { return virDomainGetXMLDesc(domain, 0); });
+    if (!xmlDesc) return nullptr;
+
+    auto model = std::make_shared<DomainModel>();
+    bool parsed = parseDomainXML(xmlDesc, *model);
+    free(xmlDesc);
+    if (!parsed) return nullptr;
+
+    if (cacheable) {
+        std::lock_guard<std::mutex> lock(mutex);
+        // An event that arrived while we were reading may describe a newer definition
+        if (generation == seenGeneration) {
+            models[name] = model;
+        }
+    }
+
+    return model;
+}
+
+void DomainModelCache::invalidate(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    models.erase(name);
+    generation++;
+}
+
+void DomainModelCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    models.clear();
+    generation++;
+}
@@ -0,0 +1,165 @@
+#include "../include/domain_stats.hpp"
+#include "../include/utils.hpp"
+#include "../include/metrics.hpp"
+
+#include <cstdio>
+#include <libvirt/virterror.h>
+
+namespace DomainStats {
+
+namespace {
+
+unsigned long long getULLong(const virDomainStatsRecordPtr record, const std::string& field) {
+    unsigned long long value = 0;
+    if (virTypedParamsGetULLong(record->params, record->nparams, field.c_str(), &value) != 1) {
+        return 0;
+    }
+    return value;
+}
+
+std::string getString(const virDomainStatsRecordPtr record, const std::string& field) {
+    const char* value = nullptr;
+    if (virTypedParamsGetString(record->params, record->nparams, field.c_str(), &value) != 1 || !value) {
+        return "";
+    }
+    return value;
+}
+
+unsigned int getUInt(const virDomainStatsRecordPtr record, const std::string& field) {
+    unsigned int value = 0;
+    if (virTypedParamsGetUInt(record->params, record->nparams, field.c_str(), &value) != 1) {
+        return 0;
+    }
+    return value;
+}
+
+DomainSample parseRecord(const virDomainStatsRecordPtr record, long long timestamp) {
+    DomainSample sample;
+    sample.timestamp = timestamp;
+
+    // Name and ID are cached in the domain object, no RPC involved
+    const char* name = virDomainGetName(record->dom);
+    sample.name = name ? name : "";
+    sample.id = static_cast<int>(virDomainGetID(record->dom));
+
+    int state = VIR_DOMAIN_NOSTATE;
+    if (virTypedParamsGetInt(record->params, record->nparams, "state.state", &state) == 1) {
+        sample.state = state;
+    }
+
+    sample.cpuTime = getULLong(record, "cpu.time");
+    sample.balloonCurrent = getULLong(record, "balloon.current");
+    sample.balloonMaximum = getULLong(record, "balloon.maximum");
+    sample.vcpus = getUInt(record, "vcpu.current");
+
+    unsigned int blockCount = getUInt(record, "block.count");
+    for (unsigned int i = 0; i < blockCount; i++) {
+        std::string prefix = "block." + std::to_string(i) + ".";
+        BlockSample block;
+        block.name = getString(record, prefix + "name");
+        block.path = getString(record, prefix + "path");
+        block.readBytes = getULLong(record, prefix + "rd.bytes");
+        block.writeBytes = getULLong(record, prefix + "wr.bytes");
+        block.capacity = getULLong(record, prefix + "capacity");
+        block.allocation = getULLong(record, prefix + "allocation");
+        sample.disks.push_back(block);
+    }
+
+    unsigned int netCount = getUInt(record, "net.count");
+    for (unsigned int i = 0; i < netCount; i++) {
+        std::string prefix = "net." + std::to_string(i) + ".";
+        NetSample net;
+        net.name = getString(record, prefix + "name");
+        net.rxBytes = getULLong(record, prefix + "rx.bytes");
+        net.txBytes = getULLong(record, prefix + "tx.bytes");
+        sample.nics.push_back(net);
+    }
+
+    return sample;
+}
+
+void parseRecords(virDomainStatsRecordPtr* records, int count, std::vector<DomainSample>& out) {
+    long long now = getCurrentTimeMs();
+    out.reserve(out.size() + count);
+    for (int i = 0; i < count; i++) {
+        out.push_back(parseRecord(records[i], now));
+    }
+}
+
+void logLastError(const char* what) {
+    virErrorPtr err = virGetLastError();
+    fprintf(stderr, "%s failed: %s\n", what, err && err->message ? err->message : "unknown error");
+}
+
+} // namespace
+
+unsigned long long DomainSample::totalReadBytes() const {
+    unsigned long long total = 0;
+    for (const auto& disk : disks) total += disk.readBytes;
+    return total;
+}
+
+unsigned long long DomainSample::totalWriteBytes() const {
+    unsigned long long total = 0;
+    for (const auto& disk : disks) total += disk.writeBytes;
+    return total;
+}
+
+unsigned long long DomainSample::totalRxBytes() const {
+    unsigned long long total = 0;
+    for (const auto& nic : nics) total += nic.rxBytes;
+    return total;
+}
+
+unsigned long long DomainSample::totalTxBytes() const {
+    unsigned long long total = 0;
+    for (const auto& nic : nics) total += nic.txBytes;
+    return total;
+}
+
+bool collectAll(virConnectPtr conn, std::vector<DomainSample>& out,
+                unsigned int listFlags, unsigned int stats) {
+    if (!conn) return false;
+
+    virDomainStatsRecordPtr* records = nullptr;
+    int count;
+    {
+        LibvirtTimer timer(LibvirtCall::GetAllDomainStats);
+        count = virConnectGetAllDomainStats(conn, stats, &records, listFlags);
+    }
+    if (count < 0) {
+        logLastError("virConnectGetAllDomainStats");
+        return false;
+    }
+
+    parseRecords(records, count, out);
+    virDomainStatsRecordListFree(records);
+    return true;
+}
+
+bool collect(virDomainPtr* domains, unsigned int count, std::vector<DomainSample>& out,
+             unsigned int stats) {
+    if (count == 0) return true;
+    if (!domains) return false;
+
+    // virDomainListGetStats expects a NULL-terminated list
+    std::vector<virDomainPtr> list(domains, domains + count);
+    list.push_back(nullptr);
+
+    virDomainStatsRecordPtr* records = nullptr;
+    int n;
+    {
+        LibvirtTimer timer(LibvirtCall::DomainListGetStats);
+        n = virDomainListGetStats(list.data(), stats, &records, 0);
+    }
+    if (n < 0) {
+        logLastError("virDomainListGetStats");
+        return false;
+    }
+
+    parseRecords(records, n, out);
+    virDomainStatsRecordListFree(records);
+    return true;
+}
+
+} // namespace DomainStats
@@ -0,0 +1,67 @@
+#include "../include/event_loop.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <libvirt/libvirt.h>
+#include <libvirt/virterror.h>
+
+namespace LibvirtEvents {
+
+namespace {
+
+std::atomic<bool> running{false};
+std::thread loopThread;
+int wakeupTimer = -1;
+
+// virEventRunDefaultImpl blocks until something happens; a periodic
+// no-op timer guarantees the loop notices stopEventLoop() promptly.
+void onWakeup(int, void*) {}
+
+} // namespace
+
+bool startEventLoop() {
+    if (running) return true;
+
+    if (virEventRegisterDefaultImpl() < 0) {
+        virErrorPtr err = virGetLastError();
+        fprintf(stderr, "Failed to register libvirt event loop: %s\n",
+                err && err->message ? err->message : "unknown error");
+        return false;
+    }
+
+    wakeupTimer = virEventAddTimeout(1000, onWakeup, nullptr, nullptr);
+
+    running = true;
+    loopThread = std::thread([]() {
+        while (running) {
+            if (virEventRunDefaultImpl() < 0) {
+                virErrorPtr err = virGetLastError();
+                fprintf(stderr, "libvirt event loop error: %s\n",
+                        err && err->message ? err->message : "unknown error");
+            }
+        }
+    });
+
+    return true;
+}
+
+void stopEventLoop() {
+    if (!running) return;
+
+    running = false;
+    if (loopThread.joinable()) {
+        loopThread.join();
+    }
+
+    if (wakeupTimer >= 0) {
+        virEventRemoveTimeout(wakeupTimer);
+        wakeupTimer = -1;
+    }
+}
+
+bool isRunning() {
+    return running;
+}
+
+} // namespace LibvirtEvents
@@ -0,0 +1,255 @@
+#include "../include/host_registry.hpp"
+#include "../include/utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <system_error>
+#include <thread>
+
+namespace {
+
+// Handoff between a query thread and the gather() waiting on it
+struct PendingQuery {
+    std::mutex mutex;
+    std::condition_variable done;
+    bool finished = false;
+    HostResult result;
+};
+
+} // namespace
+
+HostRegistry& HostRegistry::instance() {
+    static HostRegistry registry;
+    return registry;
+}
+
+std::vector<HostConfig> HostRegistry::hostsFromEnvironment() {
+    std::vector<HostConfig> result;
+
+    const char* config = getenv("THOTH_HOSTS");
+    if (!config) return result;
+
+    std::stringstream entries(config);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        size_t eq = entry.find('=');
+        if (eq == std::string::npos || eq == 0 || eq + 1 == entry.size()) {
+            fprintf(stderr, "Hosts: ignoring malformed entry '%s'\n", entry.c_str());
+            continue;
+        }
+
+        HostConfig host{entry.substr(0, eq), entry.substr(eq + 1)};
+
+        bool taken = host.name == LOCAL_HOST;
+        for (const auto& other : result) {
+            if (other.name == host.name) taken = true;
+        }
+        if (taken) {
+            fprintf(stderr, "Hosts: host name '%s' is reserved or already used\n", host.name.c_str());
+            continue;
+        }
+
+        result.push_back(std::move(host));
+    }
+
+    return result;
+}
+
+void HostRegistry::start(const std::vector<HostConfig>& configured) {
+    std::vector<std::shared_ptr<Host>> started;
+    for (const auto& config : configured) {
+        auto host = std::make_shared<Host>();
+        host->name = config.name;
+        host->uri = config.uri;
+        started.push_back(host);
+    }
+
+    // Each pool opens its first connections inline; one dead node must
+    // not hold up the others
+    std::vector<std::thread> openers;
+    for (auto& host : started) {
+        openers.emplace_back([host]() {
+            host->pool.start(host->uri, CONNECTIONS_PER_HOST);
+        });
+    }
+    for (auto& opener : openers) {
+        opener.join();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    hosts = std::move(started);
+
+    if (!hosts.empty()) {
+        fprintf(stdout, "Host registry: %zu additional hypervisor(s)\n", hosts.size());
+    }
+}
+
+void HostRegistry::stop() {
+    std::vector<std::shared_ptr<Host>> stopped;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped.swap(hosts);
+    }
+
+    for (auto& host : stopped) {
+        host->pool.stop();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    hostByVM.clear();
+}
+
+bool HostRegistry::hasHosts() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !hosts.empty();
+}
+
+std::vector<HostResult> HostRegistry::gather(const HostQuery& query, const std::function<void()>& local,
+                                             long long timeoutMs) {
+    std::vector<std::shared_ptr<Host>> targets;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        targets = hosts;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    long long deadlineMs = getCurrentTimeMs() + timeoutMs;
+
+    std::vector<std::shared_ptr<PendingQuery>> queries;
+    for (const auto& host : targets) {
+        auto pending = std::make_shared<PendingQuery>();
+        pending->result.host = host->name;
+        queries.push_back(pending);
+
+        if (host->pending.load() >= MAX_PENDING_PER_HOST) {
+            pending->result.error = "Host is not responding";
+            pending->finished = true;
+            continue;
+        }
+
+        host->pending++;
+        try {
+            std::thread([host, pending, query, deadlineMs]() {
+                long long started = getCurrentTimeMs();
+                HostResult result;
+                result.host = host->name;
+
+                {
+                    auto lease = host->pool.acquire(std::max(0LL, deadlineMs - started));
+                    if (!lease) {
+                        result.error = "No connection to host";
+                    } else {
+                        try {
+                            result.data = query(lease.get());
+                            result.ok = true;
+                        } catch (const std::exception& e) {
+                            result.error = e.what();
+                        }
+                    }
+                }
+
+                result.elapsedMs = getCurrentTimeMs() - started;
+                host->lastElapsedMs = result.elapsedMs;
+                host->pending--;
+
+                std::lock_guard<std::mutex> lock(pending->mutex);
+                pending->result = std::move(result);
+                pending->finished = true;
+                pending->done.notify_one();
+            }).detach();
+        } catch (const std::system_error&) {
+            host->pending--;
+            pending->result.error = "Cannot start query thread";
+            pending->finished = true;
+        }
+    }
+
+    if (local) local();
+
+    std::vector<HostResult> results;
+    for (size_t i = 0; i < queries.size(); i++) {
+        auto& pending = *queries[i];
+        std::unique_lock<std::mutex> lock(pending.mutex);
+
+        if (pending.done.wait_until(lock, deadline, [&pending]() { return pending.finished; })) {
+            results.push_back(pending.result);
+            continue;
+        }
+
+        // Left to finish on its own; the result is dropped
+        targets[i]->timeouts++;
+        HostResult late;
+        late.host = targets[i]->name;
+        late.error = "Timed out after " + std::to_string(timeoutMs) + " ms";
+        late.elapsedMs = timeoutMs;
+        results.push_back(std::move(late));
+    }
+
+    return results;
+}
+
+HostRegistry::Connection HostRegistry::acquire(const std::string& name, long long timeoutMs) {
+    std::shared_ptr<Host> target;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& host : hosts) {
+            if (host->name == name) target = host;
+        }
+    }
+
+    Connection connection;
+    if (target) {
+        connection.lease = target->pool.acquire(timeoutMs);
+        connection.host = std::move(target);
+    }
+    return connection;
+}
+
+std::string HostRegistry::uriOf(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& host : hosts) {
+        if (host->name == name) return host->uri;
+    }
+    return "";
+}
+
+void HostRegistry::assignVM(const std::string& vmName, const std::string& host) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (host == LOCAL_HOST) {
+        hostByVM.erase(vmName);
+    } else {
+        hostByVM[vmName] = host;
+    }
+}
+
+void HostRegistry::releaseVM(const std::string& vmName) {
+    std::lock_guard<std::mutex> lock(mutex);
+    hostByVM.erase(vmName);
+}
+
+std::string HostRegistry::hostOf(const std::string& vmName) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = hostByVM.find(vmName);
+    return it == hostByVM.end() ? LOCAL_HOST : it->second;
+}
+
+json HostRegistry::status() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    json result = json::array();
+    for (const auto& host : hosts) {
+        result.push_back({
+            {"name", host->name},
+            {"uri", host->uri},
+            {"pending", host->pending.load()},
+            {"timeouts", host->timeouts.load()},
+            {"lastElapsedMs", host->lastElapsedMs.load()},
+            {"connectionPool", host->pool.status()}
+        });
+    }
+    return result;
+}
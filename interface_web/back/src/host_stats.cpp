@@ -0,0 +1,231 @@
+#include "../include/host_stats.hpp"
+#include "../include/host_registry.hpp"
+#include "../include/domain_inventory.hpp"
+#include "../include/domain_stats.hpp"
+#include "../include/storage_backend.hpp"
+#include "../include/utils.hpp"
+#include "../include/metrics.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// Where deployVM provisions disks
+const std::string IMAGES_DIR = "/var/lib/libvirt/images";
+
+constexpr unsigned int COMMITMENT_STATS = VIR_DOMAIN_STATS_STATE |
+                                          VIR_DOMAIN_STATS_BALLOON |
+                                          VIR_DOMAIN_STATS_VCPU |
+                                          VIR_DOMAIN_STATS_BLOCK;
+
+// Cumulative CPU time of the whole node, in ns
+void readCpuCounters(virConnectPtr conn, unsigned long long& total, unsigned long long& idle) {
+    total = idle = 0;
+
+    int count = 0;
+    if (virNodeGetCPUStats(conn, VIR_NODE_CPU_STATS_ALL_CPUS, nullptr, &count, 0) < 0 || count <= 0) {
+        return;
+    }
+
+    std::vector<virNodeCPUStats> params(count);
+    {
+        LibvirtTimer timer(LibvirtCall::NodeGetCPUStats);
+        if (virNodeGetCPUStats(conn, VIR_NODE_CPU_STATS_ALL_CPUS, params.data(), &count, 0) < 0) {
+            return;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        total += params[i].value;
+        if (strcmp(params[i].field, VIR_NODE_CPU_STATS_IDLE) == 0) {
+            idle += params[i].value;
+        }
+    }
+}
+
+// Virtual size of a domain's disks on a host without an inventory.
+// Only the stats are at hand there, so CD-ROMs are told apart by their
+// image (seed and install ISOs) rather than by the definition.
+unsigned long long diskCapacity(const DomainStats::DomainSample& sample) {
+    unsigned long long total = 0;
+    for (const auto& block : sample.disks) {
+        bool iso = block.path.size() >= 4 && block.path.compare(block.path.size() - 4, 4, ".iso") == 0;
+        if (!iso) total += block.capacity;
+    }
+    return total;
+}
+
+} // namespace
+
+HostStats& HostStats::instance() {
+    static HostStats stats;
+    return stats;
+}
+
+void HostStats::start(virConnectPtr localConnection) {
+    if (running || !localConnection) return;
+
+    conn = localConnection;
+    running = true;
+
+    // The first scrape already has every host
+    refresh();
+
+    refresher = std::thread(&HostStats::run, this);
+}
+
+void HostStats::stop() {
+    if (!running) return;
+
+    running = false;
+    wake.notify_all();
+    if (refresher.joinable()) {
+        refresher.join();
+    }
+}
+
+std::vector<HostState> HostStats::snapshot() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hosts;
+}
+
+json HostStats::measure(virConnectPtr conn, bool useInventory) {
+    virNodeInfo info;
+    int infoResult;
+    {
+        LibvirtTimer timer(LibvirtCall::NodeGetInfo);
+        infoResult = virNodeGetInfo(conn, &info);
+    }
+    if (infoResult < 0) {
+        throw std::runtime_error("Cannot read node info");
+    }
+
+    unsigned long long cpuTotal, cpuIdle;
+    readCpuCounters(conn, cpuTotal, cpuIdle);
+
+    unsigned long long freeMemory;
+    {
+        LibvirtTimer timer(LibvirtCall::NodeGetFreeMemory);
+        freeMemory = virNodeGetFreeMemory(conn);
+    }
+
+    std::vector<DomainEntry> entries;
+    if (useInventory && DomainInventory::instance().isReady()) {
+        entries = DomainInventory::instance().list();
+    } else {
+        std::vector<DomainStats::DomainSample> samples;
+        if (!DomainStats::collectAll(conn, samples, 0, COMMITMENT_STATS)) {
+            throw std::runtime_error("Cannot list domains");
+        }
+        for (const auto& sample : samples) {
+            entries.push_back(DomainInventory::makeEntry(sample));
+            entries.back().storage = diskCapacity(sample);
+        }
+    }
+
+    // Every defined VM counts, running or not: it may be started any time
+    unsigned long long vcpus = 0, memory = 0;
+    json owners = json::object();
+    json domains = json::array();
+    json vms = json::array();
+    for (const auto& entry : entries) {
+        vcpus += entry.vcpus;
+        memory += entry.maxMemory * 1024;
+        if (!entry.owner.empty()) {
+            owners[entry.owner] = owners.value(entry.owner, 0) + 1;
+        }
+        domains.push_back(entry.name);
+        if (!useInventory && !entry.owner.empty()) {
+            vms.push_back({
+                {"name", entry.name},
+                {"owner", entry.owner},
+                {"vcpus", entry.vcpus},
+                {"memory", entry.memory},
+                {"storage", entry.storage}
+            });
+        }
+    }
+
+    return {
+        {"cpus", info.cpus},
+        {"memoryBytes", static_cast<unsigned long long>(info.memory) * 1024},
+        {"freeMemoryBytes", freeMemory},
+        {"cpuTotal", cpuTotal},
+        {"cpuIdle", cpuIdle},
+        {"committedVcpus", vcpus},
+        {"committedMemoryBytes", memory},
+        {"freeDiskBytes", StorageBackend(conn).availableBytes(IMAGES_DIR)},
+        {"owners", owners},
+        {"domains", domains},
+        {"vms", vms}
+    };
+}
+
+void HostStats::fill(HostState& state, const json& data, CpuCounters& previous) {
+    state.reachable = true;
+    state.cpus = data["cpus"];
+    state.memoryBytes = data["memoryBytes"];
+    state.freeMemoryBytes = data["freeMemoryBytes"];
+    state.committedVcpus = data["committedVcpus"];
+    state.committedMemoryBytes = data["committedMemoryBytes"];
+    state.freeDiskBytes = data["freeDiskBytes"];
+    for (const auto& owner : data["owners"].items()) {
+        state.vmsByOwner[owner.key()] = owner.value();
+    }
+    state.updated = getCurrentTimeMs();
+
+    CpuCounters now{data["cpuTotal"], data["cpuIdle"]};
+    if (previous.total > 0 && now.total > previous.total && now.idle >= previous.idle) {
+        double busy = 1.0 - static_cast<double>(now.idle - previous.idle) /
+                            static_cast<double>(now.total - previous.total);
+        state.cpuLoad = std::min(std::max(busy, 0.0), 1.0);
+    }
+    previous = now;
+}
+
+void HostStats::run() {
+    while (running) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(REFRESH_INTERVAL_MS),
+                          [this]() { return !running; });
+        }
+        if (!running) break;
+        refresh();
+    }
+}
+
+// Same fan-out as the placement refresh; an unreachable host is listed
+// with reachable=false and nothing else
+void HostStats::refresh() {
+    HostResult local;
+    local.host = HostRegistry::LOCAL_HOST;
+    auto measured = HostRegistry::instance().gather(
+        [](virConnectPtr hostConn) { return measure(hostConn, false); },
+        [&]() {
+            try {
+                local.data = measure(conn, true);
+                local.ok = true;
+            } catch (const std::exception& e) {
+                local.error = e.what();
+            }
+        },
+        REFRESH_TIMEOUT_MS);
+    measured.insert(measured.begin(), std::move(local));
+
+    std::vector<HostState> fresh;
+    for (const auto& result : measured) {
+        HostState state;
+        state.name = result.host;
+        if (result.ok) {
+            fill(state, result.data, cpuCounters[state.name]);
+        }
+        fresh.push_back(std::move(state));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    hosts = std::move(fresh);
+}
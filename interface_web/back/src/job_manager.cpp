@@ -0,0 +1,354 @@
+#include "../include/job_manager.hpp"
+#include "../include/utils.hpp"
+#include "../include/metrics.hpp"
+
+#include <cstdio>
+#include <exception>
+
+namespace {
+
+// Job executed by the current worker thread, empty outside of jobs
+thread_local std::string currentJobId;
+
+} // namespace
+
+std::string jobStateToString(JobState state) {
+    switch (state) {
+        case JobState::Queued: return "queued";
+        case JobState::Running: return "running";
+        case JobState::Succeeded: return "succeeded";
+        case JobState::Failed: return "failed";
+    }
+    return "unknown";
+}
+
+json jobToJson(const Job& job) {
+    long long now = getCurrentTimeMs();
+
+    json steps = json::array();
+    for (const auto& step : job.steps) {
+        long long end = step.finishedAt ? step.finishedAt : now;
+        json entry = {
+            {"name", step.name},
+            {"state", jobStateToString(step.state)},
+            {"startedAt", step.startedAt},
+            {"finishedAt", step.finishedAt ? json(step.finishedAt) : json(nullptr)},
+            {"durationMs", end - step.startedAt}
+        };
+        if (step.progressTotal > 0) {
+            entry["progress"] = {
+                {"done", step.progressDone},
+                {"total", step.progressTotal},
+                {"unit", step.progressUnit},
+                {"percent", step.progressDone * 100 / step.progressTotal}
+            };
+        }
+        steps.push_back(entry);
+    }
+
+    json result = {
+        {"id", job.id},
+        {"type", job.type},
+        {"owner", job.owner},
+        {"target", job.target},
+        {"state", jobStateToString(job.state)},
+        {"createdAt", job.createdAt},
+        {"startedAt", job.startedAt ? json(job.startedAt) : json(nullptr)},
+        {"finishedAt", job.finishedAt ? json(job.finishedAt) : json(nullptr)},
+        {"steps", steps}
+    };
+
+    if (job.startedAt) {
+        long long end = job.finishedAt ? job.finishedAt : now;
+        result["durationMs"] = end - job.startedAt;
+    }
+    if (!job.error.empty()) {
+        result["error"] = job.error;
+    }
+    if (!job.result.is_null()) {
+        result["result"] = job.result;
+    }
+
+    return result;
+}
+
+JobManager& JobManager::instance() {
+    static JobManager manager;
+    return manager;
+}
+
+void JobManager::start(size_t workerCount) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (running) return;
+    if (workerCount == 0) workerCount = 1;
+
+    running = true;
+    for (size_t i = 0; i < workerCount; i++) {
+        workers.emplace_back(&JobManager::workerLoop, this);
+    }
+
+    fprintf(stdout, "Job manager started (%zu workers)\n", workerCount);
+}
+
+void JobManager::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running) return;
+        running = false;
+    }
+    cv.notify_all();
+
+    // Jobs already running are allowed to finish; queued ones are dropped
+    for (auto& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+    workers.clear();
+}
+
+std::string JobManager::submit(const std::string& type, const std::string& owner,
+                               const std::string& target, JobFunction fn) {
+    std::string id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running || pending.size() >= MAX_PENDING) {
+            return "";
+        }
+
+        long long now = getCurrentTimeMs();
+        pruneFinished(now);
+        id = enqueue(type, owner, target, std::move(fn), now);
+    }
+    cv.notify_one();
+    return id;
+}
+
+std::vector<std::string> JobManager::submitAll(const std::string& type, const std::string& owner,
+                                               std::vector<JobRequest> requests) {
+    std::vector<std::string> ids;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running || pending.size() + requests.size() > MAX_PENDING) {
+            return ids;
+        }
+
+        long long now = getCurrentTimeMs();
+        pruneFinished(now);
+        for (auto& request : requests) {
+            ids.push_back(enqueue(type, owner, request.target, std::move(request.fn), now));
+        }
+    }
+    cv.notify_all();
+    return ids;
+}
+
+std::string JobManager::enqueue(const std::string& type, const std::string& owner,
+                                const std::string& target, JobFunction fn, long long now) {
+    std::string id = type + "-" + std::to_string(now) + "-" + std::to_string(++nextId);
+
+    Job job;
+    job.id = id;
+    job.type = type;
+    job.owner = owner;
+    job.target = target;
+    job.createdAt = now;
+    jobs[id] = std::move(job);
+
+    pending.emplace_back(id, std::move(fn));
+    return id;
+}
+
+bool JobManager::get(const std::string& id, Job& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = jobs.find(id);
+    if (it == jobs.end()) return false;
+    out = it->second;
+    return true;
+}
+
+std::vector<Job> JobManager::listByOwner(const std::string& owner) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Job> result;
+    for (const auto& [id, job] : jobs) {
+        if (job.owner == owner) {
+            result.push_back(job);
+        }
+    }
+    return result;
+}
+
+void JobManager::beginStep(const std::string& name) {
+    if (currentJobId.empty()) return;
+
+    auto& self = instance();
+    std::lock_guard<std::mutex> lock(self.mutex);
+    auto it = self.jobs.find(currentJobId);
+    if (it == self.jobs.end()) return;
+
+    long long now = getCurrentTimeMs();
+    self.closeOpenStep(it->second, JobState::Succeeded, now);
+
+    JobStep step;
+    step.name = name;
+    step.startedAt = now;
+    it->second.steps.push_back(step);
+}
+
+void JobManager::endStep() {
+    if (currentJobId.empty()) return;
+
+    auto& self = instance();
+    std::lock_guard<std::mutex> lock(self.mutex);
+    auto it = self.jobs.find(currentJobId);
+    if (it == self.jobs.end()) return;
+
+    self.closeOpenStep(it->second, JobState::Succeeded, getCurrentTimeMs());
+}
+
+void JobManager::reportProgress(long long done, long long total, const std::string& unit) {
+    if (currentJobId.empty()) return;
+
+    auto& self = instance();
+    std::lock_guard<std::mutex> lock(self.mutex);
+    auto it = self.jobs.find(currentJobId);
+    if (it == self.jobs.end() || it->second.steps.empty()) return;
+
+    JobStep& step = it->second.steps.back();
+    if (step.finishedAt != 0) return;
+
+    step.progressDone = done;
+    step.progressTotal = total;
+    step.progressUnit = unit;
+}
+
+std::string JobManager::suspend(JobFunction next) {
+    if (currentJobId.empty()) return "";
+
+    auto& self = instance();
+    std::lock_guard<std::mutex> lock(self.mutex);
+    self.suspended[currentJobId].next = std::move(next);
+    return currentJobId;
+}
+
+void JobManager::resume(const std::string& id) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = suspended.find(id);
+        if (it == suspended.end()) return;
+
+        if (!it->second.returned) {
+            it->second.resumed = true;
+            return;
+        }
+        pending.emplace_front(id, std::move(it->second.next));
+        suspended.erase(it);
+    }
+    cv.notify_one();
+}
+
+void JobManager::closeOpenStep(Job& job, JobState state, long long now) {
+    if (job.steps.empty()) return;
+
+    JobStep& last = job.steps.back();
+    if (last.finishedAt == 0) {
+        last.state = state;
+        last.finishedAt = now;
+        Metrics::instance().observeJobStep(job.type, last.name, state == JobState::Succeeded,
+                                           (now - last.startedAt) / 1000.0);
+    }
+}
+
+void JobManager::pruneFinished(long long now) {
+    for (auto it = jobs.begin(); it != jobs.end();) {
+        const Job& job = it->second;
+        bool finished = job.state == JobState::Succeeded || job.state == JobState::Failed;
+        if (finished && now - job.finishedAt > FINISHED_RETENTION_MS) {
+            it = jobs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void JobManager::workerLoop() {
+    while (true) {
+        std::pair<std::string, JobFunction> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return !running || !pending.empty(); });
+            if (!running) return;
+
+            task = std::move(pending.front());
+            pending.pop_front();
+        }
+
+        runJob(task.first, task.second);
+    }
+}
+
+void JobManager::runJob(const std::string& id, JobFunction& fn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = jobs.find(id);
+        if (it == jobs.end()) return;
+        it->second.state = JobState::Running;
+        // A resumed job keeps its original start
+        if (it->second.startedAt == 0) {
+            it->second.startedAt = getCurrentTimeMs();
+        }
+    }
+
+    currentJobId = id;
+
+    json result;
+    bool success = false;
+    std::string error;
+    try {
+        success = fn(result);
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+
+    currentJobId.clear();
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    auto parked = suspended.find(id);
+    if (parked != suspended.end()) {
+        if (success) {
+            if (!parked->second.resumed) {
+                parked->second.returned = true;
+                return;
+            }
+            pending.emplace_front(id, std::move(parked->second.next));
+            suspended.erase(parked);
+            lock.unlock();
+            cv.notify_one();
+            return;
+        }
+        suspended.erase(parked);
+    }
+
+    auto it = jobs.find(id);
+    if (it == jobs.end()) return;
+
+    Job& job = it->second;
+    long long now = getCurrentTimeMs();
+    job.finishedAt = now;
+    job.result = result;
+
+    if (success) {
+        closeOpenStep(job, JobState::Succeeded, now);
+        job.state = JobState::Succeeded;
+    } else {
+        closeOpenStep(job, JobState::Failed, now);
+        job.state = JobState::Failed;
+        if (error.empty()) {
+            error = job.steps.empty() ? "Job failed"
+                                      : "Step '" + job.steps.back().name + "' failed";
+        }
+        job.error = error;
+    }
+
+    fprintf(stdout, "Job %s %s in %lld ms\n", id.c_str(),
+            jobStateToString(job.state).c_str(), job.finishedAt - job.startedAt);
+}
@@ -6,12 +6,35 @@
 #include "../include/cors.hpp"
 #include "../include/utils.hpp"
 #include "../include/definitions.hpp"
+#include "../include/event_loop.hpp"
+#include "../include/domain_inventory.hpp"
+#include "../include/stats_sampler.hpp"
+#include "../include/stats_stream.hpp"
+#include "../include/job_manager.hpp"
+#include "../include/ssh_session.hpp"
+#include "../include/warm_pool.hpp"
+#include "../include/user_store.hpp"
+#include "../include/connection_pool.hpp"
+#include "../include/host_registry.hpp"
+#include "../include/placement.hpp"
+#include "../include/host_stats.hpp"
+#include "../include/metrics.hpp"
 
 using namespace httplib;
 
 int main() {
     std::cout << "Starting libvirt C++ server..." << std::endl;
     
+    // The event loop must be registered before the connection is opened
+    if (!LibvirtEvents::startEventLoop()) {
+        std::cerr << "Domain events unavailable, falling back to direct libvirt queries" << std::endl;
+    }
+    
+    // Users and quotas are served from memory; changes go to a journal
+    if (!UserStore::instance().open()) {
+        std::cerr << "User store is read-only: changes to users will fail" << std::endl;
+    }
+    
     // Initialize libvirt manager
     LibvirtManager manager;
     
@@ -25,21 +48,93 @@ int main() {
     
     std::cout << "Connected to libvirt successfully" << std::endl;
     
+    // Request handlers check out their own connections to the same URI;
+    // the shared one above carries events and background work
+    char* uri = virConnectGetURI(manager.getConnection());
+    if (uri) {
+        ConnectionPool::instance().start(uri, ConnectionPool::sizeFromEnvironment());
+        free(uri);
+    }
+    
+    // Additional hypervisors (THOTH_HOSTS) merged into listings and system info
+    HostRegistry::instance().start(HostRegistry::hostsFromEnvironment());
+    
+    // In-memory domain inventory, kept current by lifecycle events
+    if (LibvirtEvents::isRunning() && !DomainInventory::instance().start(manager.getConnection())) {
+        std::cerr << "Domain inventory unavailable, falling back to direct libvirt queries" << std::endl;
+    }
+    
+    // Node state of every host for /metrics
+    HostStats::instance().start(manager.getConnection());
+    
+    // Capacity checks for each deployment from cached host state (opt-in, THOTH_PLACEMENT)
+    PlacementConfig placementConfig = PlacementConfig::fromEnvironment();
+    if (placementConfig.enabled) {
+        PlacementEngine::instance().start(manager.getConnection(), placementConfig);
+    }
+    
+    // Background stats collection; handlers read the latest samples from memory
+    StatsSampler sampler(manager.getConnection());
+    sampler.setOnSampled([]() { StatsBroadcaster::instance().publish(); });
+    sampler.start();
+    
     // Initialize VM operations
     VMOperations vmOps(manager.getConnection());
     
+    // Workers for long-running operations such as deployments
+    JobManager::instance().start();
+    
+    // Pre-booted VMs that deployments can claim (THOTH_WARM_POOL)
+    WarmPool::instance().start(manager.getConnection(), WarmPool::flavorsFromEnvironment());
+    
+    // Reopen the shared connection if it drops and move its users over;
+    // jobs and request handlers pick up the new one on their next call
+    SharedConnection::instance().start(manager.getConnection(), [&sampler, placementConfig](virConnectPtr conn) {
+        DomainInventory::instance().stop();
+        if (!DomainInventory::instance().start(conn)) {
+            std::cerr << "Domain inventory unavailable after reconnecting" << std::endl;
+        }
+        
+        sampler.stop();
+        sampler.setConnection(conn);
+        sampler.start();
+        
+        HostStats::instance().stop();
+        HostStats::instance().start(conn);
+        
+        if (placementConfig.enabled) {
+            PlacementEngine::instance().stop();
+            PlacementEngine::instance().start(conn, placementConfig);
+        }
+        
+        WarmPool::instance().stop();
+        WarmPool::instance().start(conn, WarmPool::flavorsFromEnvironment());
+    });
+    
     // Initialize API routes
     APIRoutes apiRoutes(&vmOps, &manager);
     
     // Create HTTP server
     Server svr;
     
+    // Every open stats stream holds a worker for its whole lifetime,
+    // so reserve room for them on top of the regular request workers
+    svr.new_task_queue = [] {
+        return new ThreadPool(CPPHTTPLIB_THREAD_POOL_COUNT + StatsBroadcaster::MAX_SUBSCRIBERS);
+    };
+    
     // Setup CORS middleware
     cors::setupMiddleware(svr);
     
     // Setup API routes
     apiRoutes.setup(svr);
     
+    // Live stats over Server-Sent Events
+    setupStatsStream(svr);
+    
+    // Prometheus metrics at /metrics; also times every request
+    setupMetrics(svr);
+    
     // Serve static files if front directory exists
     if (fileExists("../../front")) {
         svr.set_mount_point("/", "../../front");
@@ -52,6 +147,21 @@ int main() {
     // Start server
     svr.listen("0.0.0.0", PORT);
     
+    // No more reconnects while everything shuts down
+    SharedConnection::instance().stop();
+    StatsBroadcaster::instance().shutdown();
+    JobManager::instance().stop();
+    WarmPool::instance().stop();
+    PlacementEngine::instance().stop();
+    HostStats::instance().stop();
+    ConnectionPool::instance().stop();
+    HostRegistry::instance().stop();
+    RemoteExec::SSHSession::instance().closeAll();
+    sampler.stop();
+    DomainInventory::instance().stop();
+    LibvirtEvents::stopEventLoop();
+    UserStore::instance().close();
+    
     // Cleanup happens automatically via destructor
     
     return 0;
@@ -0,0 +1,484 @@
+#include "../include/metrics.hpp"
+#include "../include/stats_store.hpp"
+#include "../include/host_stats.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+const double REQUEST_BOUNDS[] = {0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+const double LIBVIRT_BOUNDS[] = {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05,
+                                 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+const double STEP_BOUNDS[] = {0.1, 0.5, 1, 2.5, 5, 10, 30, 60, 120, 300, 600, 1800};
+
+template <size_t N>
+constexpr size_t countOf(const double (&)[N]) { return N; }
+
+const char* const LIBVIRT_CALL_NAMES[] = {
+    "virConnectOpen",
+    "virConnectGetAllDomainStats",
+    "virDomainListGetStats",
+    "virNodeGetInfo",
+    "virNodeGetCPUStats",
+    "virNodeGetFreeMemory",
+    "virDomainLookupByName",
+    "virDomainGetXMLDesc",
+    "virDomainDefineXML",
+    "virDomainCreate",
+    "virDomainShutdown",
+    "virDomainDestroy",
+    "virDomainSnapshotCreateXML",
+    "virDomainSnapshotLookupByName",
+    "virDomainListAllSnapshots",
+    "virDomainRevertToSnapshot",
+    "virDomainSnapshotDelete"
+};
+static_assert(sizeof(LIBVIRT_CALL_NAMES) / sizeof(LIBVIRT_CALL_NAMES[0]) ==
+              static_cast<size_t>(LibvirtCall::Count), "a name per LibvirtCall");
+
+const char* const CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+
+// Set by the pre-routing handler; the logger runs on the same worker thread
+thread_local std::chrono::steady_clock::time_point requestStarted;
+
+// The helpers below append in place, so a warm buffer renders without
+// allocating
+
+void appendUnsigned(std::string& out, unsigned long long value) {
+    char buffer[24];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+void appendDouble(std::string& out, double value) {
+    // Byte counts and the like print exactly, not in exponent form
+    if (value >= 0 && value < 9007199254740992.0 && value == std::floor(value)) {
+        appendUnsigned(out, static_cast<unsigned long long>(value));
+        return;
+    }
+
+    char buffer[32];
+    int length = snprintf(buffer, sizeof(buffer), "%.9g", value);
+    out.append(buffer, length);
+}
+
+void appendEscaped(std::string& out, const std::string& value) {
+    for (char c : value) {
+        switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '"': out += "\\\""; break;
+            case '\n': out += "\\n"; break;
+            default: out += c;
+        }
+    }
+}
+
+void appendLabel(std::string& out, const char* name, const std::string& value) {
+    if (!out.empty() && out.back() != '{') out += ',';
+    out += name;
+    out += "=\"";
+    appendEscaped(out, value);
+    out += '"';
+}
+
+void appendFamily(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+// {labels} and the space before the value; nothing for no labels
+void appendLabels(std::string& out, const std::string& labels) {
+    if (!labels.empty()) {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+}
+
+void appendName(std::string& out, const char* name, const std::string& labels) {
+    out += name;
+    appendLabels(out, labels);
+}
+
+void appendSample(std::string& out, const char* name, const std::string& labels, double value) {
+    appendName(out, name, labels);
+    appendDouble(out, value);
+    out += '\n';
+}
+
+void appendSample(std::string& out, const char* name, const std::string& labels,
+                  unsigned long long value) {
+    appendName(out, name, labels);
+    appendUnsigned(out, value);
+    out += '\n';
+}
+
+// vm="..." followed by an optional second label, e.g. device="vda"
+void appendVMSample(std::string& out, const char* name, const std::string& vm,
+                    const char* label, const std::string& value, unsigned long long sample) {
+    out += name;
+    out += "{vm=\"";
+    appendEscaped(out, vm);
+    out += '"';
+    if (label) {
+        out += ',';
+        out += label;
+        out += "=\"";
+        appendEscaped(out, value);
+        out += '"';
+    }
+    out += "} ";
+    appendUnsigned(out, sample);
+    out += '\n';
+}
+
+} // namespace
+
+// ========================================
+// HISTOGRAM
+// ========================================
+
+Histogram::Histogram(const double* bounds, size_t size)
+    : bounds(bounds), size(size), buckets(new std::atomic<unsigned long long>[size + 1]) {
+    for (size_t i = 0; i <= size; i++) {
+        buckets[i] = 0;
+    }
+}
+
+void Histogram::observe(double seconds) {
+    size_t bucket = 0;
+    while (bucket < size && seconds > bounds[bucket]) {
+        bucket++;
+    }
+
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    sumMicros.fetch_add(static_cast<unsigned long long>(std::llround(std::max(seconds, 0.0) * 1e6)),
+                        std::memory_order_relaxed);
+}
+
+void Histogram::render(std::string& out, const char* name, const std::string& labels) const {
+    // Buckets are summed here rather than kept cumulative, so observing
+    // touches a single bucket. _count is the running total, which keeps
+    // it equal to the +Inf bucket within one scrape.
+    unsigned long long cumulative = 0;
+
+    for (size_t i = 0; i <= size; i++) {
+        cumulative += buckets[i].load(std::memory_order_relaxed);
+
+        out += name;
+        out += "_bucket{";
+        if (!labels.empty()) {
+            out += labels;
+            out += ',';
+        }
+        out += "le=\"";
+        if (i < size) {
+            appendDouble(out, bounds[i]);
+        } else {
+            out += "+Inf";
+        }
+        out += "\"} ";
+        appendUnsigned(out, cumulative);
+        out += '\n';
+    }
+
+    out += name;
+    out += "_sum";
+    appendLabels(out, labels);
+    appendDouble(out, sumMicros.load(std::memory_order_relaxed) / 1e6);
+    out += '\n';
+
+    out += name;
+    out += "_count";
+    appendLabels(out, labels);
+    appendUnsigned(out, cumulative);
+    out += '\n';
+}
+
+// ========================================
+// METRICS
+// ========================================
+
+Metrics::RouteSeries::RouteSeries(std::string rendered)
+    : labels(std::move(rendered)), latency(REQUEST_BOUNDS, countOf(REQUEST_BOUNDS)) {}
+
+Metrics::StepSeries::StepSeries(std::string rendered)
+    : labels(std::move(rendered)), duration(STEP_BOUNDS, countOf(STEP_BOUNDS)) {}
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics() {
+    for (auto& histogram : libvirt) {
+        histogram = std::make_unique<Histogram>(LIBVIRT_BOUNDS, countOf(LIBVIRT_BOUNDS));
+    }
+}
+
+void Metrics::observeRequest(const std::string& method, const std::string& route,
+                             int status, double seconds) {
+    std::string key = method + ' ' + route;
+    RouteSeries* series = nullptr;
+
+    {
+        std::shared_lock<std::shared_mutex> lock(routesMutex);
+        auto it = routes.find(key);
+        if (it != routes.end()) series = it->second.get();
+    }
+
+    if (!series) {
+        std::string labels;
+        appendLabel(labels, "method", method);
+        appendLabel(labels, "route", route);
+
+        std::unique_lock<std::shared_mutex> lock(routesMutex);
+        auto& slot = routes[key];
+        if (!slot) slot = std::make_unique<RouteSeries>(std::move(labels));
+        series = slot.get();
+    }
+
+    series->latency.observe(seconds);
+    if (status >= 100 && status < 600) {
+        series->responses[status / 100 - 1].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::observeLibvirt(LibvirtCall call, double seconds) {
+    libvirt[static_cast<size_t>(call)]->observe(seconds);
+}
+
+void Metrics::observeJobStep(const std::string& job, const std::string& step,
+                             bool succeeded, double seconds) {
+    std::string key = job + '\n' + step;
+    StepSeries* series = nullptr;
+
+    {
+        std::shared_lock<std::shared_mutex> lock(stepsMutex);
+        auto it = steps.find(key);
+        if (it != steps.end()) series = it->second.get();
+    }
+
+    if (!series) {
+        std::string labels;
+        appendLabel(labels, "job", job);
+        appendLabel(labels, "step", step);
+
+        std::unique_lock<std::shared_mutex> lock(stepsMutex);
+        auto& slot = steps[key];
+        if (!slot) slot = std::make_unique<StepSeries>(std::move(labels));
+        series = slot.get();
+    }
+
+    series->duration.observe(seconds);
+    if (!succeeded) {
+        series->failures.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Metrics::serve(httplib::Response& res) {
+    std::lock_guard<std::mutex> lock(renderMutex);
+
+    output.clear();
+    renderVMs();
+    renderHosts();
+    renderRequests();
+    renderLibvirt();
+    renderJobSteps();
+
+    res.set_content(output.data(), output.size(), CONTENT_TYPE);
+}
+
+// One pass over the stats store fills every per-VM family at once;
+// the exposition format wants each family's samples together
+void Metrics::renderVMs() {
+    for (auto& family : vmFamilies) {
+        family.clear();
+    }
+
+    appendFamily(vmFamilies[0], "thoth_vm_cpu_percent", "gauge",
+                 "CPU use over the last sample interval, in percent of one host CPU");
+    appendFamily(vmFamilies[1], "thoth_vm_memory_used_bytes", "gauge", "Memory in use by the guest");
+    appendFamily(vmFamilies[2], "thoth_vm_memory_max_bytes", "gauge", "Memory assigned to the guest");
+    appendFamily(vmFamilies[3], "thoth_vm_disk_read_bytes_total", "counter", "Bytes read per disk");
+    appendFamily(vmFamilies[4], "thoth_vm_disk_written_bytes_total", "counter", "Bytes written per disk");
+    appendFamily(vmFamilies[5], "thoth_vm_network_receive_bytes_total", "counter",
+                 "Bytes received per interface");
+    appendFamily(vmFamilies[6], "thoth_vm_network_transmit_bytes_total", "counter",
+                 "Bytes sent per interface");
+
+    StatsStore::instance().forEachLatest([this](const std::string& vm, const StatsPoint& point) {
+        std::string& cpu = vmFamilies[0];
+        cpu += "thoth_vm_cpu_percent{vm=\"";
+        appendEscaped(cpu, vm);
+        cpu += "\"} ";
+        appendDouble(cpu, point.cpuPercent);
+        cpu += '\n';
+
+        appendVMSample(vmFamilies[1], "thoth_vm_memory_used_bytes", vm, nullptr, vm, point.memoryUsed * 1024);
+        appendVMSample(vmFamilies[2], "thoth_vm_memory_max_bytes", vm, nullptr, vm, point.memoryMax * 1024);
+
+        for (const auto& disk : point.disks) {
+            appendVMSample(vmFamilies[3], "thoth_vm_disk_read_bytes_total", vm, "device", disk.name, disk.readBytes);
+            appendVMSample(vmFamilies[4], "thoth_vm_disk_written_bytes_total", vm, "device", disk.name, disk.writeBytes);
+        }
+        for (const auto& nic : point.nics) {
+            appendVMSample(vmFamilies[5], "thoth_vm_network_receive_bytes_total", vm, "interface", nic.name, nic.rxBytes);
+            appendVMSample(vmFamilies[6], "thoth_vm_network_transmit_bytes_total", vm, "interface", nic.name, nic.txBytes);
+        }
+    });
+
+    for (const auto& family : vmFamilies) {
+        output += family;
+    }
+}
+
+// Host state as of the last HostStats refresh
+void Metrics::renderHosts() {
+    auto hosts = HostStats::instance().snapshot();
+    if (hosts.empty()) return;
+
+    std::string labels;
+    auto hostLabel = [&labels](const HostState& host) -> const std::string& {
+        labels.clear();
+        appendLabel(labels, "host", host.name);
+        return labels;
+    };
+
+    appendFamily(output, "thoth_host_up", "gauge", "Whether the last refresh reached the host");
+    for (const auto& host : hosts) {
+        appendSample(output, "thoth_host_up", hostLabel(host), host.reachable ? 1ULL : 0ULL);
+    }
+
+    struct Gauge {
+        const char* name;
+        const char* help;
+        double (*value)(const HostState&);
+    };
+    static const Gauge gauges[] = {
+        {"thoth_host_cpus", "Host CPUs",
+         [](const HostState& h) { return static_cast<double>(h.cpus); }},
+        {"thoth_host_cpu_load_ratio", "Busy fraction of the host CPUs between the last two refreshes",
+         [](const HostState& h) { return h.cpuLoad; }},
+        {"thoth_host_memory_bytes", "Host memory",
+         [](const HostState& h) { return static_cast<double>(h.memoryBytes); }},
+        {"thoth_host_memory_free_bytes", "Free host memory",
+         [](const HostState& h) { return static_cast<double>(h.freeMemoryBytes); }},
+        {"thoth_host_committed_vcpus", "vCPUs of every VM defined on the host",
+         [](const HostState& h) { return static_cast<double>(h.committedVcpus); }},
+        {"thoth_host_committed_memory_bytes", "Maximum memory of every VM defined on the host",
+         [](const HostState& h) { return static_cast<double>(h.committedMemoryBytes); }},
+        {"thoth_host_image_pool_free_bytes", "Free space on the VM image pool",
+         [](const HostState& h) { return static_cast<double>(h.freeDiskBytes); }}
+    };
+
+    for (const auto& gauge : gauges) {
+        appendFamily(output, gauge.name, "gauge", gauge.help);
+        for (const auto& host : hosts) {
+            // Nothing is known about a host that was not reached, and
+            // negative values mean unknown
+            double value = gauge.value(host);
+            if (!host.reachable || value < 0) continue;
+            appendSample(output, gauge.name, hostLabel(host), value);
+        }
+    }
+}
+
+void Metrics::renderRequests() {
+    static const char* const classes[] = {"1xx", "2xx", "3xx", "4xx", "5xx"};
+
+    std::shared_lock<std::shared_mutex> lock(routesMutex);
+    if (routes.empty()) return;
+
+    appendFamily(output, "thoth_http_requests_total", "counter", "HTTP requests by route and status class");
+    for (const auto& entry : routes) {
+        const RouteSeries& series = *entry.second;
+        for (size_t i = 0; i < series.responses.size(); i++) {
+            unsigned long long count = series.responses[i].load(std::memory_order_relaxed);
+            if (count == 0) continue;
+
+            output += "thoth_http_requests_total{";
+            output += series.labels;
+            output += ",code=\"";
+            output += classes[i];
+            output += "\"} ";
+            appendUnsigned(output, count);
+            output += '\n';
+        }
+    }
+
+    appendFamily(output, "thoth_http_request_duration_seconds", "histogram",
+                 "Time from routing to the response being sent");
+    for (const auto& entry : routes) {
+        entry.second->latency.render(output, "thoth_http_request_duration_seconds", entry.second->labels);
+    }
+}
+
+void Metrics::renderLibvirt() {
+    appendFamily(output, "thoth_libvirt_call_duration_seconds", "histogram", "Latency of libvirt calls");
+
+    std::string labels;
+    for (size_t i = 0; i < libvirt.size(); i++) {
+        labels.clear();
+        appendLabel(labels, "call", LIBVIRT_CALL_NAMES[i]);
+        libvirt[i]->render(output, "thoth_libvirt_call_duration_seconds", labels);
+    }
+}
+
+void Metrics::renderJobSteps() {
+    std::shared_lock<std::shared_mutex> lock(stepsMutex);
+    if (steps.empty()) return;
+
+    appendFamily(output, "thoth_job_step_duration_seconds", "histogram",
+                 "Duration of job steps (deploy, clone, delete, ...)");
+    for (const auto& entry : steps) {
+        entry.second->duration.render(output, "thoth_job_step_duration_seconds", entry.second->labels);
+    }
+
+    appendFamily(output, "thoth_job_step_failures_total", "counter", "Job steps that failed");
+    for (const auto& entry : steps) {
+        appendSample(output, "thoth_job_step_failures_total", entry.second->labels,
+                     entry.second->failures.load(std::memory_order_relaxed));
+    }
+}
+
+LibvirtTimer::~LibvirtTimer() {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+    Metrics::instance().observeLibvirt(call, elapsed.count());
+}
+
+void setupMetrics(httplib::Server& svr) {
+    svr.set_pre_routing_handler([](const httplib::Request&, httplib::Response&) {
+        requestStarted = std::chrono::steady_clock::now();
+        return httplib::Server::HandlerResponse::Unhandled;
+    });
+
+    // Called once the response is written, including for errors
+    svr.set_logger([](const httplib::Request& req, const httplib::Response& res) {
+        // Requests rejected before routing were never timed
+        if (requestStarted == std::chrono::steady_clock::time_point()) return;
+
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - requestStarted;
+        requestStarted = std::chrono::steady_clock::time_point();
+
+        // Unmatched paths and static files share one series
+        static const std::string other = "other";
+        const std::string& route = req.matched_route.empty() ? other : req.matched_route;
+        Metrics::instance().observeRequest(req.method, route, res.status, elapsed.count());
+    });
+
+    svr.Get("/metrics", [](const httplib::Request&, httplib::Response& res) {
+        Metrics::instance().serve(res);
+    });
+}
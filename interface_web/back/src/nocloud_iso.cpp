@@ -0,0 +1,353 @@
+#include "../include/nocloud_iso.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <set>
+
+namespace CloudInit {
+
+namespace {
+
+constexpr size_t SECTOR = 2048;
+
+// Fixed layout: system area, PVD, Joliet SVD, terminator, then the four
+// path tables (L/M for each hierarchy), one sector each
+constexpr uint32_t PVD_SECTOR = 16;
+constexpr uint32_t SVD_SECTOR = 17;
+constexpr uint32_t TERMINATOR_SECTOR = 18;
+constexpr uint32_t PRIMARY_L_TABLE = 19;
+constexpr uint32_t PRIMARY_M_TABLE = 20;
+constexpr uint32_t JOLIET_L_TABLE = 21;
+constexpr uint32_t JOLIET_M_TABLE = 22;
+constexpr uint32_t FIRST_FREE_SECTOR = 23;
+
+// A path table holding only the root directory
+constexpr uint32_t PATH_TABLE_SIZE = 10;
+
+void put16LE(std::string& buf, size_t off, uint16_t v) {
+    buf[off] = static_cast<char>(v & 0xff);
+    buf[off + 1] = static_cast<char>(v >> 8);
+}
+
+void put16BE(std::string& buf, size_t off, uint16_t v) {
+    buf[off] = static_cast<char>(v >> 8);
+    buf[off + 1] = static_cast<char>(v & 0xff);
+}
+
+void put32LE(std::string& buf, size_t off, uint32_t v) {
+    for (int i = 0; i < 4; i++) buf[off + i] = static_cast<char>((v >> (8 * i)) & 0xff);
+}
+
+void put32BE(std::string& buf, size_t off, uint32_t v) {
+    for (int i = 0; i < 4; i++) buf[off + i] = static_cast<char>((v >> (8 * (3 - i))) & 0xff);
+}
+
+// ISO9660 "both-endian" fields: little-endian copy followed by big-endian
+void putBoth16(std::string& buf, size_t off, uint16_t v) {
+    put16LE(buf, off, v);
+    put16BE(buf, off + 2, v);
+}
+
+void putBoth32(std::string& buf, size_t off, uint32_t v) {
+    put32LE(buf, off, v);
+    put32BE(buf, off + 4, v);
+}
+
+// Space-padded ASCII field
+void putText(std::string& buf, size_t off, size_t len, const std::string& text) {
+    for (size_t i = 0; i < len; i++) {
+        buf[off + i] = i < text.size() ? text[i] : ' ';
+    }
+}
+
+// UCS-2 big-endian, space-padded field (Joliet)
+void putUcs2(std::string& buf, size_t off, size_t len, const std::string& text) {
+    for (size_t i = 0; i + 1 < len; i += 2) {
+        size_t c = i / 2;
+        buf[off + i] = 0;
+        buf[off + i + 1] = c < text.size() ? text[c] : ' ';
+    }
+    if (len % 2) buf[off + len - 1] = 0;
+}
+
+std::string toUcs2(const std::string& ascii) {
+    std::string out;
+    out.reserve(ascii.size() * 2);
+    for (unsigned char c : ascii) {
+        out += '\0';
+        out += static_cast<char>(c < 0x80 ? c : '_');
+    }
+    return out;
+}
+
+size_t sectorsFor(size_t bytes) {
+    return (bytes + SECTOR - 1) / SECTOR;
+}
+
+// Level 1 identifier: 8.3, d-characters only, version ";1"
+std::string primaryName(const std::string& name, std::set<std::string>& used) {
+    auto clean = [](const std::string& part, size_t max) {
+        std::string out;
+        for (unsigned char c : part) {
+            if (out.size() == max) break;
+            char u = static_cast<char>(std::toupper(c));
+            out += (std::isalnum(static_cast<unsigned char>(u)) && c < 0x80) ? u : '_';
+        }
+        return out;
+    };
+
+    size_t dot = name.rfind('.');
+    std::string base = clean(dot == std::string::npos ? name : name.substr(0, dot), 8);
+    std::string ext = clean(dot == std::string::npos ? "" : name.substr(dot + 1), 3);
+    if (base.empty()) base = "_";
+
+    std::string id = base + "." + ext + ";1";
+    for (int n = 1; used.count(id) && n < 10; n++) {
+        base = base.substr(0, 7) + std::to_string(n);
+        id = base + "." + ext + ";1";
+    }
+    used.insert(id);
+    return id;
+}
+
+struct Timestamps {
+    char record[7];     // directory record format
+    std::string volume; // 17-byte volume descriptor format
+};
+
+Timestamps currentTime() {
+    std::time_t now = std::time(nullptr);
+    std::tm utc{};
+    gmtime_r(&now, &utc);
+
+    Timestamps ts;
+    ts.record[0] = static_cast<char>(utc.tm_year);
+    ts.record[1] = static_cast<char>(utc.tm_mon + 1);
+    ts.record[2] = static_cast<char>(utc.tm_mday);
+    ts.record[3] = static_cast<char>(utc.tm_hour);
+    ts.record[4] = static_cast<char>(utc.tm_min);
+    ts.record[5] = static_cast<char>(utc.tm_sec);
+    ts.record[6] = 0;   // GMT offset
+
+    // Bounded fields, so the digits always fit (and -Wformat-truncation agrees)
+    char digits[32];
+    snprintf(digits, sizeof(digits), "%04u%02u%02u%02u%02u%02u00",
+             static_cast<unsigned>(utc.tm_year + 1900) % 10000u,
+             static_cast<unsigned>(utc.tm_mon + 1) % 100u,
+             static_cast<unsigned>(utc.tm_mday) % 100u,
+             static_cast<unsigned>(utc.tm_hour) % 100u,
+             static_cast<unsigned>(utc.tm_min) % 100u,
+             static_cast<unsigned>(utc.tm_sec) % 100u);
+    ts.volume = std::string(digits, 16) + std::string(1, '\0');
+    return ts;
+}
+
+std::string dirRecord(const std::string& fileId, uint32_t extent, uint32_t size,
+                      bool directory, const Timestamps& ts) {
+    size_t length = 33 + fileId.size();
+    if (length % 2) length++;
+
+    std::string rec(length, '\0');
+    rec[0] = static_cast<char>(length);
+    putBoth32(rec, 2, extent);
+    putBoth32(rec, 10, size);
+    std::copy(ts.record, ts.record + 7, rec.begin() + 18);
+    rec[25] = directory ? 2 : 0;
+    putBoth16(rec, 28, 1);
+    rec[32] = static_cast<char>(fileId.size());
+    std::copy(fileId.begin(), fileId.end(), rec.begin() + 33);
+    return rec;
+}
+
+// Records may not straddle a sector boundary
+size_t directorySize(const std::vector<size_t>& recordSizes) {
+    size_t sectors = 1, used = 0;
+    for (size_t size : recordSizes) {
+        if (used + size > SECTOR) {
+            sectors++;
+            used = 0;
+        }
+        used += size;
+    }
+    return sectors * SECTOR;
+}
+
+std::string packDirectory(const std::vector<std::string>& records, size_t size) {
+    std::string out;
+    out.reserve(size);
+    size_t used = 0;
+    for (const auto& rec : records) {
+        if (used + rec.size() > SECTOR) {
+            out.append(SECTOR - used, '\0');
+            used = 0;
+        }
+        out += rec;
+        used += rec.size();
+    }
+    out.append(size - out.size(), '\0');
+    return out;
+}
+
+struct Hierarchy {
+    std::vector<std::pair<std::string, size_t>> entries;   // file id, index into files
+    uint32_t extent = 0;
+    uint32_t size = 0;
+};
+
+Hierarchy makeHierarchy(std::vector<std::pair<std::string, size_t>> entries) {
+    std::sort(entries.begin(), entries.end());
+
+    std::vector<size_t> sizes = {34, 34};   // "." and ".."
+    for (const auto& entry : entries) {
+        size_t length = 33 + entry.first.size();
+        sizes.push_back(length + (length % 2));
+    }
+
+    Hierarchy h;
+    h.entries = std::move(entries);
+    h.size = static_cast<uint32_t>(directorySize(sizes));
+    return h;
+}
+
+std::string writeDirectory(const Hierarchy& h, const std::vector<SeedFile>& files,
+                           const std::vector<uint32_t>& fileExtents, const Timestamps& ts) {
+    std::vector<std::string> records;
+    records.push_back(dirRecord(std::string(1, '\0'), h.extent, h.size, true, ts));
+    records.push_back(dirRecord(std::string(1, '\1'), h.extent, h.size, true, ts));
+    for (const auto& [id, index] : h.entries) {
+        records.push_back(dirRecord(id, fileExtents[index],
+                                    static_cast<uint32_t>(files[index].data.size()), false, ts));
+    }
+    return packDirectory(records, h.size);
+}
+
+std::string pathTable(uint32_t rootExtent, bool bigEndian) {
+    std::string table(SECTOR, '\0');
+    table[0] = 1;   // identifier length
+    if (bigEndian) {
+        put32BE(table, 2, rootExtent);
+        put16BE(table, 6, 1);
+    } else {
+        put32LE(table, 2, rootExtent);
+        put16LE(table, 6, 1);
+    }
+    return table;
+}
+
+std::string volumeDescriptor(bool joliet, const std::string& volumeId, uint32_t totalSectors,
+                             const Hierarchy& root, const Timestamps& ts) {
+    std::string vd(SECTOR, '\0');
+    vd[0] = joliet ? 2 : 1;
+    putText(vd, 1, 5, "CD001");
+    vd[6] = 1;
+
+    auto text = joliet ? putUcs2 : putText;
+    text(vd, 8, 32, "LINUX");
+    text(vd, 40, 32, volumeId);
+    putBoth32(vd, 80, totalSectors);
+
+    if (joliet) {
+        // UCS-2 level 3
+        vd[88] = '%';
+        vd[89] = '/';
+        vd[90] = 'E';
+    }
+
+    putBoth16(vd, 120, 1);
+    putBoth16(vd, 124, 1);
+    putBoth16(vd, 128, SECTOR);
+    putBoth32(vd, 132, PATH_TABLE_SIZE);
+    put32LE(vd, 140, joliet ? JOLIET_L_TABLE : PRIMARY_L_TABLE);
+    put32BE(vd, 148, joliet ? JOLIET_M_TABLE : PRIMARY_M_TABLE);
+
+    std::string rootRecord = dirRecord(std::string(1, '\0'), root.extent, root.size, true, ts);
+    std::copy(rootRecord.begin(), rootRecord.end(), vd.begin() + 156);
+
+    text(vd, 190, 128, "");
+    text(vd, 318, 128, "");
+    text(vd, 446, 128, "");
+    text(vd, 574, 128, "THOTH CLOUD");
+    text(vd, 702, 37, "");
+    text(vd, 739, 37, "");
+    text(vd, 776, 37, "");
+
+    std::copy(ts.volume.begin(), ts.volume.end(), vd.begin() + 813);
+    std::copy(ts.volume.begin(), ts.volume.end(), vd.begin() + 830);
+    putText(vd, 847, 16, "0000000000000000");
+    putText(vd, 864, 16, "0000000000000000");
+    vd[881] = 1;
+    return vd;
+}
+
+} // namespace
+
+std::string buildISO(const std::string& volumeId, const std::vector<SeedFile>& files) {
+    Timestamps ts = currentTime();
+
+    std::set<std::string> usedNames;
+    std::vector<std::pair<std::string, size_t>> primaryEntries, jolietEntries;
+    for (size_t i = 0; i < files.size(); i++) {
+        primaryEntries.emplace_back(primaryName(files[i].name, usedNames), i);
+        jolietEntries.emplace_back(toUcs2(files[i].name), i);
+    }
+
+    Hierarchy primary = makeHierarchy(std::move(primaryEntries));
+    Hierarchy joliet = makeHierarchy(std::move(jolietEntries));
+
+    primary.extent = FIRST_FREE_SECTOR;
+    joliet.extent = primary.extent + primary.size / SECTOR;
+
+    // Both hierarchies share the same file extents
+    std::vector<uint32_t> fileExtents;
+    uint32_t next = joliet.extent + joliet.size / SECTOR;
+    for (const auto& file : files) {
+        fileExtents.push_back(next);
+        next += static_cast<uint32_t>(sectorsFor(file.data.size()));
+    }
+    uint32_t totalSectors = next;
+
+    std::string iso;
+    iso.reserve(static_cast<size_t>(totalSectors) * SECTOR);
+    iso.append(PVD_SECTOR * SECTOR, '\0');
+
+    iso += volumeDescriptor(false, volumeId, totalSectors, primary, ts);
+    iso += volumeDescriptor(true, volumeId, totalSectors, joliet, ts);
+
+    std::string terminator(SECTOR, '\0');
+    terminator[0] = static_cast<char>(255);
+    putText(terminator, 1, 5, "CD001");
+    terminator[6] = 1;
+    iso += terminator;
+
+    iso += pathTable(primary.extent, false);
+    iso += pathTable(primary.extent, true);
+    iso += pathTable(joliet.extent, false);
+    iso += pathTable(joliet.extent, true);
+
+    iso += writeDirectory(primary, files, fileExtents, ts);
+    iso += writeDirectory(joliet, files, fileExtents, ts);
+
+    for (const auto& file : files) {
+        iso += file.data;
+        iso.append(sectorsFor(file.data.size()) * SECTOR - file.data.size(), '\0');
+    }
+
+    return iso;
+}
+
+std::string buildNoCloudSeed(const std::string& metaData, const std::string& userData,
+                             const std::string& networkConfig) {
+    std::vector<SeedFile> files = {
+        {"meta-data", metaData},
+        {"user-data", userData}
+    };
+    if (!networkConfig.empty()) {
+        files.push_back({"network-config", networkConfig});
+    }
+    return buildISO(NOCLOUD_VOLUME_ID, files);
+}
+
+} // namespace CloudInit
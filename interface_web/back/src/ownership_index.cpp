@@ -0,0 +1,61 @@
+#include "../include/ownership_index.hpp"
+
+#include <mutex>
+
+OwnershipIndex& OwnershipIndex::instance() {
+    static OwnershipIndex index;
+    return index;
+}
+
+void OwnershipIndex::assign(const std::string& vmName, const std::string& owner) {
+    if (owner.empty()) return;
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+
+    auto it = ownerByVM.find(vmName);
+    if (it != ownerByVM.end()) {
+        if (it->second == owner) return;
+
+        // Renamed into another owner's namespace (e.g. a claimed warm VM)
+        auto previous = vmsByOwner.find(it->second);
+        previous->second.erase(vmName);
+        if (previous->second.empty()) vmsByOwner.erase(previous);
+        it->second = owner;
+    } else {
+        ownerByVM.emplace(vmName, owner);
+    }
+    vmsByOwner[owner].insert(vmName);
+}
+
+void OwnershipIndex::release(const std::string& vmName) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+
+    auto it = ownerByVM.find(vmName);
+    if (it == ownerByVM.end()) return;
+
+    auto owned = vmsByOwner.find(it->second);
+    owned->second.erase(vmName);
+    if (owned->second.empty()) vmsByOwner.erase(owned);
+    ownerByVM.erase(it);
+}
+
+bool OwnershipIndex::ownerOf(const std::string& vmName, std::string& owner) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = ownerByVM.find(vmName);
+    if (it == ownerByVM.end()) return false;
+    owner = it->second;
+    return true;
+}
+
+std::vector<std::string> OwnershipIndex::vmsOf(const std::string& owner) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = vmsByOwner.find(owner);
+    if (it == vmsByOwner.end()) return {};
+    return std::vector<std::string>(it->second.begin(), it->second.end());
+}
+
+void OwnershipIndex::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    ownerByVM.clear();
+    vmsByOwner.clear();
+}
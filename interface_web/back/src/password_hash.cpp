@@ -0,0 +1,117 @@
+#include "../include/password_hash.hpp"
+
+#include <algorithm>
+#include <crypt.h>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+
+namespace PasswordHash {
+
+namespace {
+
+constexpr size_t SALT_LENGTH = 16;
+constexpr size_t MAX_POOL_THREADS = 4;
+
+const char SALT_CHARS[] = "./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+std::string randomSalt() {
+    unsigned char bytes[SALT_LENGTH];
+    std::ifstream urandom("/dev/urandom", std::ios::binary);
+    if (!urandom.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) {
+        // Should never happen on Linux; still avoid a predictable salt
+        std::random_device rd;
+        for (auto& b : bytes) b = static_cast<unsigned char>(rd());
+    }
+
+    std::string salt;
+    for (unsigned char b : bytes) {
+        salt += SALT_CHARS[b % 64];
+    }
+    return salt;
+}
+
+} // namespace
+
+std::string sha512Crypt(const std::string& password) {
+    std::string setting = "$6$rounds=" + std::to_string(SHA512_ROUNDS) + "$" + randomSalt() + "$";
+
+    // crypt_data is tens of KB; keep it off the stack
+    auto data = std::make_unique<struct crypt_data>();
+    data->initialized = 0;
+
+    const char* hash = crypt_r(password.c_str(), setting.c_str(), data.get());
+
+    // Failures return NULL or a string starting with '*'
+    if (!hash || hash[0] != '$') {
+        fprintf(stderr, "crypt_r failed to hash password\n");
+        return "";
+    }
+    return hash;
+}
+
+HashPool& HashPool::instance() {
+    static HashPool pool(std::min<size_t>(MAX_POOL_THREADS,
+                                          std::max(1u, std::thread::hardware_concurrency())));
+    return pool;
+}
+
+HashPool::HashPool(size_t threads) {
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back(&HashPool::workerLoop, this);
+    }
+}
+
+HashPool::~HashPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+std::future<std::string> HashPool::submit(const std::string& password) {
+    std::packaged_task<std::string()> task([password]() { return sha512Crypt(password); });
+    auto future = task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    cv.notify_one();
+    return future;
+}
+
+std::vector<std::string> HashPool::hashAll(const std::vector<std::string>& passwords) {
+    std::vector<std::future<std::string>> futures;
+    futures.reserve(passwords.size());
+    for (const auto& password : passwords) {
+        futures.push_back(submit(password));
+    }
+
+    std::vector<std::string> hashes;
+    hashes.reserve(passwords.size());
+    for (auto& future : futures) {
+        hashes.push_back(future.get());
+    }
+    return hashes;
+}
+
+void HashPool::workerLoop() {
+    while (true) {
+        std::packaged_task<std::string()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace PasswordHash
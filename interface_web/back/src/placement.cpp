@@ -0,0 +1,393 @@
+#include "../include/placement.hpp"
+#include "../include/host_registry.hpp"
+#include "../include/domain_inventory.hpp"
+#include "../include/usage_tracker.hpp"
+#include "../include/utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+
+long long numberField(const json& body, const char* key) {
+    auto it = body.find(key);
+    if (it == body.end() || !it->is_number()) return 0;
+    return std::max(0LL, it->get<long long>());
+}
+
+const char* policyName(PlacementPolicy policy) {
+    return policy == PlacementPolicy::BinPack ? "binpack" : "spread";
+}
+
+} // namespace
+
+PlacementConfig PlacementConfig::fromEnvironment() {
+    PlacementConfig result;
+
+    const char* config = getenv("THOTH_PLACEMENT");
+    if (!config) return result;
+    result.enabled = true;
+
+    std::stringstream entries(config);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        size_t eq = entry.find('=');
+        if (eq == std::string::npos) {
+            fprintf(stderr, "Placement: ignoring malformed entry '%s'\n", entry.c_str());
+            continue;
+        }
+
+        std::string key = entry.substr(0, eq);
+        std::string value = entry.substr(eq + 1);
+
+        if (key == "policy" && (value == "binpack" || value == "spread")) {
+            result.policy = value == "binpack" ? PlacementPolicy::BinPack : PlacementPolicy::Spread;
+        } else if (key == "cpu_ratio" && strtod(value.c_str(), nullptr) > 0) {
+            result.cpuOvercommit = strtod(value.c_str(), nullptr);
+        } else if (key == "ram_ratio" && strtod(value.c_str(), nullptr) > 0) {
+            result.memoryOvercommit = strtod(value.c_str(), nullptr);
+        } else if (key == "anti_affinity") {
+            result.ownerAntiAffinity = value != "0";
+        } else {
+            fprintf(stderr, "Placement: ignoring '%s'\n", entry.c_str());
+        }
+    }
+
+    return result;
+}
+
+PlacementRequest PlacementRequest::fromDeployBody(const json& body) {
+    PlacementRequest request;
+    request.owner = body.value("owner", "");
+    request.vcpus = static_cast<unsigned int>(numberField(body, "vcpus"));
+    request.memoryBytes = numberField(body, "memory") * 1024ULL * 1024;
+    // Same headroom as the deploy preflight
+    request.diskBytes = (numberField(body, "disk") + 1) * 1024ULL * 1024 * 1024;
+    return request;
+}
+
+PlacementEngine& PlacementEngine::instance() {
+    static PlacementEngine engine;
+    return engine;
+}
+
+void PlacementEngine::start(virConnectPtr localConnection, const PlacementConfig& configured) {
+    if (running || !localConnection) return;
+
+    conn = localConnection;
+    config = configured;
+    running = true;
+
+    // Deploys right after startup already see real host state
+    refresh();
+
+    refresher = std::thread(&PlacementEngine::run, this);
+
+    fprintf(stdout, "Placement: %s policy, %.1fx vCPU and %.1fx memory overcommit, "
+                    "owner anti-affinity %s\n",
+            policyName(config.policy), config.cpuOvercommit, config.memoryOvercommit,
+            config.ownerAntiAffinity ? "on" : "off");
+}
+
+void PlacementEngine::stop() {
+    if (!running) return;
+
+    running = false;
+    wake.notify_all();
+    if (refresher.joinable()) {
+        refresher.join();
+    }
+}
+
+int PlacementEngine::choose(const std::vector<HostState>& hosts, const PlacementRequest& request,
+                            const PlacementConfig& config, std::string& error) {
+    int best = -1;
+    double bestScore = 0;
+    unsigned int bestOwned = 0;
+    size_t reachable = 0, noCpu = 0, noMemory = 0, noDisk = 0;
+
+    for (size_t i = 0; i < hosts.size(); i++) {
+        const HostState& host = hosts[i];
+        if (!host.reachable || host.cpus == 0 || host.memoryBytes == 0) continue;
+        reachable++;
+
+        double cpuCapacity = host.cpus * config.cpuOvercommit;
+        double memoryCapacity = host.memoryBytes * config.memoryOvercommit;
+        double vcpus = host.committedVcpus + request.vcpus;
+        double memory = static_cast<double>(host.committedMemoryBytes + request.memoryBytes);
+
+        if (vcpus > cpuCapacity) { noCpu++; continue; }
+        if (memory > memoryCapacity) { noMemory++; continue; }
+        if (host.freeDiskBytes >= 0 &&
+            request.diskBytes > static_cast<unsigned long long>(host.freeDiskBytes)) {
+            noDisk++;
+            continue;
+        }
+
+        // How full the host is once the VM is on it: committed memory or
+        // memory actually in use, whichever is higher, vCPUs, and CPU load
+        double memoryInUse = 1.0 - (static_cast<double>(host.freeMemoryBytes) -
+                                    static_cast<double>(request.memoryBytes)) / host.memoryBytes;
+        double memoryUse = std::max(memory / memoryCapacity, std::min(memoryInUse, 1.0));
+        double score = 0.4 * memoryUse + 0.3 * (vcpus / cpuCapacity) + 0.3 * host.cpuLoad;
+        if (config.policy == PlacementPolicy::Spread) {
+            score = -score;
+        }
+
+        unsigned int owned = 0;
+        if (config.ownerAntiAffinity) {
+            auto it = host.vmsByOwner.find(request.owner);
+            if (it != host.vmsByOwner.end()) owned = it->second;
+        }
+
+        // Fewest VMs of the same owner first, then the policy's preference
+        if (best < 0 || owned < bestOwned || (owned == bestOwned && score > bestScore)) {
+            best = static_cast<int>(i);
+            bestScore = score;
+            bestOwned = owned;
+        }
+    }
+
+    if (best < 0) {
+        if (reachable == 0) {
+            error = "No hypervisor is available";
+        } else {
+            error = "No hypervisor has room for this VM (vCPUs full on " + std::to_string(noCpu) +
+                    ", memory on " + std::to_string(noMemory) +
+                    ", disk on " + std::to_string(noDisk) + " of " +
+                    std::to_string(reachable) + " host(s))";
+        }
+    }
+    return best;
+}
+
+bool PlacementEngine::place(const std::string& vmName, const PlacementRequest& request,
+                            std::string& host, std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    int index = choose(hosts, request, config, error);
+    if (index < 0) {
+        rejected++;
+        return false;
+    }
+
+    HostState& chosen = hosts[index];
+    reservations[vmName] = {chosen.name, request, 0, true, reserve(chosen, request)};
+    placed++;
+
+    host = chosen.name;
+    return true;
+}
+
+void PlacementEngine::finish(const std::string& vmName, bool deployed) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = reservations.find(vmName);
+    if (it == reservations.end()) return;
+
+    if (deployed) {
+        it->second.settledAt = getCurrentTimeMs();
+        return;
+    }
+
+    for (auto& host : hosts) {
+        if (host.name == it->second.host && it->second.counted) {
+            release(host, it->second.request, it->second.held);
+        }
+    }
+    reservations.erase(it);
+}
+
+json PlacementEngine::status() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    json list = json::array();
+    for (const auto& host : hosts) {
+        unsigned int vms = 0;
+        for (const auto& owner : host.vmsByOwner) {
+            vms += owner.second;
+        }
+
+        list.push_back({
+            {"name", host.name},
+            {"reachable", host.reachable},
+            {"cpus", host.cpus},
+            {"cpuLoad", host.cpuLoad},
+            {"memoryBytes", host.memoryBytes},
+            {"freeMemoryBytes", host.freeMemoryBytes},
+            {"committedVcpus", host.committedVcpus},
+            {"committedMemoryBytes", host.committedMemoryBytes},
+            {"freeDiskBytes", host.freeDiskBytes},
+            {"ownedVMs", vms},
+            {"updated", host.updated}
+        });
+    }
+
+    return {
+        {"enabled", running.load()},
+        {"policy", policyName(config.policy)},
+        {"cpuOvercommit", config.cpuOvercommit},
+        {"memoryOvercommit", config.memoryOvercommit},
+        {"ownerAntiAffinity", config.ownerAntiAffinity},
+        {"placed", placed},
+        {"rejected", rejected},
+        {"reservations", reservations.size()},
+        {"hosts", list}
+    };
+}
+
+void PlacementEngine::run() {
+    while (running) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait_for(lock, std::chrono::milliseconds(REFRESH_INTERVAL_MS),
+                          [this]() { return !running; });
+        }
+        if (!running) break;
+        refresh();
+    }
+}
+
+// Measures every host (in parallel, through HostRegistry) without the
+// lock, then swaps the new state in with the open reservations applied
+void PlacementEngine::refresh() {
+    long long started = getCurrentTimeMs();
+
+    HostResult local;
+    local.host = HostRegistry::LOCAL_HOST;
+    auto measured = HostRegistry::instance().gather(
+        [](virConnectPtr hostConn) { return HostStats::measure(hostConn, false); },
+        [&]() {
+            try {
+                local.data = HostStats::measure(conn, true);
+                local.ok = true;
+            } catch (const std::exception& e) {
+                local.error = e.what();
+            }
+        },
+        REFRESH_TIMEOUT_MS);
+    measured.insert(measured.begin(), std::move(local));
+
+    for (const auto& result : measured) {
+        if (result.ok && result.host != HostRegistry::LOCAL_HOST) {
+            trackHostVMs(result.host, result.data["vms"]);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Deploys that finished before this measurement started are in it
+    for (auto it = reservations.begin(); it != reservations.end();) {
+        if (it->second.settledAt > 0 && it->second.settledAt < started) {
+            it = reservations.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    std::vector<HostState> fresh;
+    for (const auto& result : measured) {
+        HostState state;
+        state.name = result.host;
+
+        bool wasReachable = false;
+        for (const auto& previous : hosts) {
+            if (previous.name == state.name) wasReachable = previous.reachable;
+        }
+
+        if (!result.ok) {
+            for (auto& reservation : reservations) {
+                if (reservation.second.host == state.name) reservation.second.counted = false;
+            }
+            if (wasReachable || hosts.empty()) {
+                fprintf(stderr, "Placement: host %s unavailable: %s\n",
+                        state.name.c_str(), result.error.c_str());
+            }
+            fresh.push_back(std::move(state));
+            continue;
+        }
+
+        const json& data = result.data;
+        HostStats::fill(state, data, cpuCounters[state.name]);
+
+        // VMs placed here whose domain this measurement did not see yet
+        std::unordered_set<std::string> domains(data["domains"].begin(), data["domains"].end());
+        for (auto& reservation : reservations) {
+            if (reservation.second.host != state.name) continue;
+            reservation.second.counted = !domains.count(reservation.first);
+            if (reservation.second.counted) {
+                reservation.second.held = reserve(state, reservation.second.request);
+            }
+        }
+
+        if (!wasReachable && !hosts.empty()) {
+            fprintf(stdout, "Placement: host %s available again\n", state.name.c_str());
+        }
+        fresh.push_back(std::move(state));
+    }
+
+    hosts = std::move(fresh);
+}
+
+// Usage of the VMs on a host without an inventory, as of this refresh.
+// A VM that answered is no longer pending in UsageTracker; one that
+// stopped answering is gone. Unreachable hosts keep what they had.
+void PlacementEngine::trackHostVMs(const std::string& host, const json& vms) {
+    std::unordered_set<std::string> seen;
+    for (const auto& vm : vms) {
+        DomainEntry entry;
+        entry.name = vm["name"];
+        entry.owner = vm["owner"];
+        entry.vcpus = vm["vcpus"];
+        entry.memory = vm["memory"];
+        entry.maxMemory = entry.memory;
+        entry.storage = vm["storage"];
+
+        UsageTracker::instance().update(entry.name, &entry);
+        UsageTracker::instance().release(entry.name);
+        HostRegistry::instance().assignVM(entry.name, host);
+        seen.insert(entry.name);
+    }
+
+    for (const auto& name : hostVMs[host]) {
+        if (!seen.count(name)) {
+            UsageTracker::instance().update(name, nullptr);
+            HostRegistry::instance().releaseVM(name);
+        }
+    }
+    hostVMs[host] = std::move(seen);
+}
+
+PlacementEngine::Held PlacementEngine::reserve(HostState& host, const PlacementRequest& request) {
+    Held held;
+    held.freeMemoryBytes = std::min(host.freeMemoryBytes, request.memoryBytes);
+    host.freeMemoryBytes -= held.freeMemoryBytes;
+    if (host.freeDiskBytes >= 0) {
+        held.diskBytes = std::min(host.freeDiskBytes, static_cast<long long>(request.diskBytes));
+        host.freeDiskBytes -= held.diskBytes;
+    }
+
+    host.committedVcpus += request.vcpus;
+    host.committedMemoryBytes += request.memoryBytes;
+    host.vmsByOwner[request.owner]++;
+    return held;
+}
+
+void PlacementEngine::release(HostState& host, const PlacementRequest& request, const Held& held) {
+    host.committedVcpus -= std::min(host.committedVcpus, request.vcpus);
+    host.committedMemoryBytes -= std::min(host.committedMemoryBytes, request.memoryBytes);
+    host.freeMemoryBytes += held.freeMemoryBytes;
+    if (host.freeDiskBytes >= 0) {
+        host.freeDiskBytes += held.diskBytes;
+    }
+
+    auto it = host.vmsByOwner.find(request.owner);
+    if (it != host.vmsByOwner.end() && --it->second == 0) {
+        host.vmsByOwner.erase(it);
+    }
+}
@@ -0,0 +1,261 @@
+#include "../include/preflight.hpp"
+#include "../include/remote_executor.hpp"
+#include "../include/ssh_session.hpp"
+#include "../include/utils.hpp"
+#include "../include/storage_backend.hpp"
+
+#include <cstdio>
+#include <sstream>
+
+namespace RemoteExec {
+
+namespace {
+
+// Where deployments put disks, on the target host
+const std::string DEPLOY_IMAGES_DIR = "/var/lib/libvirt/images";
+
+std::string requestKey(const PreflightRequest& request) {
+    std::string key;
+    for (const auto& dir : request.directories) key += "d:" + dir + "\n";
+    for (const auto& tool : request.tools) key += "t:" + tool + "\n";
+    key += "i:" + request.baseImage;
+    return key;
+}
+
+// Shell fragment printing `"<key>":true` or `"<key>":false`
+std::string boolCheck(const std::string& key, const std::string& test) {
+    return "printf '%s:%s' " + SSHSession::shellQuote(json(key).dump()) +
+           " \"$(" + test + " >/dev/null 2>&1 && echo true || echo false)\"";
+}
+
+std::string spaceCheck(const std::string& path) {
+    return "printf '\"space\":%s' \"$(df -B1 " + SSHSession::shellQuote(path) +
+           " 2>/dev/null | awk 'NR==2 {print $4}' | grep -E '^[0-9]+$' || echo -1)\"";
+}
+
+// Shell commands run one after the other, each printing one JSON member,
+// with a comma printed between them. `empty` stands in for no commands.
+std::string joinMembers(const std::vector<std::string>& parts, const std::string& empty) {
+    std::string joined;
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (i > 0) joined += "; printf ,; ";
+        joined += parts[i];
+    }
+    return joined.empty() ? empty : joined;
+}
+
+// Script printing one JSON object with every requested check
+std::string buildScript(const PreflightRequest& request, bool includeStatic) {
+    std::vector<std::string> sections;
+
+    if (includeStatic) {
+        std::vector<std::string> dirs;
+        for (const auto& dir : request.directories) {
+            dirs.push_back(boolCheck(dir, "test -d " + SSHSession::shellQuote(dir)));
+        }
+        std::vector<std::string> tools;
+        for (const auto& tool : request.tools) {
+            tools.push_back(boolCheck(tool, "command -v " + SSHSession::shellQuote(tool)));
+        }
+
+        std::string image = SSHSession::shellQuote(request.baseImage);
+        sections.push_back("printf '\"directories\":{'; " + joinMembers(dirs, "true") + "; printf '}'");
+        sections.push_back("printf '\"tools\":{'; " + joinMembers(tools, "true") + "; printf '}'");
+        sections.push_back(boolCheck("imageExists", "test -f " + image));
+        sections.push_back(boolCheck("imageValid", "qemu-img info " + image));
+    }
+
+    if (!request.spacePath.empty()) {
+        sections.push_back(spaceCheck(request.spacePath));
+    }
+
+    return "printf '{'; " + joinMembers(sections, "true") + "; printf '}'";
+}
+
+} // namespace
+
+json PreflightResult::toJson() const {
+    return {
+        {"completed", completed},
+        {"passed", passed()},
+        {"error", error},
+        {"missingDirectories", missingDirectories},
+        {"missingTools", missingTools},
+        {"baseImageExists", baseImageExists},
+        {"baseImageValid", baseImageValid},
+        {"availableBytes", availableBytes},
+        {"cached", cached}
+    };
+}
+
+PreflightChecker& PreflightChecker::instance() {
+    static PreflightChecker checker;
+    return checker;
+}
+
+void PreflightChecker::invalidate(const RemoteExecutor& executor) {
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.erase(executor.getHostInfo());
+}
+
+PreflightResult PreflightChecker::run(const RemoteExecutor& executor, const PreflightRequest& request) {
+    std::string host = executor.getHostInfo();
+    std::string key = requestKey(request);
+    long long now = getCurrentTimeMs();
+
+    PreflightResult result;
+    bool haveStatic = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = cache.find(host);
+        if (it != cache.end() && it->second.requestKey == key &&
+            now - it->second.checkedAt < CACHE_TTL_MS) {
+            result = it->second.result;
+            result.cached = true;
+            haveStatic = true;
+        }
+    }
+
+    // Free space came from the storage pool: nothing left to run remotely
+    if (haveStatic && request.spacePath.empty()) {
+        return result;
+    }
+
+    auto exec = executor.execute(buildScript(request, !haveStatic));
+
+    json output;
+    try {
+        output = json::parse(exec.output);
+    } catch (const std::exception& e) {
+        PreflightResult failed;
+        failed.error = "Preflight script failed: " + exec.output;
+        return failed;
+    }
+
+    if (!haveStatic) {
+        for (const auto& dir : request.directories) {
+            if (!output["directories"].value(dir, false)) {
+                result.missingDirectories.push_back(dir);
+            }
+        }
+        for (const auto& tool : request.tools) {
+            if (!output["tools"].value(tool, false)) {
+                result.missingTools.push_back(tool);
+            }
+        }
+        result.baseImageExists = output.value("imageExists", false);
+        result.baseImageValid = result.baseImageExists && output.value("imageValid", false);
+        result.completed = true;
+    }
+
+    result.availableBytes = output.value("space", -1LL);
+
+    // Only cache a clean bill of health; failures are re-checked next time
+    if (!haveStatic && result.passed()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cache[host] = CacheEntry{key, result, now};
+    }
+
+    return result;
+}
+
+bool checkDeployTarget(virConnectPtr conn, const RemoteExecutor& executor, long long requiredBytes) {
+    fprintf(stdout, "\n🔍 Running preflight checks on target host...\n");
+
+    std::string baseImagePath = DEPLOY_BASE_IMAGE;
+
+    PreflightRequest preflightRequest;
+    preflightRequest.directories = {
+        "/var/lib/libvirt/images",
+        "/var/lib/libvirt/images/baseimg",
+        "/var/lib/libvirt/images/cloud-init-iso"
+    };
+    preflightRequest.tools = {
+        "qemu-img"
+    };
+    preflightRequest.baseImage = baseImagePath;
+
+    // Free space from the storage pool costs no extra remote command;
+    // fall back to df in the preflight script without a usable pool
+    StorageBackend storage(conn);
+    long long poolAvailableBytes = storage.availableBytes(DEPLOY_IMAGES_DIR);
+    if (poolAvailableBytes < 0) {
+        preflightRequest.spacePath = DEPLOY_IMAGES_DIR;
+    }
+
+    auto preflight = PreflightChecker::instance().run(executor, preflightRequest);
+
+    if (!preflight.completed) {
+        fprintf(stderr, "❌ %s\n", preflight.error.c_str());
+        return false;
+    }
+    if (preflight.cached) {
+        fprintf(stdout, "   (directories, tools and base image from recent check)\n");
+    }
+
+    if (!preflight.missingDirectories.empty()) {
+        fprintf(stderr, "❌ Required directories missing on target host:\n");
+        for (const auto& dir : preflight.missingDirectories) {
+            fprintf(stderr, "   - %s\n", dir.c_str());
+        }
+        fprintf(stderr, "\n💡 On the target host, run:\n");
+        fprintf(stderr, "   sudo mkdir -p /var/lib/libvirt/images/baseimg /var/lib/libvirt/images/cloud-init-iso\n");
+        fprintf(stderr, "   sudo chown -R libvirt-qemu:kvm /var/lib/libvirt/images\n");
+        return false;
+    }
+    fprintf(stdout, "✅ All required directories exist on target host\n");
+
+    if (!preflight.missingTools.empty()) {
+        fprintf(stderr, "❌ Required tools missing on target host:\n");
+        for (const auto& tool : preflight.missingTools) {
+            fprintf(stderr, "   - %s\n", tool.c_str());
+        }
+        fprintf(stderr, "\n💡 On the target host, install them:\n");
+        fprintf(stderr, "   sudo apt-get install -y qemu-utils\n");
+        return false;
+    }
+    fprintf(stdout, "✅ All required tools are installed on target host\n");
+
+    if (!preflight.baseImageExists) {
+        fprintf(stderr, "❌ Base image not found on target host: %s\n", baseImagePath.c_str());
+        fprintf(stderr, "\n📥 On the target host, download the base image:\n");
+        fprintf(stderr, "   cd /var/lib/libvirt/images/baseimg\n");
+        fprintf(stderr, "   sudo wget https://cloud-images.ubuntu.com/jammy/current/jammy-server-cloudimg-amd64.img \\\n");
+        fprintf(stderr, "        -O ubuntu-22.04-server-cloudimg-amd64.img\n");
+        fprintf(stderr, "\nOr run the setup script on the target host:\n");
+        fprintf(stderr, "   sudo bash setup-base-images.sh\n");
+        return false;
+    }
+
+    if (!preflight.baseImageValid) {
+        fprintf(stderr, "❌ Base image is corrupted or invalid: %s\n", baseImagePath.c_str());
+        fprintf(stderr, "   Re-download the image on the target host\n");
+        return false;
+    }
+
+    fprintf(stdout, "✅ Base image is valid: %s\n", baseImagePath.c_str());
+
+    long long availableBytes = poolAvailableBytes >= 0 ? poolAvailableBytes : preflight.availableBytes;
+
+    if (availableBytes < 0) {
+        fprintf(stdout, "⚠️  Could not verify disk space. Proceeding with deployment...\n");
+    } else if (availableBytes < requiredBytes) {
+        fprintf(stderr, "❌ Insufficient disk space on target host.\n");
+        fprintf(stderr, "   Required: %.2f GB\n", requiredBytes / (1024.0*1024.0*1024.0));
+        fprintf(stderr, "   Available: %.2f GB\n", availableBytes / (1024.0*1024.0*1024.0));
+        return false;
+    } else {
+        fprintf(stdout, "✅ Sufficient disk space available on target host\n");
+        fprintf(stdout, "   Available: %.2f GB\n", availableBytes / (1024.0*1024.0*1024.0));
+
+        // Warn if less than 10GB free after allocation
+        long long remainingBytes = availableBytes - requiredBytes;
+        if (remainingBytes < 10LL * 1024 * 1024 * 1024) {
+            fprintf(stdout, "⚠️  Warning: Less than 10GB will remain after allocation\n");
+        }
+    }
+
+    return true;
+}
+
+} // namespace RemoteExec
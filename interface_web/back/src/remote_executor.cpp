@@ -1,5 +1,6 @@
 #include "../include/remote_executor.hpp"
 #include "../include/utils.hpp"
+#include "../include/ssh_session.hpp"
 #include <sstream>
 #include <regex>
 #include <unistd.h>
@@ -10,61 +11,18 @@ namespace RemoteExec {
 RemoteExecutor::RemoteExecutor(virConnectPtr connection) : conn(connection) {
     isRemote = false;
     
-    if (!conn) return;
-    
-    // Get connection URI to determine if it's remote
-    char* uri = virConnectGetURI(conn);
-    if (uri) {
-        std::string uriStr(uri);
-        free(uri);
-        
-        // Check if URI contains SSH (qemu+ssh://user@host/system)
-        if (uriStr.find("qemu+ssh://") != std::string::npos) {
-            isRemote = true;
-            
-            // Extract user and host from URI
-            // Format: qemu+ssh://user@host/system or qemu+ssh://user@host/system?keyfile=/path
-            std::regex uriRegex(R"(qemu\+ssh://([^@]+)@([^/?]+))");
-            std::smatch matches;
-            
-            if (std::regex_search(uriStr, matches, uriRegex)) {
-                remoteUser = matches[1].str();
-                remoteHost = matches[2].str();
-            }
-            
-            // Extract SSH key file if specified in URI
-            std::regex keyRegex(R"(keyfile=([^&]+))");
-            if (std::regex_search(uriStr, matches, keyRegex)) {
-                sshKeyFile = matches[1].str();
-            } else {
-                // Try to find default SSH key
-                sshKeyFile = findDefaultSSHKey();
-            }
-        }
+    // Remote when the URI is qemu+ssh://user@host/system[?keyfile=...]
+    SSHTarget target;
+    if (resolveTarget(conn, target)) {
+        isRemote = true;
+        remoteUser = target.user;
+        remoteHost = target.host;
+        sshKeyFile = target.keyFile;
     }
 }
 
 std::string RemoteExecutor::findDefaultSSHKey() const {
-    // Check common SSH key locations
-    const char* home = getenv("HOME");
-    if (!home) {
-        return "";
-    }
-    
-    std::vector<std::string> possibleKeys = {
-        std::string(home) + "/.ssh/thoth_kvm_key",
-        std::string(home) + "/.ssh/id_rsa",
-        std::string(home) + "/.ssh/id_ed25519",
-    };
-    
-    for (const auto& keyPath : possibleKeys) {
-        struct stat buffer;
-        if (stat(keyPath.c_str(), &buffer) == 0) {
-            return keyPath;
-        }
-    }
-    
-    return "";
+    return RemoteExec::findDefaultSSHKey();
 }
 
 std::string RemoteExecutor::buildSSHCommand(const std::string& command) const {
@@ -72,26 +30,9 @@ std::string RemoteExecutor::buildSSHCommand(const std::string& command) const {
         return command;
     }
     
-    // Build SSH command with proper escaping and key authentication
-    std::stringstream ssh;
-    ssh << "ssh ";
-    
-    // Add SSH key if available
-    if (!sshKeyFile.empty()) {
-        ssh << "-i " << sshKeyFile << " ";
-    }
-    
-    // SSH options for non-interactive use
-    ssh << "-o StrictHostKeyChecking=no ";
-    ssh << "-o UserKnownHostsFile=/dev/null ";
-    ssh << "-o ConnectTimeout=10 ";
-    ssh << "-o BatchMode=yes ";  // Fail if password is required
-    ssh << "-o PasswordAuthentication=no ";  // Don't ask for password
-    
-    ssh << remoteUser << "@" << remoteHost << " ";
-    ssh << "'" << command << "'";
-    
-    return ssh.str();
+    // Runs over the shared multiplexed connection to this host
+    SSHTarget target{remoteUser, remoteHost, sshKeyFile};
+    return SSHSession::instance().buildCommand(target, command);
 }
 
 RemoteExecutor::ExecResult RemoteExecutor::execute(const std::string& command) const {
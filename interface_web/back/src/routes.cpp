@@ -2,7 +2,32 @@
 #include "../include/utils.hpp"
 #include "../include/user_operations.hpp"
 #include "../include/json.hpp"
+#include "../include/stats_store.hpp"
+#include "../include/job_manager.hpp"
+#include "../include/warm_pool.hpp"
+#include "../include/validation.hpp"
+#include "../include/remote_executor.hpp"
+#include "../include/preflight.hpp"
+#include "../include/bulk_power.hpp"
+#include "../include/vm_clone.hpp"
+#include "../include/ownership_index.hpp"
+#include "../include/connection_pool.hpp"
+#include "../include/host_registry.hpp"
+#include "../include/domain_inventory.hpp"
+#include "../include/placement.hpp"
+#include "../include/usage_tracker.hpp"
+#include "../include/password_hash.hpp"
+#include "../include/metrics.hpp"
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <sstream>
+#include <cctype>
+#include <stdexcept>
+#include <utility>
 
 using json = nlohmann::json;
 
@@ -29,10 +54,752 @@ UserContext getUserContext(const httplib::Request& req) {
 bool checkVMAccess(const std::string& vmName, const UserContext& userCtx) {
     if (userCtx.isAdmin) return true;
     
+    std::string owner;
+    if (OwnershipIndex::instance().ownerOf(vmName, owner)) {
+        return owner == userCtx.userId;
+    }
+    
     VMNameManager manager;
     return manager.isOwner(vmName, userCtx.userId);
 }
 
+// ACPI shutdown of a running or paused guest, as stopVMIfRunning does;
+// false if it is not up or the request failed
+static bool requestShutdown(virConnectPtr conn, const std::string& name) {
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
+    if (!domain) return false;
+    
+    virDomainInfo info;
+    bool sent = virDomainGetInfo(domain, &info) == 0 &&
+                (info.state == VIR_DOMAIN_RUNNING || info.state == VIR_DOMAIN_PAUSED) &&
+                timeLibvirt(LibvirtCall::DomainShutdown,
+                            [&] { return virDomainShutdown(domain); }) == 0;
+    virDomainFree(domain);
+    return sent;
+}
+
+// Power off a guest that ignored its shutdown request
+static void forceOff(virConnectPtr conn, const std::string& name) {
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
+    if (!domain) return;
+    
+    virDomainInfo info;
+    if (virDomainGetInfo(domain, &info) == 0 && info.state != VIR_DOMAIN_SHUTOFF) {
+        fprintf(stdout, "Graceful shutdown of %s timed out, forcing shutdown...\n", name.c_str());
+        timeLibvirt(LibvirtCall::DomainDestroy, [&] { return virDomainDestroy(domain); });
+    }
+    virDomainFree(domain);
+}
+
+// Host a VM lives on. Placement and its refreshes record the VMs of the
+// other hosts; one they have not seen yet (placement off, or defined out
+// of band) is looked for on those hosts once, then recorded.
+static std::string hostOfVM(const std::string& name) {
+    auto& registry = HostRegistry::instance();
+    std::string host = registry.hostOf(name);
+    if (host != HostRegistry::LOCAL_HOST || !registry.hasHosts()) return host;
+    
+    DomainEntry entry;
+    auto& inventory = DomainInventory::instance();
+    if (!inventory.isReady() || inventory.get(name, entry)) return host;
+    
+    auto found = registry.gather(
+        [name](virConnectPtr conn) {
+            virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                              [&] { return virDomainLookupByName(conn, name.c_str()); });
+            if (!domain) return json(false);
+            virDomainFree(domain);
+            return json(true);
+        },
+        []() {});
+    for (const auto& result : found) {
+        if (result.ok && result.data.get<bool>()) {
+            registry.assignVM(name, result.host);
+            return result.host;
+        }
+    }
+    return host;
+}
+
+// VMOperations on a pooled libvirt connection for the length of one
+// request. On the primary host it uses the shared connection while the
+// pool is off or has no connection free, and only waits for a pooled one
+// while the shared connection is down and being reopened. Given a VM, it
+// connects to the host that VM lives on.
+class RequestOps {
+public:
+    static constexpr long long SHARED_DOWN_WAIT_MS = 2000;
+    
+    RequestOps() { onPrimary(); }
+    
+    explicit RequestOps(const std::string& vmName) {
+        std::string host = hostOfVM(vmName);
+        if (host == HostRegistry::LOCAL_HOST) {
+            onPrimary();
+            return;
+        }
+        // Without a free connection the calls fail as on an unreachable host
+        remote = HostRegistry::instance().acquire(host, HostRegistry::QUERY_TIMEOUT_MS);
+        ops.emplace(remote.get());
+    }
+    
+    VMOperations* operator->() { return &*ops; }
+    
+private:
+    void onPrimary() {
+        lease = ConnectionPool::instance().acquire(0);
+        if (!lease && !SharedConnection::instance().isAlive()) {
+            lease = ConnectionPool::instance().acquire(SHARED_DOWN_WAIT_MS);
+        }
+        ops.emplace(lease ? lease.get() : SharedConnection::instance().get());
+    }
+    
+    ConnectionPool::Lease lease;
+    HostRegistry::Connection remote;
+    std::optional<VMOperations> ops;
+};
+
+// libvirt connection for a job working on host `host`: the shared one on
+// the primary host, one of its own on the others, since a job can hold
+// it for minutes and the host pools are sized for requests. Throws when
+// the host cannot be reached.
+class JobConnection {
+public:
+    explicit JobConnection(const std::string& host) {
+        if (host == HostRegistry::LOCAL_HOST) {
+            conn = SharedConnection::instance().get();
+            return;
+        }
+        std::string uri = HostRegistry::instance().uriOf(host);
+        if (!uri.empty()) {
+            LibvirtTimer timer(LibvirtCall::ConnectOpen);
+            owned = virConnectOpen(uri.c_str());
+        }
+        if (!owned) {
+            throw std::runtime_error("Cannot connect to host " + host);
+        }
+        conn = owned;
+    }
+    
+    ~JobConnection() {
+        if (owned) virConnectClose(owned);
+    }
+    
+    JobConnection(const JobConnection&) = delete;
+    JobConnection& operator=(const JobConnection&) = delete;
+    
+    virConnectPtr get() const { return conn; }
+    
+private:
+    virConnectPtr conn = nullptr;
+    virConnectPtr owned = nullptr;
+};
+
+// VMs on one of the HostRegistry hypervisors, shaped like the local
+// listing. Those hosts have no inventory or sampler, so this is one bulk
+// stats call and "stats" stays null. An empty `owner` lists every VM.
+static json listHostVMs(virConnectPtr conn, const std::string& owner) {
+    static const char* states[] = {"no state", "running", "blocked", "paused",
+                                   "shutdown", "shut off", "crashed", "pmsuspended"};
+    
+    std::vector<DomainStats::DomainSample> samples;
+    if (!DomainStats::collectAll(conn, samples, 0, VIR_DOMAIN_STATS_STATE |
+                                                   VIR_DOMAIN_STATS_BALLOON |
+                                                   VIR_DOMAIN_STATS_VCPU)) {
+        throw std::runtime_error("Error listing VMs");
+    }
+    
+    json vms = json::array();
+    for (const auto& sample : samples) {
+        DomainEntry entry = DomainInventory::makeEntry(sample);
+        if (!owner.empty() && entry.owner != owner) continue;
+        
+        vms.push_back({
+            {"id", entry.id},
+            {"name", entry.name},
+            {"displayName", entry.displayName},
+            {"owner", entry.owner.empty() ? "unknown" : entry.owner},
+            {"state", entry.state >= 0 && entry.state < 8 ? states[entry.state] : "unknown"},
+            {"running", entry.isRunning()},
+            {"stats", nullptr}
+        });
+    }
+    return vms;
+}
+
+// Node details of one HostRegistry hypervisor for /api/system/info
+static json hostNodeInfo(virConnectPtr conn) {
+    virNodeInfo nodeInfo;
+    unsigned long hvVersion = 0, libVersion = 0;
+    
+    if (virNodeGetInfo(conn, &nodeInfo) < 0 ||
+        virConnectGetVersion(conn, &hvVersion) < 0 ||
+        virConnectGetLibVersion(conn, &libVersion) < 0) {
+        throw std::runtime_error("Failed to get system info");
+    }
+    
+    return {
+        {"model", std::string(nodeInfo.model)},
+        {"memory", std::to_string(nodeInfo.memory) + " KB"},
+        {"cpus", nodeInfo.cpus},
+        {"mhz", std::to_string(nodeInfo.mhz) + " MHz"},
+        {"nodes", nodeInfo.nodes},
+        {"sockets", nodeInfo.sockets},
+        {"cores", nodeInfo.cores},
+        {"threads", nodeInfo.threads},
+        {"hypervisorVersion", hvVersion},
+        {"libvirtVersion", libVersion}
+    };
+}
+
+// Per-host outcome of a HostRegistry::gather() for a response
+static json hostSummary(const HostResult& host) {
+    json summary = {
+        {"name", host.host},
+        {"success", host.ok},
+        {"elapsedMs", host.elapsedMs}
+    };
+    if (!host.ok) {
+        summary["error"] = host.error;
+    }
+    return summary;
+}
+
+// Parse a history range such as "300", "90s", "15m" or "1h" into milliseconds.
+// Returns -1 when malformed.
+static long long parseRangeMs(const std::string& range) {
+    if (range.empty()) return -1;
+    
+    size_t digits = 0;
+    while (digits < range.size() && std::isdigit(static_cast<unsigned char>(range[digits]))) {
+        digits++;
+    }
+    if (digits == 0 || digits > 9) return -1;
+    
+    long long value = std::stoll(range.substr(0, digits));
+    std::string unit = range.substr(digits);
+    
+    if (unit.empty() || unit == "s") return value * 1000;
+    if (unit == "m") return value * 60 * 1000;
+    if (unit == "h") return value * 60 * 60 * 1000;
+    return -1;
+}
+
+static void handleGetVMStatsHistory(const httplib::Request& req, httplib::Response& res) {
+    std::string name = req.matches[1];
+    auto userCtx = getUserContext(req);
+    
+    if (!checkVMAccess(name, userCtx)) {
+        res.status = 403;
+        json error = {{"success", false}, {"error", "Access denied"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    std::string range = req.has_param("range") ? req.get_param_value("range") : "5m";
+    long long rangeMs = parseRangeMs(range);
+    
+    if (rangeMs <= 0) {
+        res.status = 400;
+        json error = {{"success", false}, {"error", "Invalid range (expected e.g. 300, 90s, 15m, 1h)"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    auto points = StatsStore::instance().history(name, getCurrentTimeMs() - rangeMs);
+    
+    json samples = json::array();
+    for (const auto& point : points) {
+        samples.push_back(statsToJson(point));
+    }
+    
+    json result = {
+        {"success", true},
+        {"name", name},
+        {"range", range},
+        {"count", samples.size()},
+        {"samples", samples}
+    };
+    
+    res.set_content(result.dump(), "application/json");
+}
+
+static void handleGetJob(const httplib::Request& req, httplib::Response& res) {
+    std::string id = req.matches[1];
+    auto userCtx = getUserContext(req);
+    
+    Job job;
+    // Unknown and foreign jobs look the same to non-admins
+    if (!JobManager::instance().get(id, job) || (!userCtx.isAdmin && job.owner != userCtx.userId)) {
+        res.status = 404;
+        json error = {{"success", false}, {"error", "Job not found"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    json result = {{"success", true}, {"job", jobToJson(job)}};
+    res.set_content(result.dump(), "application/json");
+}
+
+static void handleListJobs(const httplib::Request& req, httplib::Response& res) {
+    auto userCtx = getUserContext(req);
+    
+    if (userCtx.userId.empty()) {
+        res.status = 401;
+        json error = {{"success", false}, {"error", "User not authenticated"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    auto jobs = JobManager::instance().listByOwner(userCtx.userId);
+    std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) {
+        return a.createdAt > b.createdAt;
+    });
+    
+    json list = json::array();
+    for (const auto& job : jobs) {
+        list.push_back(jobToJson(job));
+    }
+    
+    json result = {{"success", true}, {"count", list.size()}, {"jobs", list}};
+    res.set_content(result.dump(), "application/json");
+}
+
+// Deployment job shared by single and batch deploys, on the host the
+// placement engine chose
+static JobManager::JobFunction makeDeployJob(const json& body,
+                                             const std::string& internalName,
+                                             const std::string& displayName,
+                                             const std::string& host) {
+    // Owned from submission on, so the owner can follow the job
+    OwnershipIndex::instance().assign(internalName, body.value("owner", ""));
+    
+    return [body, internalName, displayName, host](json& result) {
+        bool local = host == HostRegistry::LOCAL_HOST;
+        bool warm = false;
+        bool deployed = false;
+        
+        try {
+            // A pre-booted VM of the same size comes up in seconds; the
+            // warm pool only lives on the primary host
+            warm = local && WarmPool::instance().claim(body);
+            if (!warm) {
+                JobConnection conn(host);
+                deployed = VMOperations(conn.get()).deployVM(body);
+            }
+            deployed = deployed || warm;
+        } catch (...) {
+            PlacementEngine::instance().finish(internalName, false);
+            UsageTracker::instance().release(internalName);
+            OwnershipIndex::instance().release(internalName);
+            HostRegistry::instance().releaseVM(internalName);
+            throw;
+        }
+        
+        // A deployed VM now counts through its domain. Other hosts have
+        // no inventory: there the reservation stands until a placement
+        // refresh measures the VM.
+        if (local || !deployed) {
+            UsageTracker::instance().release(internalName);
+        }
+        PlacementEngine::instance().finish(internalName, deployed);
+        if (!deployed) {
+            OwnershipIndex::instance().release(internalName);
+            HostRegistry::instance().releaseVM(internalName);
+            return false;
+        }
+        result = {{"vmName", internalName}, {"displayName", displayName}, {"warm", warm}, {"host", host}};
+        return true;
+    };
+}
+
+// Host for a new VM and a reservation there. Without the placement
+// engine everything goes to the primary host; with it, to whichever
+// reachable host fits best, recorded so the VM's requests follow it.
+static bool placeVM(const std::string& internalName, const json& body,
+                    std::string& host, std::string& error) {
+    host = HostRegistry::LOCAL_HOST;
+    auto& placement = PlacementEngine::instance();
+    if (!placement.isRunning()) return true;
+    if (!placement.place(internalName, PlacementRequest::fromDeployBody(body), host, error)) {
+        return false;
+    }
+    HostRegistry::instance().assignVM(internalName, host);
+    return true;
+}
+
+// Held from the quota check until the reservations are recorded, so
+// deploys posted together cannot both fit in the same headroom
+static std::mutex quotaMutex;
+
+// Check a deploy of one VM per name in `vmNames` against the user's
+// quota and reserve it until each VM's job ends. Admins have no quota.
+// On refusal the 403 response is already set.
+static bool reserveQuota(virConnectPtr conn, const UserContext& userCtx, const json& body,
+                         const std::vector<std::string>& vmNames, httplib::Response& res) {
+    if (userCtx.isAdmin) return true;
+    
+    json request = body;
+    request["count"] = vmNames.size();
+    
+    std::lock_guard<std::mutex> lock(quotaMutex);
+    
+    UserOperations userOps(conn);
+    auto quotaCheck = userOps.checkUserQuota(userCtx.userId, request);
+    if (!quotaCheck["allowed"].get<bool>()) {
+        res.status = 403;
+        res.set_content(quotaCheck.dump(), "application/json");
+        return false;
+    }
+    
+    ResourceUsage usage;
+    usage.vms = 1;
+    usage.cpu = body["vcpus"].get<int>();
+    usage.ram = body["memory"].get<long long>();
+    usage.storage = body["disk"].get<long long>() * 1024 * 1024 * 1024;
+    for (const auto& name : vmNames) {
+        UsageTracker::instance().reserve(name, userCtx.userId, usage);
+    }
+    return true;
+}
+
+// Most identical VMs one batch request may ask for
+static constexpr int MAX_BATCH_SIZE = 20;
+
+// POST /api/vms/deploy/batch: `count` identical VMs named <hostname>-1..N.
+// Quota and host checks run once for the whole batch; the VMs are then
+// provisioned as separate jobs, in parallel up to the job worker count.
+static void handleDeployBatch(const httplib::Request& req, httplib::Response& res) {
+    virConnectPtr conn = SharedConnection::instance().get();
+    auto userCtx = getUserContext(req);
+    
+    if (userCtx.userId.empty()) {
+        res.status = 401;
+        json error = {{"success", false}, {"error", "User not authenticated"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    json body;
+    try {
+        body = json::parse(req.body);
+    } catch (const std::exception& e) {
+        res.status = 400;
+        json error = {{"success", false}, {"error", "Invalid JSON: " + std::string(e.what())}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    if (!body.contains("count") || !body["count"].is_number_integer()) {
+        res.status = 400;
+        json error = {{"success", false}, {"error", "count must be an integer"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    long long count = body["count"].get<long long>();
+    if (count < 1 || count > MAX_BATCH_SIZE) {
+        res.status = 400;
+        json error = {{"success", false},
+                      {"error", "count must be between 1 and " + std::to_string(MAX_BATCH_SIZE)}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    std::string baseHostname = body.value("hostname", "");
+    body.erase("preflightChecked");
+    body.erase("passwordHash");
+    
+    // Validate once, on the longest name of the batch
+    json sample = body;
+    sample["hostname"] = baseHostname + "-" + std::to_string(count);
+    auto validation = Validation::Validator::validateDeploymentParams(sample);
+    if (!validation.valid) {
+        res.status = 400;
+        json error = {{"success", false}, {"error", validation.error}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    body.erase("count");
+    body["owner"] = userCtx.userId;
+    body["ownerRole"] = userCtx.role;
+    body["preflightChecked"] = true;
+    
+    VMNameManager nameManager;
+    std::vector<std::string> names, displayNames, hosts;
+    for (int i = 1; i <= count; i++) {
+        std::string displayName = baseHostname + "-" + std::to_string(i);
+        displayNames.push_back(displayName);
+        names.push_back(nameManager.createVMName(userCtx.userId, displayName));
+    }
+    
+    // One quota reservation covers every VM of the batch
+    if (!reserveQuota(conn, userCtx, body, names, res)) {
+        return;
+    }
+    
+    auto unreserveAll = [&names]() {
+        for (const auto& name : names) {
+            PlacementEngine::instance().finish(name, false);
+            UsageTracker::instance().release(name);
+            HostRegistry::instance().releaseVM(name);
+        }
+    };
+    
+    // Reserve host room for every VM first, so the whole batch counts
+    // against the hosts' capacity, then check each chosen host once for
+    // all the disks it gets
+    for (const auto& name : names) {
+        std::string host, placementError;
+        if (!placeVM(name, body, host, placementError)) {
+            unreserveAll();
+            res.status = 503;
+            json error = {{"success", false}, {"error", placementError}};
+            res.set_content(error.dump(), "application/json");
+            return;
+        }
+        hosts.push_back(host);
+    }
+    
+    long long vmBytes = (body.value("disk", 0) + 1LL) * 1024 * 1024 * 1024;
+    std::vector<std::string> targets = hosts;
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+    for (const auto& target : targets) {
+        long long requiredBytes = vmBytes * std::count(hosts.begin(), hosts.end(), target);
+        bool ready = false;
+        try {
+            JobConnection hostConn(target);
+            RemoteExec::RemoteExecutor executor(hostConn.get());
+            ready = RemoteExec::checkDeployTarget(hostConn.get(), executor, requiredBytes);
+        } catch (const std::exception& e) {
+            fprintf(stderr, "%s\n", e.what());
+        }
+        if (!ready) {
+            unreserveAll();
+            res.status = 500;
+            json error = {{"success", false},
+                          {"error", "Target host " + target + " is not ready for deployment (see server log)"}};
+            res.set_content(error.dump(), "application/json");
+            return;
+        }
+    }
+    
+    // One hash per VM (each with its own salt), computed in parallel
+    // rather than one after the other inside the deploy jobs
+    std::vector<std::string> passwordHashes;
+    std::string password = body.value("password", "");
+    if (body.value("authMethod", "password") == "password" && !password.empty()) {
+        passwordHashes = PasswordHash::HashPool::instance().hashAll(
+            std::vector<std::string>(names.size(), password));
+        if (std::find(passwordHashes.begin(), passwordHashes.end(), "") != passwordHashes.end()) {
+            unreserveAll();
+            res.status = 500;
+            json error = {{"success", false}, {"error", "Failed to generate password hash"}};
+            res.set_content(error.dump(), "application/json");
+            return;
+        }
+    }
+    
+    std::vector<JobManager::JobRequest> requests;
+    json vms = json::array();
+    
+    for (size_t i = 0; i < names.size(); i++) {
+        json vmBody = body;
+        vmBody["hostname"] = names[i];
+        vmBody["displayName"] = displayNames[i];
+        if (!passwordHashes.empty()) {
+            vmBody["passwordHash"] = passwordHashes[i];
+        }
+        
+        requests.push_back({names[i], makeDeployJob(vmBody, names[i], displayNames[i], hosts[i])});
+        vms.push_back({{"vmName", names[i]}, {"displayName", displayNames[i]}, {"host", hosts[i]}});
+    }
+    
+    auto jobIds = JobManager::instance().submitAll("deploy", userCtx.userId, std::move(requests));
+    if (jobIds.empty()) {
+        unreserveAll();
+        for (const auto& vm : vms) {
+            OwnershipIndex::instance().release(vm["vmName"]);
+        }
+        res.status = 503;
+        json error = {{"success", false}, {"error", "Too many pending jobs, try again later"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    for (size_t i = 0; i < jobIds.size(); i++) {
+        vms[i]["jobId"] = jobIds[i];
+        vms[i]["statusUrl"] = "/api/jobs/" + jobIds[i];
+    }
+    
+    res.status = 202;
+    json result = {
+        {"success", true},
+        {"output", "Batch deployment of " + std::to_string(count) + " VM(s) initiated"},
+        {"count", count},
+        {"vms", vms}
+    };
+    res.set_content(result.dump(), "application/json");
+}
+
+// POST /api/vms/bulk/<action>: one power action on many VMs, either
+// listed by name ({"vms": [...]}) or picked by a selector
+// ({"selector": {"owner": "...", "state": "running"}}). Non-admins only
+// ever reach their own VMs.
+static void handleBulkPower(const httplib::Request& req, httplib::Response& res) {
+    std::string action = req.matches[1];
+    auto userCtx = getUserContext(req);
+    
+    if (userCtx.userId.empty()) {
+        res.status = 401;
+        json error = {{"success", false}, {"error", "User not authenticated"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    if (!BulkPower::isSupportedAction(action)) {
+        res.status = 400;
+        json error = {{"success", false}, {"error", "Unsupported action '" + action + "'"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    json body;
+    try {
+        body = json::parse(req.body);
+    } catch (const std::exception& e) {
+        res.status = 400;
+        json error = {{"success", false}, {"error", "Invalid JSON: " + std::string(e.what())}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    std::vector<std::string> names;
+    // Denied VMs with their position among the listed names
+    std::vector<std::pair<size_t, json>> denied;
+    
+    if (body.contains("vms") && body["vms"].is_array()) {
+        for (const auto& item : body["vms"]) {
+            if (!item.is_string()) continue;
+            std::string name = item;
+            if (checkVMAccess(name, userCtx)) {
+                names.push_back(name);
+            } else {
+                denied.emplace_back(names.size() + denied.size(),
+                                    json{{"name", name}, {"success", false}, {"error", "Access denied"}});
+            }
+        }
+    } else if (body.contains("selector") && body["selector"].is_object()) {
+        json selector = body["selector"];
+        std::string owner = userCtx.isAdmin ? selector.value("owner", "") : userCtx.userId;
+        std::string state = selector.value("state", "");
+        
+        // One owner's VMs come straight from the ownership index; the
+        // other hosts are listed meanwhile
+        json listing;
+        auto remote = HostRegistry::instance().gather(
+            [owner](virConnectPtr conn) { return listHostVMs(conn, owner); },
+            [&]() {
+                RequestOps ops;
+                listing = owner.empty() ? ops->listAllVMs() : ops->listUserVMs(owner);
+            });
+        json vms = listing.value("vms", json::array());
+        for (const auto& host : remote) {
+            if (!host.ok) continue;
+            for (const auto& vm : host.data) {
+                HostRegistry::instance().assignVM(vm["name"], host.host);
+                vms.push_back(vm);
+            }
+        }
+        
+        for (const auto& vm : vms) {
+            if (!owner.empty() && vm.value("owner", "") != owner) continue;
+            if (!state.empty() && vm.value("state", "") != state) continue;
+            names.push_back(vm["name"]);
+        }
+    } else {
+        res.status = 400;
+        json error = {{"success", false}, {"error", "Expected a 'vms' list or a 'selector' object"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    if (names.size() > BulkPower::MAX_VMS) {
+        res.status = 400;
+        json error = {{"success", false},
+                      {"error", "At most " + std::to_string(BulkPower::MAX_VMS) + " VMs per request"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    size_t concurrency = BulkPower::DEFAULT_CONCURRENCY;
+    if (body.contains("concurrency") && body["concurrency"].is_number_unsigned()) {
+        concurrency = std::min<size_t>(body["concurrency"].get<size_t>(), 32);
+    }
+    
+    // One connection per host for all the bulk threads
+    struct HostOps {
+        HostRegistry::Connection remote;
+        std::optional<VMOperations> ops;
+    };
+    std::map<std::string, HostOps> byHost;
+    std::vector<VMOperations*> ops;
+    for (const auto& name : names) {
+        std::string host = hostOfVM(name);
+        HostOps& hostOps = byHost[host];
+        if (!hostOps.ops) {
+            if (host == HostRegistry::LOCAL_HOST) {
+                hostOps.ops.emplace(SharedConnection::instance().get());
+            } else {
+                hostOps.remote = HostRegistry::instance().acquire(host, HostRegistry::QUERY_TIMEOUT_MS);
+                hostOps.ops.emplace(hostOps.remote.get());
+            }
+        }
+        ops.push_back(&*hostOps.ops);
+    }
+    
+    json outcome = BulkPower::run(ops, action, names, concurrency);
+    
+    // Results in the order the VMs were listed
+    json results = json::array();
+    auto next = denied.begin();
+    for (auto& entry : outcome["results"]) {
+        while (next != denied.end() && next->first == results.size()) {
+            results.push_back(std::move(next->second));
+            ++next;
+        }
+        results.push_back(std::move(entry));
+    }
+    for (; next != denied.end(); ++next) {
+        results.push_back(std::move(next->second));
+    }
+    
+    json result = {
+        {"success", true},
+        {"results", results},
+        {"summary", outcome["summary"]}
+    };
+    result["summary"]["denied"] = denied.size();
+    res.set_content(result.dump(), "application/json");
+}
+
+static void handleWarmPoolStatus(const httplib::Request& req, httplib::Response& res) {
+    auto userCtx = getUserContext(req);
+    
+    if (!userCtx.isAdmin) {
+        res.status = 403;
+        json error = {{"success", false}, {"error", "Access denied"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    res.set_content(WarmPool::instance().status().dump(), "application/json");
+}
+
 APIRoutes::APIRoutes(VMOperations* operations, LibvirtManager* mgr) 
     : vmOps(operations), manager(mgr) {}
 
@@ -58,11 +825,25 @@ void APIRoutes::setup(httplib::Server& svr) {
         this->handleGetVMStats(req, res);
     });
 
+    // VM stats history (served from the sampler's ring buffers)
+    svr.Get(R"(/api/vms/([^/]+)/stats/history)", [](const httplib::Request& req, httplib::Response& res) {
+        handleGetVMStatsHistory(req, res);
+    });
+
     // VM Create
     svr.Post(R"(/api/vms/deploy)", [this](const httplib::Request& req, httplib::Response& res) {
         this->handleDeployVM(req, res);
     });
     
+    svr.Post(R"(/api/vms/deploy/batch)", [this](const httplib::Request& req, httplib::Response& res) {
+        handleDeployBatch(req, res);
+    });
+    
+    // Power actions on many VMs at once
+    svr.Post(R"(/api/vms/bulk/([a-z]+))", [this](const httplib::Request& req, httplib::Response& res) {
+        handleBulkPower(req, res);
+    });
+    
     // VM control
     svr.Post(R"(/api/vms/([^/]+)/start)", [this](const httplib::Request& req, httplib::Response& res) {
         this->handleStartVM(req, res);
@@ -126,6 +907,20 @@ void APIRoutes::setup(httplib::Server& svr) {
         this->handleCloneVM(req, res);
     });
     
+    // Background jobs (deployments, ...)
+    svr.Get("/api/jobs", [](const httplib::Request& req, httplib::Response& res) {
+        handleListJobs(req, res);
+    });
+    
+    svr.Get(R"(/api/jobs/([^/]+))", [](const httplib::Request& req, httplib::Response& res) {
+        handleGetJob(req, res);
+    });
+    
+    // Pre-booted VMs for fast deployments (admin only)
+    svr.Get("/api/warm-pool", [](const httplib::Request& req, httplib::Response& res) {
+        handleWarmPoolStatus(req, res);
+    });
+    
     // System info
     svr.Get("/api/system/info", [this](const httplib::Request& req, httplib::Response& res) {
         this->handleSystemInfo(req, res);
@@ -157,11 +952,56 @@ void APIRoutes::setup(httplib::Server& svr) {
 void APIRoutes::handleListVMs(const httplib::Request& req, httplib::Response& res) {
     auto userCtx = getUserContext(req);
     
+    std::string owner = userCtx.isAdmin ? "" : userCtx.userId;
+    
+    // Other hypervisors are queried in parallel with the local listing
     json result;
-    if (userCtx.isAdmin) {
-        result = vmOps->listAllVMs();
-    } else {
-        result = vmOps->listUserVMs(userCtx.userId);
+    auto remote = HostRegistry::instance().gather(
+        [owner](virConnectPtr conn) { return listHostVMs(conn, owner); },
+        [&]() {
+            if (userCtx.isAdmin) {
+                result = RequestOps()->listAllVMs();
+            } else {
+                result = RequestOps()->listUserVMs(userCtx.userId);
+            }
+        });
+    
+    if (!remote.empty()) {
+        bool localOk = result.value("success", false);
+        json vms = localOk ? result["vms"] : json::array();
+        for (auto& vm : vms) {
+            vm["host"] = HostRegistry::LOCAL_HOST;
+        }
+        
+        json hosts = json::array();
+        json local = {{"name", HostRegistry::LOCAL_HOST}, {"success", localOk}};
+        if (!localOk) {
+            local["error"] = result.value("error", "Error listing VMs");
+        }
+        hosts.push_back(local);
+        
+        bool anyOk = localOk;
+        for (const auto& host : remote) {
+            hosts.push_back(hostSummary(host));
+            if (!host.ok) continue;
+            
+            anyOk = true;
+            for (json vm : host.data) {
+                vm["host"] = host.host;
+                vms.push_back(std::move(vm));
+            }
+        }
+        
+        // A node that is down only removes its own VMs from the listing
+        result = {
+            {"success", anyOk},
+            {"vms", vms},
+            {"totalCount", vms.size()},
+            {"hosts", hosts}
+        };
+        if (!anyOk) {
+            result["error"] = "Error listing VMs";
+        }
     }
     
     res.set_content(result.dump(), "application/json");
@@ -178,7 +1018,7 @@ void APIRoutes::handleGetVMInfo(const httplib::Request& req, httplib::Response&
         res.set_content(error.dump(), "application/json");
         return;
     }
-    json result = vmOps->getVMInfo(name);
+    json result = RequestOps(name)->getVMInfo(name);
     
     if (!result["success"].get<bool>()) {
         res.status = 404;
@@ -197,7 +1037,7 @@ void APIRoutes::handleGetVMStatus(const httplib::Request& req, httplib::Response
         res.set_content(error.dump(), "application/json");
         return;
     }
-    json result = vmOps->getVMStatus(name);
+    json result = RequestOps(name)->getVMStatus(name);
     
     if (!result["success"].get<bool>()) {
         res.status = 404;
@@ -217,7 +1057,7 @@ void APIRoutes::handleGetVMStats(const httplib::Request& req, httplib::Response&
         return;
     }
 
-    json result = vmOps->getVMStats(name);
+    json result = RequestOps(name)->getVMStats(name);
     
     if (!result["success"].get<bool>()) {
         res.status = 404;
@@ -237,7 +1077,7 @@ void APIRoutes::handleStartVM(const httplib::Request& req, httplib::Response& re
         return;
     }
 
-    bool success = vmOps->startVM(name);
+    bool success = RequestOps(name)->startVM(name);
     json result = {
         {"success", success},
         {"output", success ? "Domain started" : "Failed to start domain"}
@@ -263,21 +1103,75 @@ void APIRoutes::handleDeleteVM(const httplib::Request& req, httplib::Response& r
         removeDisks = (removeDiskParam == "true" || removeDiskParam == "1");
     }
     
-    json result = vmOps->deleteVM(name, removeDisks);
+    // Unknown VMs fail right away instead of as a job
+    json status = RequestOps(name)->getVMStatus(name);
+    if (!status["success"].get<bool>()) {
+        res.status = 404;
+        res.set_content(status.dump(), "application/json");
+        return;
+    }
     
-    if (!result["success"].get<bool>()) {
-        res.status = 500;
-        
-        // Check if it's a "not found" error
-        if (result.contains("error")) {
-            std::string error = result["error"];
-            if (error.find("not found") != std::string::npos) {
-                res.status = 404;
-            }
+    std::string host = hostOfVM(name);
+    auto removeVM = [name, host, removeDisks](json& result) {
+        JobConnection conn(host);
+        result = VMOperations(conn.get()).deleteVM(name, removeDisks);
+        if (!result["success"].get<bool>()) {
+            throw std::runtime_error(result.value("error", "Failed to delete VM"));
         }
+        // Also covers running without domain events
+        OwnershipIndex::instance().release(name);
+        HostRegistry::instance().releaseVM(name);
+        return true;
+    };
+    
+    // A graceful shutdown can take up to GRACEFULL_SHUTDOWN_TIME seconds.
+    // The job sends it, then gives its worker back until the STOPPED event
+    // or the deadline (an event loop timer) resumes it; only without
+    // domain events (as on the other hosts) does deleteVM wait on the worker.
+    std::string jobId = JobManager::instance().submit(
+        "delete", userCtx.userId, name,
+        [name, host, removeVM](json& result) {
+            auto& inventory = DomainInventory::instance();
+            if (!inventory.isReady() || host != HostRegistry::LOCAL_HOST) return removeVM(result);
+            
+            JobManager::beginStep("shutdown");
+            if (!requestShutdown(SharedConnection::instance().get(), name)) return removeVM(result);
+            
+            auto timedOut = std::make_shared<std::atomic<bool>>(false);
+            std::string id = JobManager::suspend([name, removeVM, timedOut](json& rest) {
+                if (*timedOut) {
+                    JobManager::beginStep("destroy");
+                    forceOff(SharedConnection::instance().get(), name);
+                }
+                return removeVM(rest);
+            });
+            
+            if (!inventory.whenShutoff(name, GRACEFULL_SHUTDOWN_TIME * 1000LL, [id, timedOut](bool stopped) {
+                    *timedOut = !stopped;
+                    JobManager::instance().resume(id);
+                })) {
+                // Events went away meanwhile: deleteVM waits as without them
+                JobManager::instance().resume(id);
+            }
+            return true;
+        });
+    
+    if (jobId.empty()) {
+        res.status = 503;
+        json error = {{"success", false}, {"error", "Too many pending jobs, try again later"}};
+        res.set_content(error.dump(), "application/json");
+        return;
     }
     
-    res.set_content(result.dump(2), "application/json");
+    res.status = 202;
+    json result = {
+        {"success", true},
+        {"output", "VM deletion initiated"},
+        {"jobId", jobId},
+        {"statusUrl", "/api/jobs/" + jobId},
+        {"vmName", name}
+    };
+    res.set_content(result.dump(), "application/json");
 }
 
 void APIRoutes::handleDeployVM(const httplib::Request& req, httplib::Response& res) {    
@@ -307,18 +1201,6 @@ void APIRoutes::handleDeployVM(const httplib::Request& req, httplib::Response& r
         return;
     }
     
-    // Check quotas for non-admin users
-    if (!userCtx.isAdmin) {
-        UserOperations userOps(manager->getConnection());
-        auto quotaCheck = userOps.checkUserQuota(userCtx.userId, body);
-        
-        if (!quotaCheck["allowed"].get<bool>()) {
-            res.status = 403;
-            res.set_content(quotaCheck.dump(), "application/json");
-            return;
-        }
-    }
-
   // Add owner info
     body["owner"] = userCtx.userId;
     body["ownerRole"] = userCtx.role;
@@ -331,21 +1213,50 @@ void APIRoutes::handleDeployVM(const httplib::Request& req, httplib::Response& r
     body["hostname"] = internalName;
     body["displayName"] = userHostname;  // Keep original for reference
     
-    bool success = vmOps->deployVM(body);
+    // Only batch deployments may skip the host checks or bring their hash
+    body.erase("preflightChecked");
+    body.erase("passwordHash");
     
-    if (success) {
-        json result = {
-            {"success", true},
-            {"output", "VM deployment initiated successfully"},
-            {"vmName", internalName},
-            {"displayName", userHostname}
-        };
-        res.set_content(result.dump(), "application/json");
-    } else {
-        res.status = 500;
-        json error = {{"success", false}, {"error", "Failed to deploy VM"}};
+    // Check quotas for non-admin users, held until the job ends
+    if (!reserveQuota(SharedConnection::instance().get(), userCtx, body, {internalName}, res)) {
+        return;
+    }
+    
+    std::string host, placementError;
+    if (!placeVM(internalName, body, host, placementError)) {
+        UsageTracker::instance().release(internalName);
+        res.status = 503;
+        json error = {{"success", false}, {"error", placementError}};
         res.set_content(error.dump(), "application/json");
+        return;
     }
+    
+    // Provisioning takes minutes; run it off the HTTP worker and hand back a job ID
+    std::string jobId = JobManager::instance().submit(
+        "deploy", userCtx.userId, internalName,
+        makeDeployJob(body, internalName, userHostname, host));
+    
+    if (jobId.empty()) {
+        PlacementEngine::instance().finish(internalName, false);
+        UsageTracker::instance().release(internalName);
+        OwnershipIndex::instance().release(internalName);
+        res.status = 503;
+        json error = {{"success", false}, {"error", "Too many pending jobs, try again later"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    res.status = 202;
+    json result = {
+        {"success", true},
+        {"output", "VM deployment initiated successfully"},
+        {"jobId", jobId},
+        {"statusUrl", "/api/jobs/" + jobId},
+        {"vmName", internalName},
+        {"displayName", userHostname},
+        {"host", host}
+    };
+    res.set_content(result.dump(), "application/json");
 }
 
 
@@ -360,7 +1271,7 @@ void APIRoutes::handleShutdownVM(const httplib::Request& req, httplib::Response&
         return;
     }
 
-    bool success = vmOps->shutdownVM(name);
+    bool success = RequestOps(name)->shutdownVM(name);
     
     json result = {
         {"success", success},
@@ -380,7 +1291,7 @@ void APIRoutes::handleDestroyVM(const httplib::Request& req, httplib::Response&
         res.set_content(error.dump(), "application/json");
         return;
     }
-    bool success = vmOps->destroyVM(name);
+    bool success = RequestOps(name)->destroyVM(name);
     
     json result = {
         {"success", success},
@@ -400,7 +1311,7 @@ void APIRoutes::handleRebootVM(const httplib::Request& req, httplib::Response& r
         res.set_content(error.dump(), "application/json");
         return;
     }
-    bool success = vmOps->rebootVM(name);
+    bool success = RequestOps(name)->rebootVM(name);
     
     json result = {
         {"success", success},
@@ -420,7 +1331,7 @@ void APIRoutes::handlePauseVM(const httplib::Request& req, httplib::Response& re
         res.set_content(error.dump(), "application/json");
         return;
     }
-    bool success = vmOps->pauseVM(name);
+    bool success = RequestOps(name)->pauseVM(name);
     
     json result = {
         {"success", success},
@@ -440,7 +1351,7 @@ void APIRoutes::handleResumeVM(const httplib::Request& req, httplib::Response& r
         res.set_content(error.dump(), "application/json");
         return;
     }
-    bool success = vmOps->resumeVM(name);
+    bool success = RequestOps(name)->resumeVM(name);
     
     json result = {
         {"success", success},
@@ -460,7 +1371,7 @@ void APIRoutes::handleGetVNC(const httplib::Request& req, httplib::Response& res
         res.set_content(error.dump(), "application/json");
         return;
     }
-    json result = vmOps->getVNCInfo(name);
+    json result = RequestOps(name)->getVNCInfo(name);
     res.set_content(result.dump(), "application/json");
 }
 
@@ -478,7 +1389,7 @@ void APIRoutes::handleGetIP(const httplib::Request& req, httplib::Response& res)
         return;
     }
 
-    json result = vmOps->getIP(name);
+    json result = RequestOps(name)->getIP(name);
 
     if (!result["success"].get<bool>()) {
         res.status = 404;
@@ -498,7 +1409,7 @@ void APIRoutes::handleListSnapshots(const httplib::Request& req, httplib::Respon
         return;
     }
 
-    json result = vmOps->listSnapshots(name);
+    json result = RequestOps(name)->listSnapshots(name);
     
     if (!result["success"].get<bool>()) {
         res.status = 404;
@@ -538,7 +1449,7 @@ void APIRoutes::handleCreateSnapshot(const httplib::Request& req, httplib::Respo
     std::string snapName = body["snapshotName"];
     std::string desc = body.value("description", "Created via web interface");
     
-    bool success = vmOps->createSnapshot(name, snapName, desc);
+    bool success = RequestOps(name)->createSnapshot(name, snapName, desc);
     
     json result = {
         {"success", success},
@@ -559,7 +1470,7 @@ void APIRoutes::handleRevertSnapshot(const httplib::Request& req, httplib::Respo
         res.set_content(error.dump(), "application/json");
         return;
     }
-    bool success = vmOps->revertSnapshot(name, snapName);
+    bool success = RequestOps(name)->revertSnapshot(name, snapName);
     
     json result = {
         {"success", success},
@@ -581,7 +1492,7 @@ void APIRoutes::handleDeleteSnapshot(const httplib::Request& req, httplib::Respo
         return;
     }
     
-    bool success = vmOps->deleteSnapshot(name, snapName);
+    bool success = RequestOps(name)->deleteSnapshot(name, snapName);
     json result = {
         {"success", success},
         {"output", success ? "Snapshot deleted" : "Failed to delete snapshot"}
@@ -618,71 +1529,153 @@ void APIRoutes::handleCloneVM(const httplib::Request& req, httplib::Response& re
         return;
     }
     
+    if (!body["cloneName"].is_string()) {
+        res.status = 400;
+        json error = {{"success", false}, {"error", "Clone name must be a string"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
+    CloneMode mode = CloneMode::Full;
+    if (!parseCloneMode(body.value("mode", "full"), mode)) {
+        res.status = 400;
+        json error = {{"success", false}, {"error", "Invalid clone mode (expected 'linked' or 'full')"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+    
     std::string cloneName = body["cloneName"];
-    bool success = vmOps->cloneVM(name, cloneName);
+    auto nameCheck = Validation::Validator::validateHostname(cloneName);
+    if (!nameCheck.valid) {
+        res.status = 400;
+        json error = {{"success", false}, {"error", nameCheck.error}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
     
-    json result = {
-        {"success", success},
-        {"output", success ? "VM cloned successfully" : "Failed to clone VM"}
-    };
+    // Clones belong to whoever made them, named like deployed VMs
+    VMNameManager nameManager;
+    std::string internalName = nameManager.createVMName(userCtx.userId, cloneName);
+    
+    // Full clones copy whole disks; run them off the HTTP worker. The
+    // clone stays on its source's host.
+    std::string host = hostOfVM(name);
+    OwnershipIndex::instance().assign(internalName, userCtx.userId);
+    std::string jobId = JobManager::instance().submit(
+        "clone", userCtx.userId, internalName,
+        [name, internalName, host, mode](json& result) {
+            JobConnection conn(host);
+            CloneOperations cloner(conn.get());
+            std::string error;
+            if (!cloner.clone(name, internalName, mode, error)) {
+                OwnershipIndex::instance().release(internalName);
+                throw std::runtime_error(error);
+            }
+            HostRegistry::instance().assignVM(internalName, host);
+            result = {
+                {"success", true},
+                {"output", "VM cloned successfully"},
+                {"vmName", internalName},
+                {"mode", cloneModeName(mode)}
+            };
+            return true;
+        });
     
-    if (!success) {
-        res.status = 500;
+    if (jobId.empty()) {
+        OwnershipIndex::instance().release(internalName);
+        res.status = 503;
+        json error = {{"success", false}, {"error", "Too many pending jobs, try again later"}};
+        res.set_content(error.dump(), "application/json");
+        return;
     }
     
+    res.status = 202;
+    json result = {
+        {"success", true},
+        {"output", "VM clone initiated"},
+        {"jobId", jobId},
+        {"statusUrl", "/api/jobs/" + jobId},
+        {"vmName", internalName},
+        {"displayName", cloneName}
+    };
     res.set_content(result.dump(), "application/json");
 }
 
 void APIRoutes::handleSystemInfo(const httplib::Request& req, httplib::Response& res) {
     json result;
     result["success"] = false;
+    json info;
     
-    if (!manager->isConnected()) {
-        result["error"] = "Not connected to libvirt";
-        res.set_content(result.dump(), "application/json");
-        return;
-    }
-    
-    virNodeInfo nodeInfo;
-    unsigned long hvVersion, libVersion;
+    // Other hypervisors are queried in parallel with the local one
+    auto remote = HostRegistry::instance().gather(hostNodeInfo, [&]() {
+        virConnectPtr conn = SharedConnection::instance().get();
+        if (!conn) {
+            result["error"] = "Not connected to libvirt";
+            return;
+        }
+        
+        virNodeInfo nodeInfo;
+        unsigned long hvVersion, libVersion;
+        
+        if (virNodeGetInfo(conn, &nodeInfo) < 0 || 
+            virConnectGetVersion(conn, &hvVersion) < 0 || 
+            virConnectGetLibVersion(conn, &libVersion) < 0) {
+            result["error"] = "Failed to get system info";
+            return;
+        }
+        
+        info = {
+            {"model", std::string(nodeInfo.model)},
+            {"memory", std::to_string(nodeInfo.memory) + " KB"},
+            {"cpus", nodeInfo.cpus},
+            {"mhz", std::to_string(nodeInfo.mhz) + " MHz"},
+            {"nodes", nodeInfo.nodes},
+            {"sockets", nodeInfo.sockets},
+            {"cores", nodeInfo.cores},
+            {"threads", nodeInfo.threads},
+            {"hypervisorVersion", hvVersion},
+            {"libvirtVersion", libVersion}
+        };
+        
+        std::stringstream nodeInfoStr;
+        nodeInfoStr << "Model: " << nodeInfo.model << "\n";
+        nodeInfoStr << "Memory: " << nodeInfo.memory << " KB\n";
+        nodeInfoStr << "CPUs: " << nodeInfo.cpus << "\n";
+        nodeInfoStr << "MHz: " << nodeInfo.mhz << " MHz\n";
+        nodeInfoStr << "Nodes: " << nodeInfo.nodes << "\n";
+        nodeInfoStr << "Sockets: " << nodeInfo.sockets << "\n";
+        nodeInfoStr << "Cores: " << nodeInfo.cores << "\n";
+        nodeInfoStr << "Threads: " << nodeInfo.threads << "\n";
+        nodeInfoStr << "Hypervisor Version: " << hvVersion << "\n";
+        nodeInfoStr << "Libvirt Version: " << libVersion;
+        
+        result["success"] = true;
+        result["nodeInfo"] = nodeInfoStr.str();
+        result["version"] = "Libvirt version: " + std::to_string(libVersion);
+        result["connectionPool"] = ConnectionPool::instance().status();
+        result["placement"] = PlacementEngine::instance().status();
+    });
     
-    if (!manager->getNodeInfo(nodeInfo) || 
-        !manager->getVersion(hvVersion) || 
-        !manager->getLibVersion(libVersion)) {
-        result["error"] = "Failed to get system info";
-        res.set_content(result.dump(), "application/json");
-        return;
+    if (!remote.empty()) {
+        json local = {{"name", HostRegistry::LOCAL_HOST}, {"success", result["success"]}};
+        if (result["success"].get<bool>()) {
+            local["info"] = info;
+        } else {
+            local["error"] = result["error"];
+        }
+        
+        json hosts = json::array({local});
+        for (const auto& host : remote) {
+            json summary = hostSummary(host);
+            if (host.ok) {
+                summary["info"] = host.data;
+            }
+            hosts.push_back(summary);
+        }
+        result["hosts"] = hosts;
+        result["hostRegistry"] = HostRegistry::instance().status();
     }
     
-    json info = {
-        {"model", std::string(nodeInfo.model)},
-        {"memory", std::to_string(nodeInfo.memory) + " KB"},
-        {"cpus", nodeInfo.cpus},
-        {"mhz", std::to_string(nodeInfo.mhz) + " MHz"},
-        {"nodes", nodeInfo.nodes},
-        {"sockets", nodeInfo.sockets},
-        {"cores", nodeInfo.cores},
-        {"threads", nodeInfo.threads},
-        {"hypervisorVersion", hvVersion},
-        {"libvirtVersion", libVersion}
-    };
-    
-    std::stringstream nodeInfoStr;
-    nodeInfoStr << "Model: " << nodeInfo.model << "\n";
-    nodeInfoStr << "Memory: " << nodeInfo.memory << " KB\n";
-    nodeInfoStr << "CPUs: " << nodeInfo.cpus << "\n";
-    nodeInfoStr << "MHz: " << nodeInfo.mhz << " MHz\n";
-    nodeInfoStr << "Nodes: " << nodeInfo.nodes << "\n";
-    nodeInfoStr << "Sockets: " << nodeInfo.sockets << "\n";
-    nodeInfoStr << "Cores: " << nodeInfo.cores << "\n";
-    nodeInfoStr << "Threads: " << nodeInfo.threads << "\n";
-    nodeInfoStr << "Hypervisor Version: " << hvVersion << "\n";
-    nodeInfoStr << "Libvirt Version: " << libVersion;
-    
-    result["success"] = true;
-    result["nodeInfo"] = nodeInfoStr.str();
-    result["version"] = "Libvirt version: " + std::to_string(libVersion);
-    
     res.set_content(result.dump(), "application/json");
 }
 
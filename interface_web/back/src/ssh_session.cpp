@@ -0,0 +1,282 @@
+#include "../include/ssh_session.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+namespace RemoteExec {
+
+bool resolveTarget(virConnectPtr conn, SSHTarget& target) {
+    if (!conn) return false;
+
+    // Get connection URI to determine if it's remote
+    char* uri = virConnectGetURI(conn);
+    if (!uri) return false;
+
+    std::string uriStr(uri);
+    free(uri);
+
+    // Check if URI contains SSH (qemu+ssh://user@host/system)
+    if (uriStr.find("qemu+ssh://") == std::string::npos) {
+        return false;
+    }
+
+    // Format: qemu+ssh://user@host/system or qemu+ssh://user@host/system?keyfile=/path
+    std::regex uriRegex(R"(qemu\+ssh://([^@]+)@([^/?]+))");
+    std::smatch matches;
+
+    if (std::regex_search(uriStr, matches, uriRegex)) {
+        target.user = matches[1].str();
+        target.host = matches[2].str();
+    }
+
+    // Extract SSH key file if specified in URI
+    std::regex keyRegex(R"(keyfile=([^&]+))");
+    if (std::regex_search(uriStr, matches, keyRegex)) {
+        target.keyFile = matches[1].str();
+    } else {
+        target.keyFile = findDefaultSSHKey();
+    }
+
+    return true;
+}
+
+std::string findDefaultSSHKey() {
+    // Check common SSH key locations
+    const char* home = getenv("HOME");
+    if (!home) {
+        return "";
+    }
+
+    std::vector<std::string> possibleKeys = {
+        std::string(home) + "/.ssh/thoth_kvm_key",
+        std::string(home) + "/.ssh/id_rsa",
+        std::string(home) + "/.ssh/id_ed25519",
+    };
+
+    for (const auto& keyPath : possibleKeys) {
+        struct stat buffer;
+        if (stat(keyPath.c_str(), &buffer) == 0) {
+            return keyPath;
+        }
+    }
+
+    return "";
+}
+
+bool uploadFile(virConnectPtr conn, const std::string& path, const std::string& data,
+                std::string& error) {
+    std::string partial = path + ".part";
+
+    SSHTarget target;
+    if (resolveTarget(conn, target)) {
+        std::string command = "cat > " + SSHSession::shellQuote(partial) +
+                              " && mv -f " + SSHSession::shellQuote(partial) + " " +
+                              SSHSession::shellQuote(path);
+        std::string output;
+        int status = SSHSession::instance().runWithInput(target, command, data, output);
+        if (status != 0) {
+            error = output.empty() ? "upload exited with status " + std::to_string(status) : output;
+            return false;
+        }
+        return true;
+    }
+
+    std::ofstream file(partial, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    file.close();
+    if (!file || rename(partial.c_str(), path.c_str()) != 0) {
+        error = "cannot write " + path + ": " + strerror(errno);
+        unlink(partial.c_str());
+        return false;
+    }
+    return true;
+}
+
+SSHSession& SSHSession::instance() {
+    static SSHSession session;
+    return session;
+}
+
+SSHSession::SSHSession() {
+    // Control sockets must live in a private directory
+    const char* runtimeDir = getenv("XDG_RUNTIME_DIR");
+    std::string dir = std::string(runtimeDir && *runtimeDir ? runtimeDir : "/tmp") +
+                      "/thoth-ssh-" + std::to_string(getuid());
+
+    if (mkdir(dir.c_str(), 0700) != 0 && errno != EEXIST) {
+        fprintf(stderr, "SSH multiplexing disabled: cannot create %s (%s)\n",
+                dir.c_str(), strerror(errno));
+        return;
+    }
+
+    struct stat info;
+    if (stat(dir.c_str(), &info) != 0 || !S_ISDIR(info.st_mode) || info.st_uid != getuid()) {
+        fprintf(stderr, "SSH multiplexing disabled: %s is not a private directory\n", dir.c_str());
+        return;
+    }
+    chmod(dir.c_str(), 0700);
+
+    controlDir = dir;
+}
+
+std::string SSHSession::shellQuote(const std::string& value) {
+    std::string quoted = "'";
+    for (char c : value) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    quoted += "'";
+    return quoted;
+}
+
+std::string SSHSession::baseOptions(const SSHTarget& target) const {
+    std::stringstream ssh;
+    ssh << "ssh ";
+
+    // Add SSH key if available
+    if (!target.keyFile.empty()) {
+        ssh << "-i " << shellQuote(target.keyFile) << " ";
+    }
+
+    // SSH options for non-interactive use
+    ssh << "-o StrictHostKeyChecking=no ";
+    ssh << "-o UserKnownHostsFile=/dev/null ";
+    ssh << "-o LogLevel=ERROR ";
+    ssh << "-o ConnectTimeout=10 ";
+    ssh << "-o BatchMode=yes ";
+    ssh << "-o PasswordAuthentication=no ";
+
+    if (!controlDir.empty()) {
+        // %C is a hash of host, port and user: short enough for a socket path
+        ssh << "-o ControlPath=" << shellQuote(controlDir + "/%C") << " ";
+    }
+
+    return ssh.str();
+}
+
+std::string SSHSession::buildCommand(const SSHTarget& target, const std::string& command) {
+    ensureMaster(target);
+
+    // Commands never become masters themselves: a backgrounded master
+    // would keep the caller's output pipe open
+    std::string options = baseOptions(target);
+    if (!controlDir.empty()) {
+        options += "-o ControlMaster=no ";
+    }
+    return options + shellQuote(target.key()) + " " + shellQuote(command);
+}
+
+void SSHSession::ensureMaster(const SSHTarget& target) {
+    if (controlDir.empty()) return;
+
+    auto now = std::chrono::steady_clock::now();
+    // ssh drops the master after PERSIST_SECONDS idle; re-check before that
+    auto recheckAfter = std::chrono::seconds(PERSIST_SECONDS - 30);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& state = targets[target.key()];
+        bool fresh = state.masterStarted && now - state.lastUsed < recheckAfter;
+        state.target = target;
+        state.lastUsed = now;
+        if (fresh) return;
+    }
+
+    std::lock_guard<std::mutex> connectLock(connectMutex);
+    bool started = isConnected(target) || startMaster(target);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    targets[target.key()].masterStarted = started;
+}
+
+bool SSHSession::startMaster(const SSHTarget& target) const {
+    // -f backgrounds after authentication, so success means the socket is ready
+    std::string cmd = baseOptions(target) +
+                      "-o ControlMaster=yes -o ControlPersist=" + std::to_string(PERSIST_SECONDS) + " " +
+                      "-o ServerAliveInterval=30 -N -f " + shellQuote(target.key()) +
+                      " < /dev/null > /dev/null 2>&1";
+
+    if (system(cmd.c_str()) != 0) {
+        fprintf(stderr, "SSH master connection to %s failed, using direct connections\n",
+                target.key().c_str());
+        return false;
+    }
+
+    fprintf(stdout, "Opened shared SSH session to %s\n", target.key().c_str());
+    return true;
+}
+
+int SSHSession::runWithInput(const SSHTarget& target, const std::string& command,
+                             const std::string& input, std::string& output) {
+    // popen() can only stream one direction; collect the output in a file
+    char outputPath[] = "/tmp/thoth-ssh-out-XXXXXX";
+    int outputFd = mkstemp(outputPath);
+    if (outputFd < 0) {
+        output = "cannot create temporary file";
+        return -1;
+    }
+    close(outputFd);
+
+    std::string fullCommand = buildCommand(target, command) + " > " + outputPath + " 2>&1";
+
+    FILE* pipe = popen(fullCommand.c_str(), "w");
+    if (!pipe) {
+        unlink(outputPath);
+        output = "Failed to execute command";
+        return -1;
+    }
+
+    size_t written = fwrite(input.data(), 1, input.size(), pipe);
+    int status = pclose(pipe);
+
+    std::ifstream captured(outputPath, std::ios::binary);
+    output.assign(std::istreambuf_iterator<char>(captured), std::istreambuf_iterator<char>());
+    unlink(outputPath);
+
+    if (written != input.size()) {
+        if (output.empty()) output = "short write to ssh";
+        return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+bool SSHSession::isConnected(const SSHTarget& target) const {
+    if (controlDir.empty()) return false;
+
+    std::string cmd = baseOptions(target) + "-O check " + shellQuote(target.key()) + " > /dev/null 2>&1";
+    return system(cmd.c_str()) == 0;
+}
+
+void SSHSession::closeAll() {
+    if (controlDir.empty()) return;
+
+    std::vector<SSHTarget> open;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& [key, state] : targets) {
+            if (state.masterStarted) open.push_back(state.target);
+        }
+        targets.clear();
+    }
+
+    for (const auto& target : open) {
+        std::string cmd = baseOptions(target) + "-O exit " + shellQuote(target.key()) + " > /dev/null 2>&1";
+        if (system(cmd.c_str()) == 0) {
+            fprintf(stdout, "Closed SSH session to %s\n", target.key().c_str());
+        }
+    }
+}
+
+} // namespace RemoteExec
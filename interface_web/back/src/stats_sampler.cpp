@@ -0,0 +1,79 @@
+#include "../include/stats_sampler.hpp"
+#include "../include/domain_stats.hpp"
+#include "../include/utils.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+StatsSampler::StatsSampler(virConnectPtr connection, int intervalMs, size_t historySize)
+    : conn(connection), intervalMs(intervalMs > 0 ? intervalMs : DEFAULT_INTERVAL_MS),
+      historySize(historySize) {}
+
+StatsSampler::~StatsSampler() {
+    stop();
+}
+
+bool StatsSampler::start() {
+    if (running) return true;
+    if (!conn) return false;
+
+    StatsStore::instance().setHistoryCapacity(historySize);
+
+    running = true;
+    worker = std::thread(&StatsSampler::run, this);
+
+    fprintf(stdout, "Stats sampler started (every %d ms, %zu points per VM)\n",
+            intervalMs, historySize);
+    return true;
+}
+
+void StatsSampler::stop() {
+    if (!running) return;
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        running = false;
+    }
+    wakeCv.notify_all();
+
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool StatsSampler::sampleOnce() {
+    std::vector<DomainStats::DomainSample> samples;
+    if (!DomainStats::collectAll(conn, samples, VIR_CONNECT_GET_ALL_DOMAINS_STATS_RUNNING)) {
+        return false;
+    }
+
+    auto& store = StatsStore::instance();
+    for (const auto& sample : samples) {
+        store.record(sample);
+    }
+
+    // Forget VMs that stopped long enough ago for their whole history to have expired
+    long long window = (long long)intervalMs * (long long)historySize;
+    store.pruneOlderThan(getCurrentTimeMs() - window);
+
+    return true;
+}
+
+void StatsSampler::run() {
+    auto next = std::chrono::steady_clock::now();
+
+    while (running) {
+        if (sampleOnce() && onSampled) {
+            onSampled();
+        }
+
+        // Fixed-rate schedule; skip ticks we were too slow for instead of bursting
+        auto now = std::chrono::steady_clock::now();
+        do {
+            next += std::chrono::milliseconds(intervalMs);
+        } while (next <= now);
+
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeCv.wait_until(lock, next, [this]() { return !running; });
+    }
+}
@@ -0,0 +1,172 @@
+#include "../include/stats_store.hpp"
+
+#include <functional>
+#include <mutex>
+
+StatsStore& StatsStore::instance() {
+    static StatsStore store;
+    return store;
+}
+
+StatsStore::Shard& StatsStore::shardFor(const std::string& vmName) {
+    return shards[std::hash<std::string>{}(vmName) % SHARD_COUNT];
+}
+
+const StatsStore::Shard& StatsStore::shardFor(const std::string& vmName) const {
+    return shards[std::hash<std::string>{}(vmName) % SHARD_COUNT];
+}
+
+void StatsStore::record(const DomainStats::DomainSample& sample) {
+    StatsPoint point;
+    point.timestamp = sample.timestamp;
+    point.memoryUsed = sample.balloonCurrent;
+    point.memoryMax = sample.balloonMaximum;
+
+    for (const auto& disk : sample.disks) {
+        point.disks.push_back({disk.name, disk.readBytes, disk.writeBytes});
+    }
+    for (const auto& nic : sample.nics) {
+        point.nics.push_back({nic.name, nic.rxBytes, nic.txBytes});
+    }
+
+    Shard& shard = shardFor(sample.name);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+    auto it = shard.series.find(sample.name);
+    if (it == shard.series.end()) {
+        it = shard.series.emplace(sample.name, Series{RingBuffer<StatsPoint>(historyCapacity), 0}).first;
+    }
+
+    Series& series = it->second;
+    if (!series.points.empty()) {
+        const StatsPoint& previous = series.points.back();
+        long long timeDiff = point.timestamp - previous.timestamp;
+
+        // cpuTime goes backwards when the domain restarts
+        if (timeDiff > 0 && sample.cpuTime >= series.lastCpuTime) {
+            unsigned long long cpuDiff = sample.cpuTime - series.lastCpuTime;
+            point.cpuPercent = ((double)cpuDiff / (timeDiff * 1000000.0)) * 100.0;
+        }
+    }
+
+    series.lastCpuTime = sample.cpuTime;
+    series.points.push(point);
+}
+
+bool StatsStore::latest(const std::string& vmName, StatsPoint& out) const {
+    const Shard& shard = shardFor(vmName);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+    auto it = shard.series.find(vmName);
+    if (it == shard.series.end() || it->second.points.empty()) return false;
+    out = it->second.points.back();
+    return true;
+}
+
+void StatsStore::forEachLatest(
+    const std::function<void(const std::string&, const StatsPoint&)>& visit) const {
+    for (const auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        for (const auto& [name, series] : shard.series) {
+            if (!series.points.empty()) {
+                visit(name, series.points.back());
+            }
+        }
+    }
+}
+
+std::vector<StatsPoint> StatsStore::history(const std::string& vmName, long long sinceMs) const {
+    std::vector<StatsPoint> points;
+
+    const Shard& shard = shardFor(vmName);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+    auto it = shard.series.find(vmName);
+    if (it == shard.series.end()) return points;
+
+    const auto& ring = it->second.points;
+    for (size_t i = 0; i < ring.size(); i++) {
+        if (ring.at(i).timestamp >= sinceMs) {
+            points.push_back(ring.at(i));
+        }
+    }
+    return points;
+}
+
+void StatsStore::remove(const std::string& vmName) {
+    Shard& shard = shardFor(vmName);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    shard.series.erase(vmName);
+}
+
+void StatsStore::pruneOlderThan(long long cutoffMs) {
+    for (auto& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        for (auto it = shard.series.begin(); it != shard.series.end();) {
+            if (it->second.points.empty() || it->second.points.back().timestamp < cutoffMs) {
+                it = shard.series.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+size_t StatsStore::size() const {
+    size_t total = 0;
+    for (const auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        total += shard.series.size();
+    }
+    return total;
+}
+
+json statsToJson(const StatsPoint& point) {
+    json stats;
+
+    stats["timestamp"] = point.timestamp;
+    stats["cpu"] = point.cpuPercent;
+
+    // Memory (KiB), as reported by the balloon driver
+    stats["memory"] = {
+        {"used", point.memoryUsed},
+        {"max", point.memoryMax},
+        {"percent", point.memoryMax > 0 ? (point.memoryUsed * 100.0 / point.memoryMax) : 0}
+    };
+
+    // Disk stats: totals over every block device, plus the per-device breakdown
+    long long diskRead = 0, diskWrite = 0;
+    json disks = json::array();
+    for (const auto& disk : point.disks) {
+        diskRead += disk.readBytes;
+        diskWrite += disk.writeBytes;
+        disks.push_back({{"name", disk.name}, {"read", disk.readBytes}, {"write", disk.writeBytes}});
+    }
+
+    stats["disk"] = {
+        {"read", diskRead},
+        {"write", diskWrite},
+        {"readMB", diskRead / 1024.0 / 1024.0},
+        {"writeMB", diskWrite / 1024.0 / 1024.0},
+        {"devices", disks}
+    };
+
+    // Network stats: totals over every interface, plus the per-interface breakdown
+    long long netRx = 0, netTx = 0;
+    json nics = json::array();
+    for (const auto& nic : point.nics) {
+        netRx += nic.rxBytes;
+        netTx += nic.txBytes;
+        nics.push_back({{"name", nic.name}, {"rx", nic.rxBytes}, {"tx", nic.txBytes}});
+    }
+
+    stats["network"] = {
+        {"rx", netRx},
+        {"tx", netTx},
+        {"rxMB", netRx / 1024.0 / 1024.0},
+        {"txMB", netTx / 1024.0 / 1024.0},
+        {"interfaces", nics}
+    };
+
+    return stats;
+}
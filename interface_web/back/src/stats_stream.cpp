@@ -0,0 +1,176 @@
+#include "../include/stats_stream.hpp"
+#include "../include/stats_store.hpp"
+#include "../include/routes.hpp"
+#include "../include/json.hpp"
+
+#include <memory>
+#include <sstream>
+#include <vector>
+
+using json = nlohmann::json;
+
+StatsBroadcaster& StatsBroadcaster::instance() {
+    static StatsBroadcaster broadcaster;
+    return broadcaster;
+}
+
+void StatsBroadcaster::publish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+    }
+    cv.notify_all();
+}
+
+uint64_t StatsBroadcaster::waitForUpdate(uint64_t seen, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait_for(lock, timeout, [&]() { return generation != seen || closed; });
+    return generation;
+}
+
+uint64_t StatsBroadcaster::currentGeneration() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return generation;
+}
+
+std::string StatsBroadcaster::renderVM(const std::string& vmName) {
+    uint64_t current = currentGeneration();
+
+    std::lock_guard<std::mutex> lock(renderMutex);
+    if (renderedGeneration != current) {
+        rendered.clear();
+        renderedGeneration = current;
+    }
+
+    auto it = rendered.find(vmName);
+    if (it != rendered.end()) {
+        return it->second;
+    }
+
+    StatsPoint point;
+    std::string payload = StatsStore::instance().latest(vmName, point)
+                              ? statsToJson(point).dump()
+                              : "null";
+    rendered.emplace(vmName, payload);
+    return payload;
+}
+
+bool StatsBroadcaster::tryAddSubscriber() {
+    size_t current = subscribers.load();
+    while (current < MAX_SUBSCRIBERS) {
+        if (subscribers.compare_exchange_weak(current, current + 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void StatsBroadcaster::removeSubscriber() {
+    subscribers--;
+}
+
+void StatsBroadcaster::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+    }
+    cv.notify_all();
+}
+
+// ========================================
+// SSE ENDPOINT
+// ========================================
+
+static std::vector<std::string> splitVMList(const std::string& list) {
+    std::vector<std::string> names;
+    std::stringstream ss(list);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        if (!name.empty()) {
+            names.push_back(name);
+        }
+    }
+    return names;
+}
+
+static void handleStatsStream(const httplib::Request& req, httplib::Response& res) {
+    auto userCtx = getUserContext(req);
+    auto vmNames = splitVMList(req.get_param_value("vms"));
+
+    if (vmNames.empty()) {
+        res.status = 400;
+        json error = {{"success", false}, {"error", "vms parameter required (vms=a,b,c)"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+
+    for (const auto& name : vmNames) {
+        if (!checkVMAccess(name, userCtx)) {
+            res.status = 403;
+            json error = {{"success", false}, {"error", "Access denied: " + name}};
+            res.set_content(error.dump(), "application/json");
+            return;
+        }
+    }
+
+    auto& broadcaster = StatsBroadcaster::instance();
+    if (!broadcaster.tryAddSubscriber()) {
+        res.status = 503;
+        json error = {{"success", false}, {"error", "Too many stats streams"}};
+        res.set_content(error.dump(), "application/json");
+        return;
+    }
+
+    res.set_header("Cache-Control", "no-cache");
+    res.set_header("X-Accel-Buffering", "no");
+
+    // Send the current sample immediately, then one event per sampler tick
+    auto seen = std::make_shared<uint64_t>(0);
+    auto first = std::make_shared<bool>(true);
+
+    res.set_chunked_content_provider(
+        "text/event-stream",
+        [vmNames, seen, first](size_t, httplib::DataSink& sink) {
+            auto& broadcaster = StatsBroadcaster::instance();
+
+            if (*first) {
+                *first = false;
+                *seen = broadcaster.currentGeneration();
+                static const std::string retry = "retry: 3000\n\n";
+                if (!sink.write(retry.data(), retry.size())) return false;
+            } else {
+                uint64_t current = broadcaster.waitForUpdate(
+                    *seen, std::chrono::duration_cast<std::chrono::milliseconds>(
+                               StatsBroadcaster::HEARTBEAT_INTERVAL));
+
+                if (broadcaster.isClosed()) {
+                    sink.done();
+                    return false;
+                }
+
+                if (current == *seen) {
+                    static const std::string heartbeat = ": keepalive\n\n";
+                    return sink.write(heartbeat.data(), heartbeat.size());
+                }
+                *seen = current;
+            }
+
+            std::string event = "event: stats\ndata: {";
+            for (size_t i = 0; i < vmNames.size(); i++) {
+                if (i > 0) event += ",";
+                event += json(vmNames[i]).dump() + ":" + broadcaster.renderVM(vmNames[i]);
+            }
+            event += "}\n\n";
+
+            return sink.write(event.data(), event.size());
+        },
+        [](bool) {
+            StatsBroadcaster::instance().removeSubscriber();
+        });
+}
+
+void setupStatsStream(httplib::Server& svr) {
+    svr.Get("/api/stream/stats", [](const httplib::Request& req, httplib::Response& res) {
+        handleStatsStream(req, res);
+    });
+}
@@ -0,0 +1,318 @@
+#include "../include/storage_backend.hpp"
+
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <libvirt/virterror.h>
+
+namespace {
+
+// dir -> pool name, shared by every StorageBackend instance
+std::mutex poolCacheMutex;
+std::unordered_map<std::string, std::string> poolCache;
+
+std::string lastError() {
+    virErrorPtr err = virGetLastError();
+    return err && err->message ? err->message : "unknown error";
+}
+
+std::string trimSlash(const std::string& dir) {
+    std::string out = dir;
+    while (out.size() > 1 && out.back() == '/') out.pop_back();
+    return out;
+}
+
+std::string parentDirectory(const std::string& path) {
+    size_t slash = path.rfind('/');
+    if (slash == std::string::npos || slash == 0) return "/";
+    return path.substr(0, slash);
+}
+
+// <target><path>...</path> of a pool definition
+std::string poolTargetPath(const std::string& xml) {
+    size_t target = xml.find("<target>");
+    if (target == std::string::npos) return "";
+    size_t start = xml.find("<path>", target);
+    size_t end = xml.find("</path>", start);
+    if (start == std::string::npos || end == std::string::npos) return "";
+    start += 6;
+    return trimSlash(xml.substr(start, end - start));
+}
+
+// type='...' of a <pool> definition
+std::string poolType(const std::string& xml) {
+    size_t pool = xml.find("<pool");
+    if (pool == std::string::npos) return "";
+    size_t type = xml.find("type=", pool);
+    if (type == std::string::npos || type + 6 > xml.size()) return "";
+    char quote = xml[type + 5];
+    size_t end = xml.find(quote, type + 6);
+    if (end == std::string::npos) return "";
+    return xml.substr(type + 6, end - type - 6);
+}
+
+std::string xmlEscape(const std::string& value) {
+    std::string out;
+    for (char c : value) {
+        switch (c) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '\'': out += "&apos;"; break;
+            case '"': out += "&quot;"; break;
+            default: out += c;
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+StorageBackend::StorageBackend(virConnectPtr connection) : conn(connection) {}
+
+virStoragePoolPtr StorageBackend::poolForDirectory(const std::string& rawDir, bool create) {
+    if (!conn) return nullptr;
+    std::string dir = trimSlash(rawDir);
+
+    {
+        std::lock_guard<std::mutex> lock(poolCacheMutex);
+        auto it = poolCache.find(dir);
+        if (it != poolCache.end()) {
+            virStoragePoolPtr pool = virStoragePoolLookupByName(conn, it->second.c_str());
+            if (pool && virStoragePoolIsActive(pool) == 1) {
+                return pool;
+            }
+            if (pool) virStoragePoolFree(pool);
+            poolCache.erase(it);
+        }
+    }
+
+    virStoragePoolPtr pool = findPool(dir);
+    if (!pool && create) {
+        pool = createTransientPool(dir);
+    }
+
+    if (pool) {
+        const char* name = virStoragePoolGetName(pool);
+        std::lock_guard<std::mutex> lock(poolCacheMutex);
+        if (name) poolCache[dir] = name;
+    }
+    return pool;
+}
+
+virStoragePoolPtr StorageBackend::findPool(const std::string& dir) {
+    virStoragePoolPtr* pools = nullptr;
+    int count = virConnectListAllStoragePools(conn, &pools, VIR_CONNECT_LIST_STORAGE_POOLS_ACTIVE);
+    if (count < 0) {
+        fprintf(stderr, "Failed to list storage pools: %s\n", lastError().c_str());
+        return nullptr;
+    }
+
+    virStoragePoolPtr match = nullptr;
+    for (int i = 0; i < count; i++) {
+        if (!match) {
+            char* xml = virStoragePoolGetXMLDesc(pools[i], 0);
+            if (xml) {
+                if (poolTargetPath(xml) == dir) {
+                    match = pools[i];
+                }
+                free(xml);
+            }
+        }
+        if (pools[i] != match) {
+            virStoragePoolFree(pools[i]);
+        }
+    }
+    free(pools);
+    return match;
+}
+
+virStoragePoolPtr StorageBackend::createTransientPool(const std::string& dir) {
+    std::string name = "thoth" + dir;
+    for (auto& c : name) {
+        if (c == '/') c = '-';
+    }
+
+    std::stringstream xml;
+    xml << "<pool type='dir'>"
+        << "<name>" << xmlEscape(name) << "</name>"
+        << "<target><path>" << xmlEscape(dir) << "</path></target>"
+        << "</pool>";
+
+    virStoragePoolPtr pool = virStoragePoolCreateXML(conn, xml.str().c_str(), 0);
+    if (!pool) {
+        fprintf(stderr, "No storage pool for %s: %s\n", dir.c_str(), lastError().c_str());
+        return nullptr;
+    }
+
+    fprintf(stdout, "Created transient storage pool '%s' for %s\n", name.c_str(), dir.c_str());
+    return pool;
+}
+
+virStorageVolPtr StorageBackend::lookupVolume(const std::string& path) {
+    virStorageVolPtr vol = virStorageVolLookupByPath(conn, path.c_str());
+    if (vol) return vol;
+
+    // Files written outside libvirt only show up after a pool refresh
+    virStoragePoolPtr pool = poolForDirectory(parentDirectory(path), false);
+    if (!pool) return nullptr;
+
+    if (virStoragePoolRefresh(pool, 0) == 0) {
+        vol = virStorageVolLookupByPath(conn, path.c_str());
+    }
+    virStoragePoolFree(pool);
+    return vol;
+}
+
+long long StorageBackend::availableBytes(const std::string& dir) {
+    virStoragePoolPtr pool = poolForDirectory(dir, false);
+    if (!pool) return -1;
+
+    // Pool info is only as fresh as the last refresh
+    virStoragePoolRefresh(pool, 0);
+
+    virStoragePoolInfo info;
+    long long available = -1;
+    if (virStoragePoolGetInfo(pool, &info) == 0) {
+        available = static_cast<long long>(info.available);
+    }
+    virStoragePoolFree(pool);
+    return available;
+}
+
+bool StorageBackend::createOverlay(const std::string& dir, const std::string& name,
+                                   unsigned long long capacity, const std::string& backingPath,
+                                   std::string& error) {
+    virStoragePoolPtr pool = poolForDirectory(dir, true);
+    if (!pool) {
+        error = "no storage pool for " + dir;
+        return false;
+    }
+
+    std::stringstream xml;
+    xml << "<volume>"
+        << "<name>" << xmlEscape(name) << "</name>"
+        << "<capacity unit='bytes'>" << capacity << "</capacity>"
+        << "<target><format type='qcow2'/></target>"
+        << "<backingStore>"
+        << "<path>" << xmlEscape(backingPath) << "</path>"
+        << "<format type='qcow2'/>"
+        << "</backingStore>"
+        << "</volume>";
+
+    virStorageVolPtr vol = virStorageVolCreateXML(pool, xml.str().c_str(), 0);
+    virStoragePoolFree(pool);
+
+    if (!vol) {
+        error = lastError();
+        return false;
+    }
+    virStorageVolFree(vol);
+    return true;
+}
+
+bool StorageBackend::cloneImage(const std::string& dir, const std::string& name,
+                                const std::string& sourcePath, unsigned long long capacity,
+                                std::string& error) {
+    virStorageVolPtr source = lookupVolume(sourcePath);
+    if (!source) {
+        error = "source image is not in a storage pool: " + sourcePath;
+        return false;
+    }
+
+    virStoragePoolPtr pool = poolForDirectory(dir, true);
+    if (!pool) {
+        virStorageVolFree(source);
+        error = "no storage pool for " + dir;
+        return false;
+    }
+
+    virStorageVolInfo sourceInfo;
+    unsigned long long sourceCapacity = 0;
+    if (virStorageVolGetInfo(source, &sourceInfo) == 0) {
+        sourceCapacity = sourceInfo.capacity;
+    }
+
+    std::stringstream xml;
+    xml << "<volume>"
+        << "<name>" << xmlEscape(name) << "</name>"
+        << "<capacity unit='bytes'>" << sourceCapacity << "</capacity>"
+        << "<target><format type='qcow2'/></target>"
+        << "</volume>";
+
+    virStorageVolPtr vol = virStorageVolCreateXMLFrom(pool, xml.str().c_str(), source, 0);
+    virStoragePoolFree(pool);
+    virStorageVolFree(source);
+
+    if (!vol) {
+        error = lastError();
+        return false;
+    }
+
+    bool ok = true;
+    if (capacity > sourceCapacity && virStorageVolResize(vol, capacity, 0) < 0) {
+        error = "resize failed: " + lastError();
+        ok = false;
+    }
+    virStorageVolFree(vol);
+    return ok;
+}
+
+long long StorageBackend::volumeCapacity(const std::string& path) {
+    virStorageVolPtr vol = lookupVolume(path);
+    if (!vol) return -1;
+
+    virStorageVolInfo info;
+    long long capacity = virStorageVolGetInfo(vol, &info) == 0 ? static_cast<long long>(info.capacity) : -1;
+    virStorageVolFree(vol);
+    return capacity;
+}
+
+bool StorageBackend::deleteDeviceVolume(const std::string& path, bool& managed, std::string& error) {
+    managed = false;
+
+    // No refresh: a pool that does not list the device already is not its owner
+    virStorageVolPtr vol = virStorageVolLookupByPath(conn, path.c_str());
+    if (!vol) return false;
+
+    // Deleting from a file-backed pool would unlink the device node
+    std::string type;
+    virStoragePoolPtr pool = virStoragePoolLookupByVolume(vol);
+    if (pool) {
+        char* xml = virStoragePoolGetXMLDesc(pool, 0);
+        if (xml) {
+            type = poolType(xml);
+            free(xml);
+        }
+        virStoragePoolFree(pool);
+    }
+    if (type.empty() || type == "dir" || type == "fs" || type == "netfs") {
+        virStorageVolFree(vol);
+        return false;
+    }
+
+    managed = true;
+    bool ok = virStorageVolDelete(vol, 0) == 0;
+    if (!ok) {
+        error = lastError();
+    }
+    virStorageVolFree(vol);
+    return ok;
+}
+
+bool StorageBackend::deleteVolume(const std::string& path, bool& managed, std::string& error) {
+    virStorageVolPtr vol = lookupVolume(path);
+    if (!vol) {
+        managed = false;
+        return false;
+    }
+
+    managed = true;
+    bool ok = virStorageVolDelete(vol, 0) == 0;
+    if (!ok) {
+        error = lastError();
+    }
+    virStorageVolFree(vol);
+    return ok;
+}
@@ -0,0 +1,88 @@
+#include "../include/usage_tracker.hpp"
+#include "../include/domain_inventory.hpp"
+
+namespace {
+
+void add(ResourceUsage& total, const ResourceUsage& usage, int sign) {
+    total.vms += sign * usage.vms;
+    total.cpu += sign * usage.cpu;
+    total.ram += sign * usage.ram;
+    total.storage += sign * usage.storage;
+}
+
+} // namespace
+
+UsageTracker& UsageTracker::instance() {
+    static UsageTracker tracker;
+    return tracker;
+}
+
+void UsageTracker::update(const std::string& name, const DomainEntry* entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = byDomain.find(name);
+    if (it != byDomain.end()) {
+        auto owner = byOwner.find(it->second.owner);
+        add(owner->second, it->second.usage, -1);
+        if (owner->second.vms == 0) byOwner.erase(owner);
+        byDomain.erase(it);
+    }
+
+    // Domains not named userid__hostname__timestamp belong to nobody
+    if (!entry || entry->owner.empty()) return;
+
+    Contribution contribution;
+    contribution.owner = entry->owner;
+    contribution.usage.vms = 1;
+    contribution.usage.cpu = static_cast<int>(entry->vcpus);
+    contribution.usage.ram = static_cast<long long>(entry->memory / 1024);
+    contribution.usage.storage = static_cast<long long>(entry->storage);
+
+    add(byOwner[contribution.owner], contribution.usage, 1);
+    byDomain.emplace(name, std::move(contribution));
+}
+
+ResourceUsage UsageTracker::get(const std::string& owner) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = byOwner.find(owner);
+    return it == byOwner.end() ? ResourceUsage() : it->second;
+}
+
+void UsageTracker::reserve(const std::string& name, const std::string& owner,
+                           const ResourceUsage& usage) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = reservations.find(name);
+    if (it != reservations.end()) {
+        auto held = reservedByOwner.find(it->second.owner);
+        add(held->second, it->second.usage, -1);
+        if (held->second.vms == 0) reservedByOwner.erase(held);
+    }
+
+    add(reservedByOwner[owner], usage, 1);
+    reservations[name] = Contribution{owner, usage};
+}
+
+void UsageTracker::release(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = reservations.find(name);
+    if (it == reservations.end()) return;
+
+    auto held = reservedByOwner.find(it->second.owner);
+    add(held->second, it->second.usage, -1);
+    if (held->second.vms == 0) reservedByOwner.erase(held);
+    reservations.erase(it);
+}
+
+ResourceUsage UsageTracker::reserved(const std::string& owner) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = reservedByOwner.find(owner);
+    return it == reservedByOwner.end() ? ResourceUsage() : it->second;
+}
+
+void UsageTracker::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    byDomain.clear();
+    byOwner.clear();
+}
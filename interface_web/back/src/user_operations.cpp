@@ -1,50 +1,20 @@
 #include "../include/user_operations.hpp"
 #include "../include/utils.hpp"
 #include "../include/vm_lookup.hpp"
+#include "../include/user_store.hpp"
+#include "../include/usage_tracker.hpp"
+#include "../include/domain_inventory.hpp"
 
-#include <fstream>
 #include <iostream>
-#include <sys/stat.h>
 
 UserOperations::UserOperations(virConnectPtr connection) 
     : conn(connection), usersFile("/var/lib/thoth-cloud/users.json") {
     loadUsers();
 }
 
+// Users live in the process-wide UserStore; only the first call loads them
 void UserOperations::loadUsers() {
-    std::ifstream file(usersFile);
-    if (file.is_open()) {
-        try {
-            file >> users;
-        } catch (const std::exception& e) {
-            std::cerr << "Error loading users: " << e.what() << std::endl;
-            users = json::array();
-        }
-        file.close();
-    } else {
-        users = json::array();
-    }
-}
-
-bool UserOperations::saveUsers() {
-    // Create directory if it doesn't exist
-    std::string dir = "/var/lib/thoth-cloud";
-    mkdir(dir.c_str(), 0755);
-    
-    std::ofstream file(usersFile);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open users file for writing" << std::endl;
-        return false;
-    }
-    
-    try {
-        file << users.dump(2);
-        file.close();
-        return true;
-    } catch (const std::exception& e) {
-        std::cerr << "Error saving users: " << e.what() << std::endl;
-        return false;
-    }
+    UserStore::instance().open(usersFile);
 }
 
 json UserOperations::createUser(const json& userData) {
@@ -58,17 +28,8 @@ json UserOperations::createUser(const json& userData) {
     
     std::string username = userData["username"];
     
-    // Check if user already exists
-    for (const auto& user : users) {
-        if (user["username"] == username) {
-            result["error"] = "User already exists";
-            return result;
-        }
-    }
-    
-    // Create new user
+    // Create new user; the store assigns its id
     json newUser = {
-        {"id", users.size() + 1},
         {"username", username},
         {"role", userData.value("role", "user")},
         {"email", userData.value("email", "")},
@@ -88,13 +49,12 @@ json UserOperations::createUser(const json& userData) {
         {"active", true}
     };
     
-    users.push_back(newUser);
-    
-    if (saveUsers()) {
+    std::string error;
+    if (UserStore::instance().insert(newUser, error)) {
         result["success"] = true;
         result["user"] = newUser;
     } else {
-        result["error"] = "Failed to save user";
+        result["error"] = error;
     }
     
     return result;
@@ -119,16 +79,18 @@ json UserOperations::checkUserQuota(const std::string& username, const json& vmR
         return result;
     }
     
-    // Extract requested resources
-    int requestedVCPU = vmRequest["vcpus"].get<int>();
-    int requestedRAM = vmRequest["memory"].get<int>();
-    int requestedDisk = vmRequest["disk"].get<int>();
+    // Extract requested resources; batch deployments ask for `count` identical VMs
+    int requestedVMs = vmRequest.value("count", 1);
+    int requestedVCPU = vmRequest["vcpus"].get<int>() * requestedVMs;
+    int requestedRAM = vmRequest["memory"].get<int>() * requestedVMs;
+    int requestedDisk = vmRequest["disk"].get<int>() * requestedVMs;
     
-    // Current usage
-    int currentVMs = usage["usage"]["vms"].get<int>();
-    int currentCPU = usage["usage"]["cpu"].get<int>();
-    int currentRAM = usage["usage"]["ram"].get<int>();
-    long long currentStorage = usage["usage"]["storage"].get<long long>();
+    // Current usage, including deploys that are queued or still running
+    ResourceUsage reserved = UsageTracker::instance().reserved(username);
+    int currentVMs = usage["usage"]["vms"].get<int>() + reserved.vms;
+    int currentCPU = usage["usage"]["cpu"].get<int>() + reserved.cpu;
+    int currentRAM = usage["usage"]["ram"].get<int>() + static_cast<int>(reserved.ram);
+    long long currentStorage = usage["usage"]["storage"].get<long long>() + reserved.storage;
     
     // Quotas
     int maxVMs = user["quotas"]["maxVMs"].get<int>();
@@ -137,11 +99,11 @@ json UserOperations::checkUserQuota(const std::string& username, const json& vmR
     long long maxStorage = user["quotas"]["maxStorage"].get<long long>() * 1024LL * 1024LL * 1024LL; // GB to bytes
     
     // Check each quota
-    if (currentVMs + 1 > maxVMs) {
+    if (currentVMs + requestedVMs > maxVMs) {
         result["error"] = "VM quota exceeded";
         result["details"] = {
             {"current", currentVMs},
-            {"requested", 1},
+            {"requested", requestedVMs},
             {"max", maxVMs},
             {"resource", "VMs"}
         };
@@ -184,7 +146,7 @@ json UserOperations::checkUserQuota(const std::string& username, const json& vmR
     
     result["allowed"] = true;
     result["remaining"] = {
-        {"vms", maxVMs - currentVMs - 1},
+        {"vms", maxVMs - currentVMs - requestedVMs},
         {"cpu", maxCPU - currentCPU - requestedVCPU},
         {"ram", maxRAM - currentRAM - requestedRAM},
         {"storage", (maxStorage - currentStorage - requestedStorageBytes) / (1024*1024*1024)}
@@ -197,7 +159,7 @@ json UserOperations::checkUserQuota(const std::string& username, const json& vmR
 json UserOperations::listUsers() {
     json result;
     result["success"] = true;
-    result["users"] = users;
+    result["users"] = UserStore::instance().list();
     return result;
 }
 
@@ -205,12 +167,11 @@ json UserOperations::getUser(const std::string& username) {
     json result;
     result["success"] = false;
     
-    for (const auto& user : users) {
-        if (user["username"] == username) {
-            result["success"] = true;
-            result["user"] = user;
-            return result;
-        }
+    json user;
+    if (UserStore::instance().get(username, user)) {
+        result["success"] = true;
+        result["user"] = user;
+        return result;
     }
     
     result["error"] = "User not found";
@@ -221,38 +182,34 @@ json UserOperations::updateUser(const std::string& username, const json& updates
     json result;
     result["success"] = false;
     
-    for (auto& user : users) {
-        if (user["username"] == username) {
-            // Update fields
-            if (updates.contains("role")) {
-                user["role"] = updates["role"];
-            }
-            if (updates.contains("email")) {
-                user["email"] = updates["email"];
-            }
-            if (updates.contains("active")) {
-                user["active"] = updates["active"];
-            }
-            
-            // Update quotas
-            if (updates.contains("quotas")) {
-                for (auto& [key, value] : updates["quotas"].items()) {
-                    user["quotas"][key] = value;
-                }
-            }
-            
-            if (saveUsers()) {
-                result["success"] = true;
-                result["user"] = user;
-            } else {
-                result["error"] = "Failed to save changes";
+    json updated;
+    std::string error;
+    bool saved = UserStore::instance().update(username, [&updates](json& user) {
+        if (updates.contains("role")) {
+            user["role"] = updates["role"];
+        }
+        if (updates.contains("email")) {
+            user["email"] = updates["email"];
+        }
+        if (updates.contains("active")) {
+            user["active"] = updates["active"];
+        }
+        
+        // Update quotas
+        if (updates.contains("quotas")) {
+            for (auto& [key, value] : updates["quotas"].items()) {
+                user["quotas"][key] = value;
             }
-            
-            return result;
         }
+    }, updated, error);
+    
+    if (saved) {
+        result["success"] = true;
+        result["user"] = updated;
+    } else {
+        result["error"] = error;
     }
     
-    result["error"] = "User not found";
     return result;
 }
 
@@ -260,22 +217,14 @@ json UserOperations::deleteUser(const std::string& username) {
     json result;
     result["success"] = false;
     
-    for (size_t i = 0; i < users.size(); i++) {
-        if (users[i]["username"] == username) {
-            users.erase(users.begin() + i);
-            
-            if (saveUsers()) {
-                result["success"] = true;
-                result["message"] = "User deleted successfully";
-            } else {
-                result["error"] = "Failed to save changes";
-            }
-            
-            return result;
-        }
+    std::string error;
+    if (UserStore::instance().remove(username, error)) {
+        result["success"] = true;
+        result["message"] = "User deleted successfully";
+    } else {
+        result["error"] = error;
     }
     
-    result["error"] = "User not found";
     return result;
 }
 
@@ -319,16 +268,8 @@ json UserOperations::getUserUsage(const std::string& username) {
     json result;
     result["success"] = false;
     
-    // Find user
-    json* userPtr = nullptr;
-    for (auto& user : users) {
-        if (user["username"] == username) {
-            userPtr = &user;
-            break;
-        }
-    }
-    
-    if (!userPtr) {
+    json user;
+    if (!UserStore::instance().get(username, user)) {
         result["error"] = "User not found";
         return result;
     }
@@ -339,7 +280,14 @@ json UserOperations::getUserUsage(const std::string& username) {
     int totalRAM = 0;
     long long totalStorage = 0;
     
-    if (conn) {
+    if (DomainInventory::instance().isReady()) {
+        // Counters kept current by domain events
+        ResourceUsage tracked = UsageTracker::instance().get(username);
+        vmCount = tracked.vms;
+        totalCPU = tracked.cpu;
+        totalRAM = static_cast<int>(tracked.ram);
+        totalStorage = tracked.storage;
+    } else if (conn) {
         virDomainPtr* domains;
         int numDomains = listUserDomains(&domains, username, 0);
         
@@ -375,26 +323,25 @@ json UserOperations::getUserUsage(const std::string& username) {
         }
     }
     
-    // Update user usage
-    (*userPtr)["usage"] = {
+    // Usage is recomputed from the VMs, so it is not persisted
+    json usage = {
         {"vms", vmCount},
         {"cpu", totalCPU},
         {"ram", totalRAM},
         {"storage", totalStorage}
     };
-    
-    saveUsers();
+    UserStore::instance().setUsage(username, usage);
     
     result["success"] = true;
-    result["usage"] = (*userPtr)["usage"];
-    result["quotas"] = (*userPtr)["quotas"];
+    result["usage"] = usage;
+    result["quotas"] = user["quotas"];
     
     // Calculate percentage used
     json percentages = {
-        {"vms", (vmCount * 100.0) / (*userPtr)["quotas"]["maxVMs"].get<int>()},
-        {"cpu", (totalCPU * 100.0) / (*userPtr)["quotas"]["maxCPU"].get<int>()},
-        {"ram", (totalRAM * 100.0) / (*userPtr)["quotas"]["maxRAM"].get<int>()},
-        {"storage", (totalStorage * 100.0) / (*userPtr)["quotas"]["maxStorage"].get<int>()}
+        {"vms", (vmCount * 100.0) / user["quotas"]["maxVMs"].get<int>()},
+        {"cpu", (totalCPU * 100.0) / user["quotas"]["maxCPU"].get<int>()},
+        {"ram", (totalRAM * 100.0) / user["quotas"]["maxRAM"].get<int>()},
+        {"storage", (totalStorage * 100.0) / user["quotas"]["maxStorage"].get<int>()}
     };
     
     result["percentages"] = percentages;
@@ -407,7 +354,7 @@ json UserOperations::getAllUsersUsage() {
     result["success"] = true;
     result["users"] = json::array();
     
-    for (const auto& user : users) {
+    for (const auto& user : UserStore::instance().list()) {
         std::string username = user["username"];
         json userUsage = getUserUsage(username);
         
@@ -429,14 +376,13 @@ json UserOperations::getAllUsersUsage() {
 bool UserOperations::checkQuota(const std::string& username, 
                                const std::string& resource, 
                                int requestedAmount) {
-    for (const auto& user : users) {
-        if (user["username"] == username) {
-            int currentUsage = user["usage"][resource].get<int>();
-            int maxQuota = user["quotas"]["max" + resource].get<int>();
-            
-            return (currentUsage + requestedAmount) <= maxQuota;
-        }
+    json user;
+    if (!UserStore::instance().get(username, user)) {
+        return false;
     }
     
-    return false;
+    int currentUsage = user["usage"][resource].get<int>();
+    int maxQuota = user["quotas"]["max" + resource].get<int>();
+    
+    return (currentUsage + requestedAmount) <= maxQuota;
 }
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include "../include/user_store.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::string directoryOf(const std::string& path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+bool writeAll(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+// Make a rename in `dir` durable
+void syncDirectory(const std::string& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        ::close(fd);
+    }
+}
+
+} // namespace
+
+UserStore& UserStore::instance() {
+    static UserStore store;
+    return store;
+}
+
+bool UserStore::open(const std::string& path) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (loaded) return true;
+
+    snapshotPath = path;
+    journalPath = path + ".journal";
+    mkdir(directoryOf(path).c_str(), 0755);
+
+    std::ifstream snapshot(snapshotPath);
+    if (snapshot.is_open()) {
+        try {
+            json stored;
+            snapshot >> stored;
+            for (const auto& user : stored) {
+                if (user.contains("username")) put(user);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error loading users: " << e.what() << std::endl;
+        }
+    }
+
+    // A torn last line is a write that never completed
+    bool torn = false;
+    std::ifstream journal(journalPath);
+    std::string line;
+    while (std::getline(journal, line)) {
+        if (line.empty()) continue;
+        try {
+            if (!applyRecord(json::parse(line))) torn = true;
+        } catch (const std::exception&) {
+            torn = true;
+        }
+        if (torn) {
+            std::cerr << "Ignoring incomplete user journal record" << std::endl;
+            break;
+        }
+        journalRecords++;
+    }
+
+    journalFd = ::open(journalPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    if (journalFd < 0) {
+        std::cerr << "Failed to open user journal " << journalPath << ": "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+
+    loaded = true;
+
+    // Start over from a clean journal rather than appending after garbage
+    if (torn || journalRecords >= COMPACT_AFTER_RECORDS) {
+        writeSnapshot();
+    }
+
+    std::cout << "Loaded " << users.size() << " user(s)" << std::endl;
+    return true;
+}
+
+void UserStore::close() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (journalFd < 0) return;
+
+    if (journalRecords > 0) writeSnapshot();
+    ::close(journalFd);
+    journalFd = -1;
+}
+
+bool UserStore::get(const std::string& username, json& user) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = users.find(username);
+    if (it == users.end()) return false;
+    user = withUsage(it->second);
+    return true;
+}
+
+bool UserStore::exists(const std::string& username) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return users.count(username) > 0;
+}
+
+json UserStore::list() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    json result = json::array();
+    for (const auto& username : order) {
+        result.push_back(withUsage(users.at(username)));
+    }
+    return result;
+}
+
+std::vector<std::string> UserStore::usernames() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return order;
+}
+
+bool UserStore::insert(json& user, std::string& error) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+
+    std::string username = user["username"];
+    if (users.count(username)) {
+        error = "User already exists";
+        return false;
+    }
+
+    user["id"] = nextId;
+    if (!appendRecord({{"op", "put"}, {"user", user}}, error)) return false;
+    put(user);
+    compactIfDue();
+    return true;
+}
+
+bool UserStore::update(const std::string& username, const std::function<void(json&)>& mutate,
+                       json& updated, std::string& error) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+
+    auto it = users.find(username);
+    if (it == users.end()) {
+        error = "User not found";
+        return false;
+    }
+
+    json user = it->second;
+    mutate(user);
+    user["username"] = username;
+
+    if (!appendRecord({{"op", "put"}, {"user", user}}, error)) return false;
+    it->second = user;
+    updated = withUsage(user);
+    compactIfDue();
+    return true;
+}
+
+bool UserStore::remove(const std::string& username, std::string& error) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+
+    if (!users.count(username)) {
+        error = "User not found";
+        return false;
+    }
+
+    if (!appendRecord({{"op", "delete"}, {"username", username}}, error)) return false;
+    users.erase(username);
+    usage.erase(username);
+    order.erase(std::find(order.begin(), order.end(), username));
+    compactIfDue();
+    return true;
+}
+
+void UserStore::setUsage(const std::string& username, const json& measured) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (users.count(username)) {
+        usage[username] = measured;
+    }
+}
+
+bool UserStore::compact() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    return writeSnapshot();
+}
+
+bool UserStore::appendRecord(const json& record, std::string& error) {
+    if (journalFd < 0) {
+        error = "User store is not open";
+        return false;
+    }
+
+    // Replay stops at the first unreadable line, so a half-written
+    // record must not stay in front of the next ones
+    off_t end = lseek(journalFd, 0, SEEK_END);
+    if (!writeAll(journalFd, record.dump() + "\n") || fdatasync(journalFd) < 0) {
+        std::cerr << "Failed to write user journal: " << strerror(errno) << std::endl;
+        if (end >= 0 && ftruncate(journalFd, end) != 0) {
+            std::cerr << "Failed to roll back user journal" << std::endl;
+        }
+        error = "Failed to save changes";
+        return false;
+    }
+
+    journalRecords++;
+    return true;
+}
+
+void UserStore::compactIfDue() {
+    if (journalRecords >= COMPACT_AFTER_RECORDS) {
+        writeSnapshot();
+    }
+}
+
+bool UserStore::writeSnapshot() {
+    if (journalFd < 0) return false;
+
+    json all = json::array();
+    for (const auto& username : order) {
+        all.push_back(users.at(username));
+    }
+
+    std::string tmpPath = snapshotPath + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open users file for writing: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    bool ok = writeAll(fd, all.dump(2)) && fsync(fd) == 0;
+    ::close(fd);
+
+    if (!ok || rename(tmpPath.c_str(), snapshotPath.c_str()) != 0) {
+        std::cerr << "Failed to write users snapshot: " << strerror(errno) << std::endl;
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    syncDirectory(directoryOf(snapshotPath));
+
+    // Everything in the journal is in the snapshot now
+    if (ftruncate(journalFd, 0) != 0) {
+        std::cerr << "Failed to truncate user journal: " << strerror(errno) << std::endl;
+        return false;
+    }
+    journalRecords = 0;
+    return true;
+}
+
+bool UserStore::applyRecord(const json& record) {
+    std::string op = record.value("op", "");
+    if (op == "put" && record.contains("user") && record["user"].contains("username")) {
+        put(record["user"]);
+        return true;
+    }
+    if (op == "delete" && record.contains("username")) {
+        std::string username = record["username"];
+        if (users.erase(username)) {
+            order.erase(std::find(order.begin(), order.end(), username));
+        }
+        return true;
+    }
+    return false;
+}
+
+void UserStore::put(const json& user) {
+    std::string username = user["username"];
+
+    auto it = users.find(username);
+    if (it == users.end()) {
+        users.emplace(username, user);
+        order.push_back(username);
+    } else {
+        it->second = user;
+    }
+
+    if (user.contains("id") && user["id"].is_number_integer()) {
+        nextId = std::max(nextId, user["id"].get<long long>() + 1);
+    }
+}
+
+json UserStore::withUsage(const json& user) const {
+    auto it = usage.find(user["username"].get<std::string>());
+    if (it == usage.end()) return user;
+
+    json result = user;
+    result["usage"] = it->second;
+    return result;
+}
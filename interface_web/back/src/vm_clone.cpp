@@ -0,0 +1,592 @@
+#include "../include/vm_clone.hpp"
+#include "../include/domain_model.hpp"
+#include "../include/job_manager.hpp"
+#include "../include/remote_executor.hpp"
+#include "../include/storage_backend.hpp"
+#include "../include/utils.hpp"
+#include "../include/metrics.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sstream>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+// Shared base images; overlays point at them, so they are never copied per VM
+const std::string BASE_IMAGE_DIR = "/var/lib/libvirt/images/baseimg/";
+
+// Largest single copy_file_range / pread+pwrite call
+constexpr size_t COPY_CHUNK = 8 * 1024 * 1024;
+
+// How often the job thread publishes copy progress
+constexpr int PROGRESS_INTERVAL_MS = 500;
+
+bool isBaseImage(const std::string& path) {
+    return path.compare(0, BASE_IMAGE_DIR.size(), BASE_IMAGE_DIR) == 0;
+}
+
+std::string xmlEscape(const std::string& value) {
+    std::string out;
+    out.reserve(value.size());
+    for (char c : value) {
+        switch (c) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            case '\'': out += "&apos;"; break;
+            case '"': out += "&quot;"; break;
+            default: out += c;
+        }
+    }
+    return out;
+}
+
+std::string lastError() {
+    virErrorPtr err = virGetLastError();
+    return err && err->message ? err->message : "unknown libvirt error";
+}
+
+std::string directoryOf(const std::string& path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+std::string fileNameOf(const std::string& path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+void replaceFirst(std::string& text, const std::string& from, const std::string& to) {
+    size_t at = text.find(from);
+    if (at != std::string::npos) text.replace(at, from.size(), to);
+}
+
+void replaceAll(std::string& text, const std::string& from, const std::string& to) {
+    for (size_t at = text.find(from); at != std::string::npos; at = text.find(from, at + to.size())) {
+        text.replace(at, from.size(), to);
+    }
+}
+
+// Remove every element starting with `open` up to and including `close`
+void eraseElements(std::string& text, const std::string& open, const std::string& close) {
+    for (size_t at = text.find(open); at != std::string::npos; at = text.find(open, at)) {
+        size_t end = text.find(close, at);
+        if (end == std::string::npos) return;
+        text.erase(at, end + close.size() - at);
+    }
+}
+
+} // namespace
+
+std::string clonePathFor(const std::string& path, const std::string& source,
+                         const std::string& cloneName, const std::string& targetDev) {
+    std::string dir = directoryOf(path);
+    std::string file = fileNameOf(path);
+
+    size_t at = file.find(source);
+    if (at != std::string::npos) {
+        return dir + file.substr(0, at) + cloneName + file.substr(at + source.size());
+    }
+
+    size_t dot = file.rfind('.');
+    std::string extension = dot == std::string::npos ? "" : file.substr(dot);
+    return dir + cloneName + "-" + targetDev + extension;
+}
+
+std::string frozenTopPath(const std::string& path, long long stamp) {
+    std::string file = fileNameOf(path);
+    size_t dot = file.rfind('.');
+    std::string stem = dot == std::string::npos ? file : file.substr(0, dot);
+    return directoryOf(path) + stem + "-" + std::to_string(stamp) + ".qcow2";
+}
+
+std::string buildCloneXML(std::string xml, const std::string& source, const std::string& cloneName,
+                          const std::vector<std::pair<std::string, std::string>>& paths) {
+    replaceFirst(xml, "<name>" + xmlEscape(source) + "</name>", "<name>" + xmlEscape(cloneName) + "</name>");
+    eraseElements(xml, "<uuid>", "</uuid>");
+    eraseElements(xml, "<mac address=", "/>");
+
+    for (const auto& path : paths) {
+        std::string from = xmlEscape(path.first);
+        std::string to = xmlEscape(path.second);
+        replaceAll(xml, "'" + from + "'", "'" + to + "'");
+        replaceAll(xml, "\"" + from + "\"", "\"" + to + "\"");
+    }
+    return xml;
+}
+
+namespace {
+
+// Copy `length` bytes at `offset`, preferring in-kernel copies
+bool copyRange(int in, int out, off_t offset, off_t length,
+               std::atomic<long long>& copied, std::string& error) {
+    off_t inOffset = offset;
+    off_t outOffset = offset;
+    bool kernelCopy = true;
+    std::vector<char> buffer;
+
+    while (length > 0) {
+        size_t chunk = static_cast<size_t>(std::min<off_t>(length, COPY_CHUNK));
+        ssize_t n;
+
+        if (kernelCopy) {
+            n = copy_file_range(in, &inOffset, out, &outOffset, chunk, 0);
+            if (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL ||
+                          errno == EOPNOTSUPP)) {
+                kernelCopy = false;
+                continue;
+            }
+        } else {
+            if (buffer.empty()) buffer.resize(COPY_CHUNK);
+            n = pread(in, buffer.data(), chunk, inOffset);
+            for (ssize_t written = 0; n > 0 && written < n; ) {
+                ssize_t w = pwrite(out, buffer.data() + written, n - written, outOffset + written);
+                if (w < 0) {
+                    if (errno == EINTR) continue;
+                    n = -1;
+                    break;
+                }
+                written += w;
+            }
+            if (n > 0) {
+                inOffset += n;
+                outOffset += n;
+            }
+        }
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            error = strerror(errno);
+            return false;
+        }
+        if (n == 0) break;   // source shrank underneath us
+
+        length -= n;
+        copied += n;
+    }
+    return true;
+}
+
+// Copy the allocated extents of `in`; holes stay holes in `out`
+bool copyExtents(int in, int out, off_t size, std::atomic<long long>& copied, std::string& error) {
+    if (ftruncate(out, size) < 0) {
+        error = strerror(errno);
+        return false;
+    }
+
+    off_t pos = 0;
+    while (pos < size) {
+        off_t data = lseek(in, pos, SEEK_DATA);
+        off_t hole;
+        if (data < 0) {
+            if (errno == ENXIO) {          // only a hole is left
+                copied += size - pos;
+                break;
+            }
+            data = pos;                    // no SEEK_DATA here: copy everything
+            hole = size;
+        } else {
+            hole = lseek(in, data, SEEK_HOLE);
+            if (hole < 0) hole = size;
+        }
+
+        copied += data - pos;              // skipped holes count as done
+        if (!copyRange(in, out, data, hole - data, copied, error)) return false;
+        pos = hole;
+    }
+    return true;
+}
+
+bool copyLocalFile(const std::string& src, const std::string& dst,
+                   std::atomic<long long>& copied, std::string& error) {
+    int in = open(src.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        error = src + ": " + strerror(errno);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(in, &st) < 0) {
+        error = src + ": " + strerror(errno);
+        close(in);
+        return false;
+    }
+
+    int out = open(dst.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 0777);
+    if (out < 0) {
+        error = dst + ": " + strerror(errno);
+        close(in);
+        return false;
+    }
+
+    bool ok;
+    if (ioctl(out, FICLONE, in) == 0) {
+        // Reflink (btrfs, XFS): extents are shared until either side writes
+        copied += st.st_size;
+        ok = true;
+    } else {
+        ok = copyExtents(in, out, st.st_size, copied, error);
+        if (!ok) error = dst + ": " + error;
+    }
+
+    if (ok && fsync(out) < 0) {
+        error = dst + ": " + strerror(errno);
+        ok = false;
+    }
+
+    close(out);
+    close(in);
+    if (!ok) unlink(dst.c_str());
+    return ok;
+}
+
+} // namespace
+
+bool parseCloneMode(const std::string& value, CloneMode& mode) {
+    if (value == "full") {
+        mode = CloneMode::Full;
+        return true;
+    }
+    if (value == "linked") {
+        mode = CloneMode::Linked;
+        return true;
+    }
+    return false;
+}
+
+const char* cloneModeName(CloneMode mode) {
+    return mode == CloneMode::Linked ? "linked" : "full";
+}
+
+CloneOperations::CloneOperations(virConnectPtr connection)
+    : conn(connection), remote(RemoteExec::resolveTarget(connection, target)) {}
+
+bool CloneOperations::clone(const std::string& source, const std::string& cloneName,
+                            CloneMode mode, std::string& error) {
+    if (!conn) {
+        error = "No libvirt connection";
+        return false;
+    }
+
+    JobManager::beginStep("prepare");
+
+    virDomainPtr existing = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                        [&] { return virDomainLookupByName(conn, cloneName.c_str()); });
+    if (existing) {
+        virDomainFree(existing);
+        error = "A VM named " + cloneName + " already exists";
+        return false;
+    }
+
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, source.c_str()); });
+    if (!domain) {
+        error = "VM not found";
+        return false;
+    }
+
+    virDomainInfo info;
+    if (virDomainGetInfo(domain, &info) < 0) {
+        error = lastError();
+        virDomainFree(domain);
+        return false;
+    }
+    if (mode == CloneMode::Full && info.state != VIR_DOMAIN_SHUTOFF) {
+        error = "The VM must be stopped for a full clone";
+        virDomainFree(domain);
+        return false;
+    }
+
+    // The persistent definition: live XML carries runtime-only elements
+    // (aliases, vnc ports) that should not end up in the clone
+    char* xmlDesc = timeLibvirt(LibvirtCall::DomainGetXMLDesc,
+                                [&] { return virDomainGetXMLDesc(domain, VIR_DOMAIN_XML_INACTIVE); });
+    if (!xmlDesc) {
+        error = lastError();
+        virDomainFree(domain);
+        return false;
+    }
+    std::string xml = stripBackingStores(xmlDesc);
+    free(xmlDesc);
+
+    DomainModel model;
+    std::vector<DiskPlan> plans;
+    if (!parseDomainXML(xml, model) || !planDisks(model, source, cloneName, mode, plans, error)) {
+        if (error.empty()) error = "Failed to parse domain XML";
+        virDomainFree(domain);
+        return false;
+    }
+
+    fprintf(stdout, "Cloning %s to %s (%s, %zu disk(s))\n", source.c_str(), cloneName.c_str(),
+            cloneModeName(mode), plans.size());
+
+    std::vector<std::pair<std::string, std::string>> paths;
+    for (const auto& plan : plans) {
+        paths.emplace_back(plan.sourcePath, plan.clonePath);
+    }
+
+    bool ok;
+    if (mode == CloneMode::Linked) {
+        JobManager::beginStep("snapshot");
+        ok = freezeSource(domain, model, plans, error);
+        if (ok) {
+            JobManager::beginStep("overlay");
+            ok = createOverlays(plans, error);
+        }
+    } else {
+        JobManager::beginStep("copy");
+        ok = copyDisks(plans, error);
+    }
+    virDomainFree(domain);
+
+    if (ok) {
+        JobManager::beginStep("define");
+        std::string cloneXML = buildCloneXML(xml, source, cloneName, paths);
+        virDomainPtr created = timeLibvirt(LibvirtCall::DomainDefineXML,
+                                           [&] { return virDomainDefineXML(conn, cloneXML.c_str()); });
+        if (created) {
+            virDomainFree(created);
+        } else {
+            error = "Failed to define clone: " + lastError();
+            ok = false;
+        }
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Clone of %s failed: %s\n", source.c_str(), error.c_str());
+        removeCreated(plans);
+        return false;
+    }
+
+    fprintf(stdout, "Cloned %s to %s\n", source.c_str(), cloneName.c_str());
+    return true;
+}
+
+bool CloneOperations::planDisks(const DomainModel& model, const std::string& source,
+                                const std::string& cloneName, CloneMode mode,
+                                std::vector<DiskPlan>& plans, std::string& error) {
+    for (const auto& disk : model.disks) {
+        if (disk.source.empty() || isBaseImage(disk.source)) continue;
+
+        if (disk.type != "file") {
+            // Block and network disks cannot be duplicated here; sharing
+            // them between two VMs would corrupt them
+            if (!disk.readonly) {
+                error = "Disk " + disk.targetDev + " is not a file and cannot be cloned";
+                return false;
+            }
+            continue;
+        }
+
+        // Read-only media only follow when they belong to the VM (its
+        // cloud-init seed); shared ISOs keep being shared
+        if (disk.readonly && fileNameOf(disk.source).find(source) == std::string::npos) continue;
+
+        DiskPlan plan;
+        plan.targetDev = disk.targetDev;
+        plan.format = disk.driverType.empty() ? "raw" : disk.driverType;
+        plan.sourcePath = disk.source;
+        plan.clonePath = clonePathFor(disk.source, source, cloneName, disk.targetDev);
+        plan.overlay = mode == CloneMode::Linked && disk.device == "disk" && !disk.readonly;
+
+        // The clone keeps the source's <driver type>, so its overlay must match
+        if (plan.overlay && plan.format != "qcow2") {
+            error = "Disk " + disk.targetDev + " is " + plan.format + "; linked clones need qcow2 disks";
+            return false;
+        }
+
+        if (plan.clonePath == plan.sourcePath) {
+            error = "Cannot derive a new image path for " + disk.source;
+            return false;
+        }
+        plans.push_back(plan);
+    }
+    return true;
+}
+
+bool CloneOperations::freezeSource(virDomainPtr domain, const DomainModel& model,
+                                   const std::vector<DiskPlan>& plans, std::string& error) {
+    long long stamp = static_cast<long long>(time(nullptr));
+
+    // Every disk is listed: unlisted ones would get libvirt's default
+    // external snapshot with a generated file name
+    std::stringstream xml;
+    xml << "<domainsnapshot><name>clone-" << stamp << "</name><disks>";
+    for (const auto& disk : model.disks) {
+        if (disk.targetDev.empty()) continue;
+
+        auto plan = std::find_if(plans.begin(), plans.end(), [&](const DiskPlan& p) {
+            return p.overlay && p.targetDev == disk.targetDev;
+        });
+        if (plan == plans.end()) {
+            xml << "<disk name='" << xmlEscape(disk.targetDev) << "' snapshot='no'/>";
+            continue;
+        }
+        xml << "<disk name='" << xmlEscape(disk.targetDev) << "' snapshot='external'>"
+            << "<driver type='qcow2'/>"
+            << "<source file='" << xmlEscape(frozenTopPath(plan->sourcePath, stamp)) << "'/>"
+            << "</disk>";
+    }
+    xml << "</disks></domainsnapshot>";
+
+    // Atomic: either every disk moves to its new top image or none does.
+    // No metadata: the snapshot only exists to freeze the images.
+    unsigned int flags = VIR_DOMAIN_SNAPSHOT_CREATE_DISK_ONLY |
+                         VIR_DOMAIN_SNAPSHOT_CREATE_NO_METADATA |
+                         VIR_DOMAIN_SNAPSHOT_CREATE_ATOMIC;
+    virDomainSnapshotPtr snapshot = timeLibvirt(LibvirtCall::DomainSnapshotCreateXML, [&] {
+        return virDomainSnapshotCreateXML(domain, xml.str().c_str(), flags);
+    });
+    if (!snapshot) {
+        error = "Failed to snapshot source disks: " + lastError();
+        return false;
+    }
+    virDomainSnapshotFree(snapshot);
+    return true;
+}
+
+bool CloneOperations::createOverlays(std::vector<DiskPlan>& plans, std::string& error) {
+    StorageBackend storage(conn);
+    RemoteExec::RemoteExecutor remoteExec(conn);
+
+    for (auto& plan : plans) {
+        if (!plan.overlay) continue;
+
+        long long capacity = storage.volumeCapacity(plan.sourcePath);
+        std::string storageError;
+        if (capacity > 0 &&
+            storage.createOverlay(directoryOf(plan.clonePath), fileNameOf(plan.clonePath),
+                                  static_cast<unsigned long long>(capacity), plan.sourcePath,
+                                  storageError)) {
+            plan.created = true;
+            continue;
+        }
+
+        auto result = remoteExec.execute(
+            "qemu-img create -f qcow2 -F " + RemoteExec::SSHSession::shellQuote(plan.format) +
+            " -b " + RemoteExec::SSHSession::shellQuote(plan.sourcePath) + " " +
+            RemoteExec::SSHSession::shellQuote(plan.clonePath));
+        if (!result.success()) {
+            error = "Failed to create overlay " + plan.clonePath + ": " + result.output;
+            return false;
+        }
+        plan.created = true;
+    }
+
+    // Small read-only media (the cloud-init seed) are still copied
+    for (auto& plan : plans) {
+        if (plan.overlay) continue;
+        std::atomic<long long> ignored{0};
+        if (!copyDisk(plan, ignored, error)) return false;
+        plan.created = true;
+    }
+    return true;
+}
+
+bool CloneOperations::copyDisks(std::vector<DiskPlan>& plans, std::string& error) {
+    if (plans.empty()) return true;
+
+    // Bytes locally; over ssh only whole disks can be counted
+    long long total = 0;
+    for (const auto& plan : plans) {
+        struct stat st;
+        if (remote) {
+            total++;
+        } else if (stat(plan.sourcePath.c_str(), &st) == 0) {
+            total += st.st_size;
+        }
+    }
+    const char* unit = remote ? "disks" : "bytes";
+
+    std::atomic<long long> copied{0};
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> running{0};
+    std::vector<std::string> errors(plans.size());
+    std::vector<char> done(plans.size(), 0);
+
+    auto worker = [&]() {
+        for (size_t i = next++; i < plans.size(); i = next++) {
+            if (copyDisk(plans[i], copied, errors[i])) {
+                done[i] = 1;
+            }
+        }
+        running--;
+    };
+
+    size_t threadCount = std::min(plans.size(), MAX_PARALLEL_COPIES);
+    running = threadCount;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < threadCount; t++) {
+        threads.emplace_back(worker);
+    }
+
+    // Progress is published from the job's own thread
+    while (running > 0) {
+        JobManager::reportProgress(copied, total, unit);
+        std::this_thread::sleep_for(std::chrono::milliseconds(PROGRESS_INTERVAL_MS));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    JobManager::reportProgress(copied, total, unit);
+
+    bool ok = true;
+    for (size_t i = 0; i < plans.size(); i++) {
+        plans[i].created = done[i] != 0;
+        if (!done[i]) {
+            if (ok) error = errors[i];
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool CloneOperations::copyDisk(const DiskPlan& plan, std::atomic<long long>& copied, std::string& error) {
+    long long started = getCurrentTimeMs();
+
+    if (remote) {
+        RemoteExec::RemoteExecutor remoteExec(conn);
+        std::string dst = RemoteExec::SSHSession::shellQuote(plan.clonePath);
+        auto result = remoteExec.execute(
+            "test ! -e " + dst + " && { cp --reflink=auto --sparse=always " +
+            RemoteExec::SSHSession::shellQuote(plan.sourcePath) + " " + dst +
+            " || { rm -f " + dst + "; exit 1; }; }");
+        if (!result.success()) {
+            error = "Failed to copy " + plan.sourcePath + ": " + result.output;
+            return false;
+        }
+        copied++;
+    } else if (!copyLocalFile(plan.sourcePath, plan.clonePath, copied, error)) {
+        error = "Failed to copy " + plan.sourcePath + ": " + error;
+        return false;
+    }
+
+    fprintf(stdout, "Copied %s to %s in %lld ms\n", plan.sourcePath.c_str(),
+            plan.clonePath.c_str(), getCurrentTimeMs() - started);
+    return true;
+}
+
+void CloneOperations::removeCreated(const std::vector<DiskPlan>& plans) {
+    RemoteExec::RemoteExecutor remoteExec(conn);
+
+    for (const auto& plan : plans) {
+        if (!plan.created) continue;
+
+        if (remote) {
+            remoteExec.execute("rm -f " + RemoteExec::SSHSession::shellQuote(plan.clonePath));
+        } else if (unlink(plan.clonePath.c_str()) != 0 && errno != ENOENT) {
+            fprintf(stderr, "Failed to remove partial clone image %s: %s\n",
+                    plan.clonePath.c_str(), strerror(errno));
+        }
+    }
+}
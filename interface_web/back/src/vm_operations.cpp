@@ -2,15 +2,69 @@
 #include "../include/utils.hpp"
 #include "../include/validation.hpp"
 #include "../include/remote_executor.hpp"
+#include "../include/preflight.hpp"
+#include "../include/ssh_session.hpp"
+#include "../include/nocloud_iso.hpp"
+#include "../include/cloud_init_config.hpp"
+#include "../include/password_hash.hpp"
+#include "../include/storage_backend.hpp"
+#include "../include/vm_clone.hpp"
+#include "../include/domain_stats.hpp"
+#include "../include/domain_inventory.hpp"
+#include "../include/domain_model.hpp"
+#include "../include/stats_store.hpp"
+#include "../include/job_manager.hpp"
+#include "../include/metrics.hpp"
 
-#include <regex>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <unordered_map>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <libvirt/virterror.h>
 
+namespace {
+
+// Latest sampler point for a VM, or null when it has not been sampled yet
+json latestStats(const std::string& vmName) {
+    StatsPoint point;
+    if (!StatsStore::instance().latest(vmName, point)) {
+        return nullptr;
+    }
+    return statsToJson(point);
+}
+
+// State-only stats groups used when the inventory is unavailable
+constexpr unsigned int LISTING_STATS = VIR_DOMAIN_STATS_STATE |
+                                       VIR_DOMAIN_STATS_BALLOON |
+                                       VIR_DOMAIN_STATS_VCPU;
+
+json vmToJson(const DomainEntry& entry, const std::string& state) {
+    return {
+        {"id", entry.id},
+        {"name", entry.name},  // Internal name
+        {"displayName", entry.displayName},  // User-friendly name
+        {"owner", entry.owner.empty() ? "unknown" : entry.owner},
+        {"state", state},
+        {"running", entry.isRunning()},
+        {"stats", nullptr}
+    };
+}
+
+// Shared base images; overlays point at them, so they are never copied or deleted per VM
+const std::string BASE_IMAGE_DIR = "/var/lib/libvirt/images/baseimg/";
+
+// Where VM disks are provisioned
+const std::string IMAGES_DIR = "/var/lib/libvirt/images";
+
+bool isBaseImage(const std::string& path) {
+    return path.compare(0, BASE_IMAGE_DIR.size(), BASE_IMAGE_DIR) == 0;
+}
+
+} // namespace
+
 VMOperations::VMOperations(virConnectPtr connection) : conn(connection) {}
 
 std::string VMOperations::getStateString(int state) {
@@ -32,55 +86,63 @@ json VMOperations::listUserVMs(const std::string& userId) {
         return result;
     }
     
-    virDomainPtr* domains;
-    int numDomains = virConnectListAllDomains(conn, &domains, 0);
+    std::vector<DomainEntry> entries;
+    auto& inventory = DomainInventory::instance();
     
-    if (numDomains < 0) {
-        result["error"] = "Error listing VMs";
-        return result;
+    if (inventory.isReady()) {
+        // Served entirely from memory
+        entries = inventory.listByOwner(userId);
+    } else {
+        virDomainPtr* domains;
+        int numDomains = virConnectListAllDomains(conn, &domains, 0);
+        
+        if (numDomains < 0) {
+            result["error"] = "Error listing VMs";
+            return result;
+        }
+        
+        // Keep only the user's domains; ownership is encoded in the name so no RPC is needed
+        VMNameManager nameManager;
+        std::vector<virDomainPtr> userDomains;
+        
+        for (int i = 0; i < numDomains; i++) {
+            if (nameManager.isOwner(virDomainGetName(domains[i]), userId)) {
+                userDomains.push_back(domains[i]);
+            }
+        }
+        
+        // Fetch state for all of them in one round trip
+        std::vector<DomainStats::DomainSample> samples;
+        bool statsOk = DomainStats::collect(userDomains.data(), userDomains.size(), samples, LISTING_STATS);
+        
+        for (int i = 0; i < numDomains; i++) {
+            virDomainFree(domains[i]);
+        }
+        free(domains);
+        
+        if (!statsOk) {
+            result["error"] = "Error listing VMs";
+            return result;
+        }
+        
+        for (const auto& sample : samples) {
+            entries.push_back(DomainInventory::makeEntry(sample));
+        }
     }
     
-    VMNameManager nameManager;
     json vms = json::array();
     
-    for (int i = 0; i < numDomains; i++) {
-        const char* name = virDomainGetName(domains[i]);
+    for (const auto& entry : entries) {
+        json vm = vmToJson(entry, getStateString(entry.state));
+        vm["owner"] = userId;
         
-        // Check if VM belongs to user
-        if (nameManager.isOwner(name, userId)) {
-            virDomainInfo info;
-            virDomainGetInfo(domains[i], &info);
-            
-            int id = virDomainGetID(domains[i]);
-            std::string state = getStateString(info.state);
-            bool isRunning = (info.state == VIR_DOMAIN_RUNNING);
-            
-            // Parse name to get display name
-            auto nameInfo = nameManager.parseVMName(name);
-            std::string displayName = nameInfo.valid ? nameInfo.vmName : name;
-            
-            json vm = {
-                {"id", id},
-                {"name", name},  // Internal name
-                {"displayName", displayName},  // User-friendly name
-                {"state", state},
-                {"running", isRunning},
-                {"owner", userId},
-                {"stats", nullptr}
-            };
-            
-            if (isRunning) {
-                vm["stats"] = getVMStatsInternal(domains[i], name);
-            }
-            
-            vms.push_back(vm);
+        if (entry.isRunning()) {
+            vm["stats"] = latestStats(entry.name);
         }
         
-        virDomainFree(domains[i]);
+        vms.push_back(vm);
     }
     
-    free(domains);
-    
     result["success"] = true;
     result["vms"] = vms;
     result["count"] = vms.size();
@@ -98,51 +160,37 @@ json VMOperations::listAllVMs() {
         return result;
     }
     
-    virDomainPtr* domains;
-    int numDomains = virConnectListAllDomains(conn, &domains, 0);
+    std::vector<DomainEntry> entries;
+    auto& inventory = DomainInventory::instance();
     
-    if (numDomains < 0) {
-        result["error"] = "Error listing VMs";
-        return result;
+    if (inventory.isReady()) {
+        // Served entirely from memory
+        entries = inventory.list();
+    } else {
+        // State for every domain in one round trip
+        std::vector<DomainStats::DomainSample> samples;
+        if (!DomainStats::collectAll(conn, samples, 0, LISTING_STATS)) {
+            result["error"] = "Error listing VMs";
+            return result;
+        }
+        
+        for (const auto& sample : samples) {
+            entries.push_back(DomainInventory::makeEntry(sample));
+        }
     }
     
-    VMNameManager nameManager;
     json vms = json::array();
     
-    for (int i = 0; i < numDomains; i++) {
-        const char* name = virDomainGetName(domains[i]);
-        virDomainInfo info;
-        virDomainGetInfo(domains[i], &info);
-        
-        int id = virDomainGetID(domains[i]);
-        std::string state = getStateString(info.state);
-        bool isRunning = (info.state == VIR_DOMAIN_RUNNING);
-        
-        // Parse name to extract owner and display name
-        auto nameInfo = nameManager.parseVMName(name);
-        std::string displayName = nameInfo.valid ? nameInfo.vmName : name;
-        std::string owner = nameInfo.valid ? nameInfo.username : "unknown";
+    for (const auto& entry : entries) {
+        json vm = vmToJson(entry, getStateString(entry.state));
         
-        json vm = {
-            {"id", id},
-            {"name", name},  // Internal name
-            {"displayName", displayName},  // User-friendly name
-            {"owner", owner},
-            {"state", state},
-            {"running", isRunning},
-            {"stats", nullptr}
-        };
-        
-        if (isRunning) {
-            vm["stats"] = getVMStatsInternal(domains[i], name);
+        if (entry.isRunning()) {
+            vm["stats"] = latestStats(entry.name);
         }
         
         vms.push_back(vm);
-        virDomainFree(domains[i]);
     }
     
-    free(domains);
-    
     result["success"] = true;
     result["vms"] = vms;
     result["totalCount"] = vms.size();
@@ -150,70 +198,6 @@ json VMOperations::listAllVMs() {
     return result;
 }
 
-json VMOperations::getVMStatsInternal(virDomainPtr domain, const std::string& vmName) {
-    json stats;
-    
-    virDomainInfo info;
-    if (virDomainGetInfo(domain, &info) < 0) {
-        return stats;
-    }
-    
-    // CPU usage
-    double cpuUsage = 0.0;
-    unsigned long long cpuTime = info.cpuTime;
-    
-    if (statsCache.find(vmName) != statsCache.end()) {
-        CPUCache cached = statsCache[vmName];
-        long long timeDiff = getCurrentTimeMs() - cached.timestamp;
-        unsigned long long cpuDiff = cpuTime - cached.cpuTime;
-        if (timeDiff > 0) {
-            cpuUsage = ((double)cpuDiff / (timeDiff * 1000000.0)) * 100.0;
-        }
-    }
-    statsCache[vmName] = {cpuTime, getCurrentTimeMs()};
-    
-    stats["cpu"] = cpuUsage;
-    
-    // Memory
-    stats["memory"] = {
-        {"used", info.memory},
-        {"max", info.maxMem},
-        {"percent", info.maxMem > 0 ? (info.memory * 100.0 / info.maxMem) : 0}
-    };
-    
-    // Disk stats
-    virDomainBlockStatsStruct blockStats;
-    long long diskRead = 0, diskWrite = 0;
-    if (virDomainBlockStats(domain, "vda", &blockStats, sizeof(blockStats)) == 0) {
-        diskRead = blockStats.rd_bytes;
-        diskWrite = blockStats.wr_bytes;
-    }
-    
-    stats["disk"] = {
-        {"read", diskRead},
-        {"write", diskWrite},
-        {"readMB", diskRead / 1024.0 / 1024.0},
-        {"writeMB", diskWrite / 1024.0 / 1024.0}
-    };
-    
-    // Network stats
-    virDomainInterfaceStatsStruct netStats;
-    long long netRx = 0, netTx = 0;
-    if (virDomainInterfaceStats(domain, "vnet0", &netStats, sizeof(netStats)) == 0) {
-        netRx = netStats.rx_bytes;
-        netTx = netStats.tx_bytes;
-    }
-    
-    stats["network"] = {
-        {"rx", netRx},
-        {"tx", netTx},
-        {"rxMB", netRx / 1024.0 / 1024.0},
-        {"txMB", netTx / 1024.0 / 1024.0}
-    };
-    
-    return stats;
-}
-
 json VMOperations::getVMInfo(const std::string& name) {
     json result;
     result["success"] = false;
@@ -223,7 +207,8 @@ json VMOperations::getVMInfo(const std::string& name) {
         return result;
     }
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) {
         result["error"] = "VM not found";
         return result;
@@ -232,7 +217,8 @@ json VMOperations::getVMInfo(const std::string& name) {
     virDomainInfo info;
     virDomainGetInfo(domain, &info);
     
-    char* xmlDesc = virDomainGetXMLDesc(domain, 0);
+    char* xmlDesc = timeLibvirt(LibvirtCall::DomainGetXMLDesc,
+                                [&] { return virDomainGetXMLDesc(domain, 0); });
     
     json parsed = {
         {"Max memory", std::to_string(info.maxMem) + " KB"},
@@ -269,17 +255,30 @@ json VMOperations::getVMStats(const std::string& name) {
         return result;
     }
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
-    if (!domain) {
-        result["error"] = "VM not found";
-        return result;
-    }
+    // Existence and state from memory when the inventory is live
+    auto& inventory = DomainInventory::instance();
+    bool running = true;
     
-    json stats = getVMStatsInternal(domain, name);
-    virDomainFree(domain);
+    if (inventory.isReady()) {
+        DomainEntry entry;
+        if (!inventory.get(name, entry)) {
+            result["error"] = "VM not found";
+            return result;
+        }
+        running = entry.isRunning();
+    } else {
+        virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                          [&] { return virDomainLookupByName(conn, name.c_str()); });
+        if (!domain) {
+            result["error"] = "VM not found";
+            return result;
+        }
+        virDomainFree(domain);
+    }
     
+    // Stats come from the background sampler, never from libvirt directly
     result["success"] = true;
-    result["stats"] = stats;
+    result["stats"] = running ? latestStats(name) : json(nullptr);
     return result;
 }
 
@@ -292,7 +291,17 @@ json VMOperations::getVMStatus(const std::string& name) {
         return result;
     }
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    // Answer from memory when the inventory is live
+    DomainEntry entry;
+    if (DomainInventory::instance().isReady() && DomainInventory::instance().get(name, entry)) {
+        result["success"] = true;
+        result["state"] = getStateString(entry.state);
+        result["running"] = entry.isRunning();
+        return result;
+    }
+    
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) {
         result["error"] = "VM not found";
         return result;
@@ -315,10 +324,11 @@ json VMOperations::getVMStatus(const std::string& name) {
 bool VMOperations::startVM(const std::string& name) {
     if (!conn) return false;
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) return false;
     
-    int result = virDomainCreate(domain);
+    int result = timeLibvirt(LibvirtCall::DomainCreate, [&] { return virDomainCreate(domain); });
     virDomainFree(domain);
     
     return result >= 0;
@@ -327,10 +337,12 @@ bool VMOperations::startVM(const std::string& name) {
 bool VMOperations::shutdownVM(const std::string& name) {
     if (!conn) return false;
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) return false;
     
-    int result = virDomainShutdown(domain);
+    int result = timeLibvirt(LibvirtCall::DomainShutdown,
+                             [&] { return virDomainShutdown(domain); });
     virDomainFree(domain);
     
     return result >= 0;
@@ -347,6 +359,7 @@ bool VMOperations::deployVM(const json& vmParams) {
     // ==========================================
     // STEP 1: VALIDATE CONNECTION
     // ==========================================
+    JobManager::beginStep("validate");
     auto connResult = Validation::SystemValidator::checkLibvirtConnection(conn);
     if (!connResult.valid) {
         fprintf(stderr, "❌ %s\n", connResult.error.c_str());
@@ -382,11 +395,29 @@ bool VMOperations::deployVM(const json& vmParams) {
     std::string username = vmParams.value("username", "ubuntu");
     std::string authMethod = vmParams.value("authMethod", "password");
     std::string password = vmParams.value("password", "");
+    std::string passwordHash = vmParams.value("passwordHash", "");
     std::string sshKey = vmParams.value("sshKey", "");
+    // "overlay": qcow2 backed by the shared base image, "copy": full private copy
+    std::string provisioning = vmParams.value("provisioning", "overlay");
+    // What cloud-init does once first boot is done; the warm pool uses "poweroff"
+    std::string powerState = vmParams.value("powerState", "reboot");
+    
+    if (provisioning != "overlay" && provisioning != "copy") {
+        fprintf(stderr, "❌ Invalid provisioning mode '%s' (expected 'overlay' or 'copy')\n",
+                provisioning.c_str());
+        return false;
+    }
+    
+    if (powerState != "reboot" && powerState != "poweroff") {
+        fprintf(stderr, "❌ Invalid power state '%s' (expected 'reboot' or 'poweroff')\n",
+                powerState.c_str());
+        return false;
+    }
     
     // ==========================================
     // STEP 3: CHECK VM NAME AVAILABILITY
     // ==========================================
+    JobManager::beginStep("check-name");
     fprintf(stdout, "\n🔍 Checking VM name availability...\n");
     
     auto nameResult = Validation::SystemValidator::checkVMNameAvailable(conn, hostname);
@@ -398,115 +429,22 @@ bool VMOperations::deployVM(const json& vmParams) {
     fprintf(stdout, "✅ VM name '%s' is available\n", hostname.c_str());
     
     // ==========================================
-    // STEP 4: CHECK REQUIRED DIRECTORIES (REMOTE)
+    // STEPS 4-7: PREFLIGHT CHECKS (REMOTE, ONE ROUND TRIP)
     // ==========================================
-    fprintf(stdout, "\n🔍 Checking required directories on target host...\n");
+    JobManager::beginStep("preflight");
     
-    std::vector<std::string> requiredDirs = {
-        "/var/lib/libvirt/images",
-        "/var/lib/libvirt/images/baseimg",
-        "/var/lib/libvirt/images/cloud-init-iso"
-    };
-    
-    std::vector<std::string> missingDirs;
-    for (const auto& dir : requiredDirs) {
-        if (!remoteExec.directoryExists(dir)) {
-            missingDirs.push_back(dir);
-        }
-    }
+    std::string baseImagePath = RemoteExec::DEPLOY_BASE_IMAGE;
+    StorageBackend storage(conn);
     
-    if (!missingDirs.empty()) {
-        fprintf(stderr, "❌ Required directories missing on target host:\n");
-        for (const auto& dir : missingDirs) {
-            fprintf(stderr, "   - %s\n", dir.c_str());
-        }
-        fprintf(stderr, "\n💡 On the target host, run:\n");
-        fprintf(stderr, "   sudo mkdir -p /var/lib/libvirt/images/baseimg /var/lib/libvirt/images/cloud-init-iso\n");
-        fprintf(stderr, "   sudo chown -R libvirt-qemu:kvm /var/lib/libvirt/images\n");
-        return false;
-    }
-    fprintf(stdout, "✅ All required directories exist on target host\n");
-    
-    // ==========================================
-    // STEP 5: CHECK REQUIRED TOOLS (REMOTE)
-    // ==========================================
-    fprintf(stdout, "\n🔍 Checking required tools on target host...\n");
-    
-    std::vector<std::string> requiredTools = {
-        "qemu-img",
-        "genisoimage",
-        "mkpasswd"
-    };
-    
-    std::vector<std::string> missingTools;
-    for (const auto& tool : requiredTools) {
-        if (!remoteExec.commandExists(tool)) {
-            missingTools.push_back(tool);
-        }
-    }
-    
-    if (!missingTools.empty()) {
-        fprintf(stderr, "❌ Required tools missing on target host:\n");
-        for (const auto& tool : missingTools) {
-            fprintf(stderr, "   - %s\n", tool.c_str());
-        }
-        fprintf(stderr, "\n💡 On the target host, install them:\n");
-        fprintf(stderr, "   sudo apt-get install -y qemu-utils genisoimage whois\n");
-        return false;
-    }
-    fprintf(stdout, "✅ All required tools are installed on target host\n");
-    
-    // ==========================================
-    // STEP 6: VALIDATE BASE IMAGE (REMOTE)
-    // ==========================================
-    fprintf(stdout, "\n🔍 Validating base image on target host...\n");
-    
-    std::string baseImagePath = "/var/lib/libvirt/images/baseimg/ubuntu-22.04-server-cloudimg-amd64.img";
-    
-    if (!remoteExec.fileExists(baseImagePath)) {
-        fprintf(stderr, "❌ Base image not found on target host: %s\n", baseImagePath.c_str());
-        fprintf(stderr, "\n📥 On the target host, download the base image:\n");
-        fprintf(stderr, "   cd /var/lib/libvirt/images/baseimg\n");
-        fprintf(stderr, "   sudo wget https://cloud-images.ubuntu.com/jammy/current/jammy-server-cloudimg-amd64.img \\\n");
-        fprintf(stderr, "        -O ubuntu-22.04-server-cloudimg-amd64.img\n");
-        fprintf(stderr, "\nOr run the setup script on the target host:\n");
-        fprintf(stderr, "   sudo bash setup-base-images.sh\n");
-        return false;
-    }
-    
-    if (!remoteExec.isValidDiskImage(baseImagePath)) {
-        fprintf(stderr, "❌ Base image is corrupted or invalid: %s\n", baseImagePath.c_str());
-        fprintf(stderr, "   Re-download the image on the target host\n");
-        return false;
-    }
-    
-    fprintf(stdout, "✅ Base image is valid: %s\n", baseImagePath.c_str());
-    
-    // ==========================================
-    // STEP 7: CHECK DISK SPACE (REMOTE)
-    // ==========================================
-    fprintf(stdout, "\n🔍 Checking available disk space on target host...\n");
-    
-    long long requiredBytes = (long long)disk * 1024 * 1024 * 1024;  // Convert GB to bytes
-    requiredBytes += 1024 * 1024 * 1024;  // Add 1GB buffer for cloud-init ISO, etc.
-    
-    long long availableBytes = remoteExec.getAvailableDiskSpace("/var/lib/libvirt/images");
-    
-    if (availableBytes < 0) {
-        fprintf(stdout, "⚠️  Could not verify disk space. Proceeding with deployment...\n");
-    } else if (availableBytes < requiredBytes) {
-        fprintf(stderr, "❌ Insufficient disk space on target host.\n");
-        fprintf(stderr, "   Required: %.2f GB\n", requiredBytes / (1024.0*1024.0*1024.0));
-        fprintf(stderr, "   Available: %.2f GB\n", availableBytes / (1024.0*1024.0*1024.0));
-        return false;
+    if (vmParams.value("preflightChecked", false)) {
+        // Batch deployments check the target host once for all their VMs
+        fprintf(stdout, "\n🔍 Target host already checked for this batch\n");
     } else {
-        fprintf(stdout, "✅ Sufficient disk space available on target host\n");
-        fprintf(stdout, "   Available: %.2f GB\n", availableBytes / (1024.0*1024.0*1024.0));
+        long long requiredBytes = (long long)disk * 1024 * 1024 * 1024;  // Convert GB to bytes
+        requiredBytes += 1024 * 1024 * 1024;  // Add 1GB buffer for cloud-init ISO, etc.
         
-        // Warn if less than 10GB free after allocation
-        long long remainingBytes = availableBytes - requiredBytes;
-        if (remainingBytes < 10LL * 1024 * 1024 * 1024) {
-            fprintf(stdout, "⚠️  Warning: Less than 10GB will remain after allocation\n");
+        if (!RemoteExec::checkDeployTarget(conn, remoteExec, requiredBytes)) {
+            return false;
         }
     }
     
@@ -532,155 +470,120 @@ bool VMOperations::deployVM(const json& vmParams) {
     fprintf(stdout, "   Disk: %d GB\n", disk);
     fprintf(stdout, "   Username: %s\n", username.c_str());
     fprintf(stdout, "   Auth: %s\n", authMethod.c_str());
+    fprintf(stdout, "   Provisioning: %s\n", provisioning.c_str());
     fprintf(stdout, "\n");
     
     try {
         // Paths on the target host
-        std::string diskPath = "/var/lib/libvirt/images/" + hostname + ".qcow2";
+        std::string diskName = hostname + ".qcow2";
+        std::string diskPath = IMAGES_DIR + "/" + diskName;
         std::string cloudInitPath = "/var/lib/libvirt/images/cloud-init-iso/" + hostname + "-cloudinit.iso";
         
         // Step 1: Create cloud-init configuration
+        JobManager::beginStep("cloud-init");
         fprintf(stdout, "📝 Step 1/7: Creating cloud-init configuration...\n");
         
-        std::string cloudInitDir = "/tmp/cloudinit-" + hostname;
-        
-        // Create directory on target host
-        auto mkdirResult = remoteExec.execute("mkdir -p " + cloudInitDir);
-        if (!mkdirResult.success()) {
-            fprintf(stderr, "   ❌ Failed to create temp directory on target host\n");
-            return false;
-        }
-        
-        // Create meta-data file
-        std::stringstream metaData;
-        metaData << "instance-id: " << hostname << "\n"
-                 << "local-hostname: " << hostname << "\n";
-        
-        // Create user-data file
-        std::stringstream userData;
-        userData << "#cloud-config\n"
-                 << "hostname: " << actualHostname << "\n"
-                 << "fqdn: " << hostname << ".local\n"
-                 << "manage_etc_hosts: true\n\n"
-                 << "users:\n"
-                 << "  - name: " << username << "\n"
-                 << "    sudo: ALL=(ALL) NOPASSWD:ALL\n"
-                 << "    groups: users, admin\n"
-                 << "    shell: /bin/bash\n";
+        CloudInit::UserDataOptions userOptions;
+        userOptions.hostname = actualHostname;
+        userOptions.fqdn = hostname + ".local";
+        userOptions.username = username;
+        userOptions.authMethod = authMethod;
+        userOptions.sshKey = sshKey;
+        userOptions.powerState = powerState;
         
         if (authMethod == "password" && !password.empty()) {
-            // Generate password hash on target host
-            std::string hashCmd = "mkpasswd --method=SHA-512 --rounds=4096 '" + password + "'";
-            auto hashResult = remoteExec.execute(hashCmd);
+            // Hash locally: the plaintext never leaves this process.
+            // Batch deploys hash every VM's password up front.
+            userOptions.passwordHash = passwordHash.empty() ? PasswordHash::sha512Crypt(password)
+                                                            : passwordHash;
             
-            if (!hashResult.success()) {
-                fprintf(stderr, "   ❌ Failed to generate password hash on target host\n");
+            if (userOptions.passwordHash.empty()) {
+                fprintf(stderr, "   ❌ Failed to generate password hash\n");
                 return false;
             }
-            
-            std::string hashedPassword = hashResult.output;
-            hashedPassword.erase(hashedPassword.find_last_not_of("\n\r") + 1);
-            
-            userData << "    passwd: " << hashedPassword << "\n"
-                     << "    lock_passwd: false\n";
-        } else if (authMethod == "ssh-key" && !sshKey.empty()) {
-            userData << "    ssh_authorized_keys:\n"
-                     << "      - " << sshKey << "\n";
         }
         
-        userData << "\n"
-                 << "ssh_pwauth: " << (authMethod == "password" ? "true" : "false") << "\n"
-                 << "disable_root: false\n"
-                 << "chpasswd:\n"
-                 << "  expire: false\n\n"
-                 << "package_update: true\n"
-                 << "package_upgrade: false\n\n"
-                 << "packages:\n"
-                 << "  - qemu-guest-agent\n"
-                 << "  - cloud-init\n\n"
-                 << "runcmd:\n"
-                 << "  - systemctl enable qemu-guest-agent\n"
-                 << "  - systemctl start qemu-guest-agent\n"
-                 << "  - echo 'Cloud-init setup complete' > /var/log/cloudinit-done\n\n"
-                 << "power_state:\n"
-                 << "  mode: reboot\n"
-                 << "  timeout: 30\n"
-                 << "  condition: true\n";
-        
-        // Write files to target host using echo and cat
-        std::string metaDataContent = metaData.str();
-        std::string userDataContent = userData.str();
-        
-        // Escape single quotes in content
-        auto escapeSingleQuotes = [](const std::string& str) {
-            std::string escaped = str;
-            size_t pos = 0;
-            while ((pos = escaped.find("'", pos)) != std::string::npos) {
-                escaped.replace(pos, 1, "'\\''");
-                pos += 4;
-            }
-            return escaped;
-        };
-        
-        std::string writeMetaCmd = "cat > " + cloudInitDir + "/meta-data << 'EOF'\n" + metaDataContent + "\nEOF";
-        std::string writeUserCmd = "cat > " + cloudInitDir + "/user-data << 'EOF'\n" + userDataContent + "\nEOF";
-        
-        auto writeMetaResult = remoteExec.execute(writeMetaCmd);
-        auto writeUserResult = remoteExec.execute(writeUserCmd);
-        
-        if (!writeMetaResult.success() || !writeUserResult.success()) {
-            fprintf(stderr, "   ❌ Failed to write cloud-init files on target host\n");
-            return false;
-        }
+        std::string metaData = CloudInit::buildMetaData(hostname, hostname);
+        std::string userData = CloudInit::buildUserData(userOptions);
         
         fprintf(stdout, "   ✅ Cloud-init configuration created\n");
         
-        // Step 2: Create cloud-init ISO
+        // Step 2: Build the NoCloud seed in memory and upload it in one transfer
         fprintf(stdout, "📝 Step 2/7: Creating cloud-init ISO...\n");
         
-        std::string createIsoCmd = "genisoimage -output " + cloudInitPath + 
-                                   " -volid cidata -joliet -rock " + 
-                                   cloudInitDir + "/user-data " + 
-                                   cloudInitDir + "/meta-data 2>&1";
-        auto isoResult = remoteExec.execute(createIsoCmd);
+        std::string seedIso = CloudInit::buildNoCloudSeed(metaData, userData);
         
-        if (!isoResult.success()) {
-            fprintf(stderr, "   ❌ Failed to create cloud-init ISO: %s\n", isoResult.output.c_str());
+        std::string uploadError;
+        if (!RemoteExec::uploadFile(conn, cloudInitPath, seedIso, uploadError)) {
+            fprintf(stderr, "   ❌ Failed to upload cloud-init ISO: %s\n", uploadError.c_str());
             return false;
         }
         
-        fprintf(stdout, "   ✅ Cloud-init ISO created\n");
+        fprintf(stdout, "   ✅ Cloud-init ISO created (%zu KB)\n", seedIso.size() / 1024);
         
-        // Clean up temp directory
-        remoteExec.execute("rm -rf " + cloudInitDir);
+        // Steps 3-4: Create the VM disk
+        JobManager::beginStep("disk");
         
-        // Step 3: Copy base image
-        fprintf(stdout, "📝 Step 3/7: Copying base cloud image...\n");
+        unsigned long long capacityBytes = (unsigned long long)disk * 1024 * 1024 * 1024;
+        std::string storageError;
         
-        std::string copyCmd = "cp " + baseImagePath + " " + diskPath;
-        auto copyResult = remoteExec.execute(copyCmd);
+        // Preferred path: the libvirt storage pool API, over the existing connection
+        bool diskCreated = provisioning == "overlay"
+            ? storage.createOverlay(IMAGES_DIR, diskName, capacityBytes, baseImagePath, storageError)
+            : storage.cloneImage(IMAGES_DIR, diskName, baseImagePath, capacityBytes, storageError);
         
-        if (!copyResult.success()) {
-            fprintf(stderr, "   ❌ Failed to copy base image: %s\n", copyResult.output.c_str());
-            return false;
-        }
-        
-        fprintf(stdout, "   ✅ Base image copied\n");
-        
-        // Step 4: Resize disk
-        fprintf(stdout, "📝 Step 4/7: Resizing disk to %dGB...\n", disk);
-        
-        std::string resizeCmd = "qemu-img resize " + diskPath + " " + std::to_string(disk) + "G";
-        auto resizeResult = remoteExec.execute(resizeCmd);
-        
-        if (!resizeResult.success()) {
-            fprintf(stderr, "   ❌ Failed to resize disk: %s\n", resizeResult.output.c_str());
-            return false;
+        if (diskCreated) {
+            fprintf(stdout, "📝 Steps 3-4/7: %dGB %s disk created through storage pool\n",
+                    disk, provisioning.c_str());
+        } else {
+            fprintf(stdout, "⚠️  Storage pool provisioning failed (%s), using qemu-img\n",
+                    storageError.c_str());
+            
+            if (provisioning == "overlay") {
+                // Copy-on-write overlay, created at its final size in one step
+                fprintf(stdout, "📝 Step 3/7: Creating %dGB overlay on base cloud image...\n", disk);
+            
+                std::string overlayCmd = "qemu-img create -f qcow2 -F qcow2 -b " + baseImagePath + " " +
+                                         diskPath + " " + std::to_string(disk) + "G 2>&1";
+                auto overlayResult = remoteExec.execute(overlayCmd);
+            
+                if (!overlayResult.success()) {
+                    fprintf(stderr, "   ❌ Failed to create overlay: %s\n", overlayResult.output.c_str());
+                    return false;
+                }
+            
+                fprintf(stdout, "   ✅ Overlay created\n");
+                fprintf(stdout, "📝 Step 4/7: Disk already sized, skipping resize\n");
+            } else {
+                fprintf(stdout, "📝 Step 3/7: Copying base cloud image...\n");
+            
+                std::string copyCmd = "cp " + baseImagePath + " " + diskPath;
+                auto copyResult = remoteExec.execute(copyCmd);
+            
+                if (!copyResult.success()) {
+                    fprintf(stderr, "   ❌ Failed to copy base image: %s\n", copyResult.output.c_str());
+                    return false;
+                }
+            
+                fprintf(stdout, "   ✅ Base image copied\n");
+            
+                // Step 4: Resize disk
+                fprintf(stdout, "📝 Step 4/7: Resizing disk to %dGB...\n", disk);
+            
+                std::string resizeCmd = "qemu-img resize " + diskPath + " " + std::to_string(disk) + "G";
+                auto resizeResult = remoteExec.execute(resizeCmd);
+            
+                if (!resizeResult.success()) {
+                    fprintf(stderr, "   ❌ Failed to resize disk: %s\n", resizeResult.output.c_str());
+                    return false;
+                }
+            
+                fprintf(stdout, "   ✅ Disk resized\n");
+            }
         }
-        
-        fprintf(stdout, "   ✅ Disk resized\n");
-        
+
         // Step 5: Create domain XML
+        JobManager::beginStep("define");
         fprintf(stdout, "📝 Step 5/7: Creating VM definition...\n");
         
         std::stringstream xmlConfig;
@@ -741,7 +644,8 @@ bool VMOperations::deployVM(const json& vmParams) {
         // Step 6: Define the domain
         fprintf(stdout, "📝 Step 6/7: Defining VM in libvirt...\n");
         
-        virDomainPtr domain = virDomainDefineXML(conn, xml.c_str());
+        virDomainPtr domain = timeLibvirt(LibvirtCall::DomainDefineXML,
+                                          [&] { return virDomainDefineXML(conn, xml.c_str()); });
         if (!domain) {
             virErrorPtr err = virGetLastError();
             if (err) {
@@ -753,9 +657,10 @@ bool VMOperations::deployVM(const json& vmParams) {
         fprintf(stdout, "   ✅ VM defined in libvirt\n");
         
         // Step 7: Start the VM
+        JobManager::beginStep("start");
         fprintf(stdout, "📝 Step 7/7: Starting VM...\n");
         
-        if (virDomainCreate(domain) < 0) {
+        if (timeLibvirt(LibvirtCall::DomainCreate, [&] { return virDomainCreate(domain); }) < 0) {
             virErrorPtr err = virGetLastError();
             if (err) {
                 fprintf(stderr, "   ❌ Failed to start domain: %s\n", err->message);
@@ -781,10 +686,11 @@ bool VMOperations::deployVM(const json& vmParams) {
 bool VMOperations::destroyVM(const std::string& name) {
     if (!conn) return false;
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) return false;
     
-    int result = virDomainDestroy(domain);
+    int result = timeLibvirt(LibvirtCall::DomainDestroy, [&] { return virDomainDestroy(domain); });
     virDomainFree(domain);
     
     return result >= 0;
@@ -793,7 +699,8 @@ bool VMOperations::destroyVM(const std::string& name) {
 bool VMOperations::rebootVM(const std::string& name) {
     if (!conn) return false;
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) return false;
     
     int result = virDomainReboot(domain, 0);
@@ -805,7 +712,8 @@ bool VMOperations::rebootVM(const std::string& name) {
 bool VMOperations::pauseVM(const std::string& name) {
     if (!conn) return false;
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) return false;
     
     int result = virDomainSuspend(domain);
@@ -817,7 +725,8 @@ bool VMOperations::pauseVM(const std::string& name) {
 bool VMOperations::resumeVM(const std::string& name) {
     if (!conn) return false;
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) return false;
     
     int result = virDomainResume(domain);
@@ -835,22 +744,20 @@ json VMOperations::getVNCInfo(const std::string& name) {
         return result;
     }
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) {
         result["error"] = "VM not found";
         return result;
     }
     
-    char* xmlDesc = virDomainGetXMLDesc(domain, 0);
-    std::string xml(xmlDesc);
-    free(xmlDesc);
+    auto model = DomainModelCache::instance().get(domain);
     virDomainFree(domain);
     
-    std::regex portRegex("<graphics type='vnc' port='(\\d+)'");
-    std::smatch match;
+    const GraphicsModel* vnc = model ? model->findGraphics("vnc") : nullptr;
     
-    if (std::regex_search(xml, match, portRegex) && match[1].str() != "-1") {
-        int port = std::stoi(match[1].str());
+    if (vnc && vnc->port > 0) {
+        int port = vnc->port;
         std::string display = ":" + std::to_string(port - 5900);
         
         result["success"] = true;
@@ -873,7 +780,8 @@ json VMOperations::getIP(const std::string& name) {
         return result;
     }
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) {
         result["error"] = "VM not found";
         return result;
@@ -978,14 +886,16 @@ json VMOperations::listSnapshots(const std::string& name) {
         return result;
     }
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) {
         result["error"] = "VM not found";
         return result;
     }
     
     virDomainSnapshotPtr* snapshots;
-    int numSnapshots = virDomainListAllSnapshots(domain, &snapshots, 0);
+    int numSnapshots = timeLibvirt(LibvirtCall::DomainListAllSnapshots,
+                                   [&] { return virDomainListAllSnapshots(domain, &snapshots, 0); });
     
     json snapshotList = json::array();
     
@@ -994,23 +904,18 @@ json VMOperations::listSnapshots(const std::string& name) {
             const char* snapName = virDomainSnapshotGetName(snapshots[i]);
             char* xmlDesc = virDomainSnapshotGetXMLDesc(snapshots[i], 0);
             
-            std::string xml(xmlDesc);
-            std::regex timeRegex("<creationTime>(\\d+)</creationTime>");
-            std::regex stateRegex("<state>(\\w+)</state>");
-            std::smatch match;
+            SnapshotModel snapshot;
+            bool parsed = xmlDesc && parseSnapshotXML(xmlDesc, snapshot);
             
             std::string timeStr = "Unknown";
-            if (std::regex_search(xml, match, timeRegex)) {
-                time_t timestamp = std::stoll(match[1].str());
+            if (parsed && snapshot.creationTime >= 0) {
+                time_t timestamp = snapshot.creationTime;
                 char buffer[100];
                 strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", localtime(&timestamp));
                 timeStr = buffer;
             }
             
-            std::string state = "unknown";
-            if (std::regex_search(xml, match, stateRegex)) {
-                state = match[1].str();
-            }
+            std::string state = parsed && !snapshot.state.empty() ? snapshot.state : "unknown";
             
             snapshotList.push_back({
                 {"name", snapName},
@@ -1034,7 +939,8 @@ json VMOperations::listSnapshots(const std::string& name) {
 bool VMOperations::createSnapshot(const std::string& name, const std::string& snapName, const std::string& desc) {
     if (!conn) return false;
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) return false;
     
     std::string snapshotXML = 
@@ -1043,7 +949,9 @@ bool VMOperations::createSnapshot(const std::string& name, const std::string& sn
         "<description>" + desc + "</description>"
         "</domainsnapshot>";
     
-    virDomainSnapshotPtr snapshot = virDomainSnapshotCreateXML(domain, snapshotXML.c_str(), 0);
+    virDomainSnapshotPtr snapshot = timeLibvirt(LibvirtCall::DomainSnapshotCreateXML, [&] {
+        return virDomainSnapshotCreateXML(domain, snapshotXML.c_str(), 0);
+    });
     virDomainFree(domain);
     
     if (snapshot) {
@@ -1056,16 +964,20 @@ bool VMOperations::createSnapshot(const std::string& name, const std::string& sn
 bool VMOperations::revertSnapshot(const std::string& name, const std::string& snapName) {
     if (!conn) return false;
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) return false;
     
-    virDomainSnapshotPtr snapshot = virDomainSnapshotLookupByName(domain, snapName.c_str(), 0);
+    virDomainSnapshotPtr snapshot = timeLibvirt(LibvirtCall::DomainSnapshotLookupByName, [&] {
+        return virDomainSnapshotLookupByName(domain, snapName.c_str(), 0);
+    });
     if (!snapshot) {
         virDomainFree(domain);
         return false;
     }
     
-    int result = virDomainRevertToSnapshot(snapshot, 0);
+    int result = timeLibvirt(LibvirtCall::DomainRevertToSnapshot,
+                             [&] { return virDomainRevertToSnapshot(snapshot, 0); });
     
     virDomainSnapshotFree(snapshot);
     virDomainFree(domain);
@@ -1076,16 +988,20 @@ bool VMOperations::revertSnapshot(const std::string& name, const std::string& sn
 bool VMOperations::deleteSnapshot(const std::string& name, const std::string& snapName) {
     if (!conn) return false;
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) return false;
     
-    virDomainSnapshotPtr snapshot = virDomainSnapshotLookupByName(domain, snapName.c_str(), 0);
+    virDomainSnapshotPtr snapshot = timeLibvirt(LibvirtCall::DomainSnapshotLookupByName, [&] {
+        return virDomainSnapshotLookupByName(domain, snapName.c_str(), 0);
+    });
     if (!snapshot) {
         virDomainFree(domain);
         return false;
     }
     
-    int result = virDomainSnapshotDelete(snapshot, 0);
+    int result = timeLibvirt(LibvirtCall::DomainSnapshotDelete,
+                             [&] { return virDomainSnapshotDelete(snapshot, 0); });
     
     virDomainSnapshotFree(snapshot);
     virDomainFree(domain);
@@ -1094,48 +1010,12 @@ bool VMOperations::deleteSnapshot(const std::string& name, const std::string& sn
 }
 
 bool VMOperations::cloneVM(const std::string& name, const std::string& cloneName) {
-    if (!conn) return false;
-    
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
-    if (!domain) return false;
-    
-    char* xmlDesc = virDomainGetXMLDesc(domain, 0);
-    std::string xml(xmlDesc);
-    free(xmlDesc);
-    virDomainFree(domain);
-    
-    // Modify XML for clone
-    xml = std::regex_replace(xml, std::regex("<name>" + name + "</name>"), "<name>" + cloneName + "</name>");
-    xml = std::regex_replace(xml, std::regex("<uuid>.*?</uuid>"), "");
-    
-    // Copy disks
-    std::regex diskRegex("<source file='([^']+)'");
-    std::smatch match;
-    std::string::const_iterator searchStart(xml.cbegin());
-    
-    while (std::regex_search(searchStart, xml.cend(), match, diskRegex)) {
-        std::string oldPath = match[1].str();
-        std::string newPath = std::regex_replace(oldPath, std::regex(name), cloneName);
-        
-        try {
-            std::string cpCmd = "cp " + oldPath + " " + newPath;
-            execCommand(cpCmd);
-            
-            xml = std::regex_replace(xml, std::regex(oldPath), newPath);
-        } catch (...) {
-            return false;
-        }
-        
-        searchStart = match.suffix().first;
-    }
-    
-    // Define new domain
-    virDomainPtr newDomain = virDomainDefineXML(conn, xml.c_str());
-    if (!newDomain) {
+    CloneOperations cloner(conn);
+    std::string error;
+    if (!cloner.clone(name, cloneName, CloneMode::Full, error)) {
+        fprintf(stderr, "Failed to clone %s: %s\n", name.c_str(), error.c_str());
         return false;
     }
-    
-    virDomainFree(newDomain);
     return true;
 }
 
@@ -1158,28 +1038,43 @@ bool VMOperations::stopVMIfRunning(virDomainPtr domain) {
         fprintf(stdout, "VM is running, attempting graceful shutdown...\n");
         
         // Try graceful shutdown first
-        if (virDomainShutdown(domain) == 0) {
-            fprintf(stdout, "Shutdown signal sent, waiting up to 30 seconds...\n");
+        JobManager::beginStep("shutdown");
+        if (timeLibvirt(LibvirtCall::DomainShutdown,
+                        [&] { return virDomainShutdown(domain); }) == 0) {
+            fprintf(stdout, "Shutdown signal sent, waiting up to %d seconds...\n", GRACEFULL_SHUTDOWN_TIME);
             
-            // Wait up to 30 seconds for graceful shutdown
-            for (int i = 0; i < GRACEFULL_SHUTDOWN_TIME; i++) {
-                sleep(1);
-                
-                if (virDomainGetInfo(domain, &info) < 0) {
-                    break;
-                }
-                
-                if (info.state == VIR_DOMAIN_SHUTOFF) {
+            auto& inventory = DomainInventory::instance();
+            const char* name = virDomainGetName(domain);
+            
+            if (inventory.isReady() && name) {
+                // Woken by the STOPPED lifecycle event, as soon as the guest powers off
+                if (inventory.waitForShutoff(name, GRACEFULL_SHUTDOWN_TIME * 1000LL)) {
                     fprintf(stdout, "VM shutdown gracefully\n");
                     return true;
                 }
+            } else {
+                // No events: poll once a second
+                for (int i = 0; i < GRACEFULL_SHUTDOWN_TIME; i++) {
+                    sleep(1);
+                    
+                    if (virDomainGetInfo(domain, &info) < 0) {
+                        break;
+                    }
+                    
+                    if (info.state == VIR_DOMAIN_SHUTOFF) {
+                        fprintf(stdout, "VM shutdown gracefully\n");
+                        return true;
+                    }
+                }
             }
             
             fprintf(stdout, "Graceful shutdown timeout, forcing shutdown...\n");
         }
         
+        JobManager::beginStep("destroy");
+        
         // If graceful shutdown failed or timed out, force destroy
-        if (virDomainDestroy(domain) < 0) {
+        if (timeLibvirt(LibvirtCall::DomainDestroy, [&] { return virDomainDestroy(domain); }) < 0) {
             virErrorPtr err = virGetLastError();
             if (err) {
                 fprintf(stderr, "Failed to destroy domain: %s\n", err->message);
@@ -1197,7 +1092,8 @@ bool VMOperations::deleteAllSnapshots(virDomainPtr domain) {
     if (!domain) return false;
     
     virDomainSnapshotPtr* snapshots = nullptr;
-    int numSnapshots = virDomainListAllSnapshots(domain, &snapshots, 0);
+    int numSnapshots = timeLibvirt(LibvirtCall::DomainListAllSnapshots,
+                                   [&] { return virDomainListAllSnapshots(domain, &snapshots, 0); });
     
     if (numSnapshots < 0) {
         virErrorPtr err = virGetLastError();
@@ -1219,7 +1115,10 @@ bool VMOperations::deleteAllSnapshots(virDomainPtr domain) {
         const char* snapName = virDomainSnapshotGetName(snapshots[i]);
         fprintf(stdout, "Deleting snapshot: %s\n", snapName);
         
-        if (virDomainSnapshotDelete(snapshots[i], VIR_DOMAIN_SNAPSHOT_DELETE_METADATA_ONLY) < 0) {
+        int deleted = timeLibvirt(LibvirtCall::DomainSnapshotDelete, [&] {
+            return virDomainSnapshotDelete(snapshots[i], VIR_DOMAIN_SNAPSHOT_DELETE_METADATA_ONLY);
+        });
+        if (deleted < 0) {
             virErrorPtr err = virGetLastError();
             if (err) {
                 fprintf(stderr, "Failed to delete snapshot %s: %s\n", snapName, err->message);
@@ -1244,33 +1143,27 @@ std::vector<std::string> VMOperations::getDiskPaths(virDomainPtr domain) {
     
     if (!domain) return diskPaths;
     
-    char* xmlDesc = virDomainGetXMLDesc(domain, 0);
-    if (!xmlDesc) {
+    // The model only holds the top image of each disk; backing images are shared
+    auto model = DomainModelCache::instance().get(domain);
+    if (!model) {
         fprintf(stderr, "Failed to get domain XML\n");
         return diskPaths;
     }
     
-    std::string xml(xmlDesc);
-    free(xmlDesc);
-    
-    // Extract all disk file paths from XML
-    // Look for: <source file='/path/to/disk.qcow2'/>
-    std::regex diskRegex("<source file='([^']+)'");
-    std::sregex_iterator iter(xml.begin(), xml.end(), diskRegex);
-    std::sregex_iterator end;
-    
-    while (iter != end) {
-        std::smatch match = *iter;
-        std::string diskPath = match[1].str();
+    // File and block-device disks; network and pool volumes have no path
+    for (const auto& disk : model->disks) {
+        if (!disk.hasPath() || disk.source.empty()) continue;
+        
+        const std::string& diskPath = disk.source;
         
         // Skip ISO files and cloud-init ISOs (they're typically temporary)
-        if (diskPath.find(".iso") == std::string::npos || 
+        if (isBaseImage(diskPath)) {
+            fprintf(stdout, "Skipping shared base image: %s\n", diskPath.c_str());
+        } else if (diskPath.find(".iso") == std::string::npos || 
             diskPath.find("cloud-init") != std::string::npos) {
             diskPaths.push_back(diskPath);
             fprintf(stdout, "Found disk: %s\n", diskPath.c_str());
         }
-        
-        ++iter;
     }
     
     return diskPaths;
@@ -1284,7 +1177,57 @@ bool VMOperations::deleteDiskFiles(const std::vector<std::string>& diskPaths) {
     
     bool allSuccess = true;
     
+    StorageBackend storage(conn);
+    RemoteExec::RemoteExecutor remoteExec(conn);
+    RemoteExec::SSHTarget target;
+    bool remote = RemoteExec::resolveTarget(conn, target);
+    
     for (const auto& diskPath : diskPaths) {
+        // Never remove an image other VMs may be layered on
+        if (isBaseImage(diskPath)) {
+            fprintf(stderr, "Refusing to delete shared base image: %s\n", diskPath.c_str());
+            continue;
+        }
+        
+        // Never unlink a device node: block devices only go through the
+        // pool that provides them
+        bool device = diskPath.compare(0, 5, "/dev/") == 0;
+        
+        // Through the storage pool first: works for local and remote hosts alike
+        bool managed = false;
+        std::string storageError;
+        bool deleted = device ? storage.deleteDeviceVolume(diskPath, managed, storageError)
+                              : storage.deleteVolume(diskPath, managed, storageError);
+        if (deleted) {
+            fprintf(stdout, "Successfully deleted: %s\n", diskPath.c_str());
+            continue;
+        }
+        if (managed) {
+            fprintf(stderr, "Failed to delete volume: %s (error: %s)\n",
+                    diskPath.c_str(), storageError.c_str());
+            allSuccess = false;
+            continue;
+        }
+        
+        if (device) {
+            fprintf(stdout, "Leaving block device in place (not in a storage pool): %s\n",
+                    diskPath.c_str());
+            continue;
+        }
+        
+        // Not reachable through any pool: remove the file directly on its host
+        if (remote) {
+            auto result = remoteExec.execute("rm -f " + RemoteExec::SSHSession::shellQuote(diskPath));
+            if (!result.success()) {
+                fprintf(stderr, "Failed to delete disk file on target host: %s (%s)\n",
+                        diskPath.c_str(), result.output.c_str());
+                allSuccess = false;
+            } else {
+                fprintf(stdout, "Successfully deleted: %s\n", diskPath.c_str());
+            }
+            continue;
+        }
+        
         // Check if file exists
         struct stat buffer;
         if (stat(diskPath.c_str(), &buffer) != 0) {
@@ -1326,7 +1269,8 @@ json VMOperations::deleteVM(const std::string& name, bool removeDisks) {
     fprintf(stdout, "========================================\n\n");
     
     // Step 1: Lookup domain
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) {
         virErrorPtr err = virGetLastError();
         std::string errorMsg = "VM not found";
@@ -1361,6 +1305,7 @@ json VMOperations::deleteVM(const std::string& name, bool removeDisks) {
     result["steps"].push_back("VM stopped successfully");
     
     // Step 4: Delete all snapshots
+    JobManager::beginStep("snapshots");
     result["steps"].push_back("Deleting snapshots...");
     if (!deleteAllSnapshots(domain)) {
         result["warning"] = "Some snapshots could not be deleted";
@@ -1371,6 +1316,7 @@ json VMOperations::deleteVM(const std::string& name, bool removeDisks) {
     }
     
     // Step 5: Undefine the domain
+    JobManager::beginStep("undefine");
     result["steps"].push_back("Undefining VM...");
     
     // Use VIR_DOMAIN_UNDEFINE_MANAGED_SAVE to remove saved state
@@ -1395,12 +1341,14 @@ json VMOperations::deleteVM(const std::string& name, bool removeDisks) {
     
     result["steps"].push_back("VM undefined successfully");
     fprintf(stdout, "VM '%s' undefined successfully\n", name.c_str());
+    StatsStore::instance().remove(name);
     
     // Free domain handle
     virDomainFree(domain);
     
     // Step 6: Delete disk files (if requested)
     if (removeDisks && !diskPaths.empty()) {
+        JobManager::beginStep("disks");
         result["steps"].push_back("Deleting disk files...");
         
         if (deleteDiskFiles(diskPaths)) {
@@ -1430,7 +1378,8 @@ json VMOperations::deleteVM(const std::string& name, bool removeDisks) {
 bool VMOperations::undefineVM(const std::string& name) {
     if (!conn) return false;
     
-    virDomainPtr domain = virDomainLookupByName(conn, name.c_str());
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
     if (!domain) return false;
     
     unsigned int undefineFlags = VIR_DOMAIN_UNDEFINE_MANAGED_SAVE | 
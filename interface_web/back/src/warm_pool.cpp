@@ -0,0 +1,518 @@
+#include "../include/warm_pool.hpp"
+#include "../include/vm_operations.hpp"
+#include "../include/validation.hpp"
+#include "../include/utils.hpp"
+#include "../include/cloud_init_config.hpp"
+#include "../include/nocloud_iso.hpp"
+#include "../include/password_hash.hpp"
+#include "../include/ssh_session.hpp"
+#include "../include/domain_inventory.hpp"
+#include "../include/job_manager.hpp"
+#include "../include/metrics.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <libvirt/virterror.h>
+
+namespace {
+
+// Must match where deployVM writes the seed, which warm VMs keep attached
+const std::string CLOUD_INIT_DIR = "/var/lib/libvirt/images/cloud-init-iso/";
+
+std::string lastLibvirtError() {
+    virErrorPtr err = virGetLastError();
+    return err && err->message ? err->message : "unknown error";
+}
+
+// Throwaway password for the placeholder user of warm VMs; nobody ever
+// learns it and the user is removed when the VM is claimed
+std::string randomPassword() {
+    static const char alphabet[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    constexpr size_t LENGTH = 24;
+
+    unsigned char bytes[LENGTH];
+    std::ifstream urandom("/dev/urandom", std::ios::binary);
+    if (!urandom.read(reinterpret_cast<char*>(bytes), LENGTH)) {
+        return "";
+    }
+
+    std::string password;
+    for (unsigned char b : bytes) {
+        password += alphabet[b % (sizeof(alphabet) - 1)];
+    }
+    // Mixed classes keep the validator from warning about weak passwords
+    return password + "-9aA";
+}
+
+} // namespace
+
+WarmPool& WarmPool::instance() {
+    static WarmPool pool;
+    return pool;
+}
+
+std::vector<WarmFlavor> WarmPool::flavorsFromEnvironment() {
+    // Same presets as the deploy form
+    std::vector<WarmFlavor> result = {
+        {"small", 2048, 1, 15, 0},
+        {"medium", 4096, 2, 20, 0},
+        {"large", 8192, 4, 40, 0}
+    };
+
+    const char* config = getenv("THOTH_WARM_POOL");
+    if (!config) return result;
+
+    std::stringstream entries(config);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        size_t eq = entry.find('=');
+        if (eq == std::string::npos) {
+            fprintf(stderr, "Warm pool: ignoring malformed entry '%s'\n", entry.c_str());
+            continue;
+        }
+
+        std::string name = entry.substr(0, eq);
+        long target = strtol(entry.c_str() + eq + 1, nullptr, 10);
+
+        bool found = false;
+        for (auto& flavor : result) {
+            if (flavor.name == name) {
+                flavor.target = target > 0 ? static_cast<size_t>(target) : 0;
+                found = true;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "Warm pool: unknown flavor '%s'\n", name.c_str());
+        }
+    }
+
+    return result;
+}
+
+void WarmPool::start(virConnectPtr connection, std::vector<WarmFlavor> configured) {
+    if (running) return;
+
+    conn = connection;
+    flavors = std::move(configured);
+
+    if (!isEnabled()) {
+        fprintf(stdout, "Warm pool disabled (set THOTH_WARM_POOL, e.g. small=2)\n");
+        return;
+    }
+
+    adoptExisting();
+
+    running = true;
+    worker = std::thread(&WarmPool::run, this);
+
+    for (const auto& flavor : flavors) {
+        if (flavor.target > 0) {
+            fprintf(stdout, "Warm pool: keeping %zu %s VM(s) ready\n", flavor.target, flavor.name.c_str());
+        }
+    }
+}
+
+void WarmPool::stop() {
+    if (!running) return;
+
+    running = false;
+    wake();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+bool WarmPool::isEnabled() const {
+    for (const auto& flavor : flavors) {
+        if (flavor.target > 0) return true;
+    }
+    return false;
+}
+
+bool WarmPool::claim(const json& vmParams) {
+    if (!running) return false;
+
+    // Warm VMs are overlays on the base image
+    if (vmParams.value("provisioning", "overlay") != "overlay") return false;
+
+    // Let deployVM report invalid requests with its own messages
+    if (!Validation::Validator::validateDeploymentParams(vmParams).valid) return false;
+
+    const WarmFlavor* flavor = findFlavor(vmParams["memory"], vmParams["vcpus"], vmParams["disk"]);
+    if (!flavor) return false;
+
+    std::string warmName;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        long long oldest = 0;
+        for (auto& [name, vm] : vms) {
+            if (vm.flavor == flavor->name && vm.state == WarmState::Ready &&
+                (warmName.empty() || vm.createdAt < oldest)) {
+                warmName = name;
+                oldest = vm.createdAt;
+            }
+        }
+
+        if (warmName.empty()) {
+            missed++;
+        } else {
+            vms[warmName].state = WarmState::Claimed;
+        }
+    }
+    wake();
+
+    if (warmName.empty()) {
+        fprintf(stdout, "Warm pool: no %s VM ready, deploying from scratch\n", flavor->name.c_str());
+        return false;
+    }
+
+    JobManager::beginStep("claim-warm");
+    fprintf(stdout, "Warm pool: handing %s over as %s\n", warmName.c_str(),
+            vmParams["hostname"].get<std::string>().c_str());
+
+    bool success = handOver(warmName, vmParams);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        vms.erase(warmName);
+        if (success) claimed++;
+    }
+
+    if (!success) {
+        discard(warmName);
+    }
+    return success;
+}
+
+json WarmPool::status() const {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    json flavorList = json::array();
+    for (const auto& flavor : flavors) {
+        flavorList.push_back({
+            {"name", flavor.name},
+            {"memory", flavor.memory},
+            {"vcpus", flavor.vcpus},
+            {"disk", flavor.disk},
+            {"target", flavor.target},
+            {"ready", countFlavor(flavor.name, WarmState::Ready)},
+            {"provisioning", countFlavor(flavor.name, WarmState::Provisioning)}
+        });
+    }
+
+    return {
+        {"success", true},
+        {"enabled", running.load()},
+        {"flavors", flavorList},
+        {"claimed", claimed},
+        {"missed", missed}
+    };
+}
+
+void WarmPool::run() {
+    while (running) {
+        updateProvisioning();
+        refill();
+
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeCv.wait_for(lock, std::chrono::seconds(REFILL_INTERVAL_SECONDS),
+                        [this]() { return !running || wakeRequested; });
+        wakeRequested = false;
+    }
+}
+
+void WarmPool::wake() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        wakeRequested = true;
+    }
+    wakeCv.notify_all();
+}
+
+void WarmPool::adoptExisting() {
+    virDomainPtr* domains = nullptr;
+    int count = virConnectListAllDomains(conn, &domains, 0);
+    if (count < 0) return;
+
+    std::vector<std::string> stale;
+    long long now = getCurrentTimeMs();
+    size_t adopted = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int i = 0; i < count; i++) {
+            const char* rawName = virDomainGetName(domains[i]);
+            std::string name = rawName ? rawName : "";
+
+            virDomainInfo info;
+            bool known = name.rfind(NAME_PREFIX, 0) == 0 && virDomainGetInfo(domains[i], &info) == 0;
+            virDomainFree(domains[i]);
+            if (!known) continue;
+
+            // warm-<flavor>-<timestamp>
+            std::string rest = name.substr(std::string(NAME_PREFIX).size());
+            std::string flavorName = rest.substr(0, rest.rfind('-'));
+
+            bool configured = false;
+            for (const auto& flavor : flavors) {
+                configured = configured || (flavor.name == flavorName && flavor.target > 0);
+            }
+            if (!configured) {
+                stale.push_back(name);
+                continue;
+            }
+
+            WarmVM vm;
+            vm.name = name;
+            vm.flavor = flavorName;
+            vm.state = info.state == VIR_DOMAIN_SHUTOFF ? WarmState::Ready : WarmState::Provisioning;
+            vm.createdAt = now;
+            vms[name] = vm;
+            adopted++;
+        }
+    }
+    free(domains);
+
+    if (adopted > 0) {
+        fprintf(stdout, "Warm pool: adopted %zu VM(s) from a previous run\n", adopted);
+    }
+
+    // Flavors that are no longer configured only hold resources
+    for (const auto& name : stale) {
+        discard(name);
+    }
+}
+
+void WarmPool::updateProvisioning() {
+    std::vector<std::string> provisioning;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& [name, vm] : vms) {
+            if (vm.state == WarmState::Provisioning) provisioning.push_back(name);
+        }
+    }
+
+    long long now = getCurrentTimeMs();
+    std::vector<std::string> expired;
+
+    for (const auto& name : provisioning) {
+        int state = VIR_DOMAIN_NOSTATE;
+        bool exists = false;
+
+        virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                          [&] { return virDomainLookupByName(conn, name.c_str()); });
+        if (domain) {
+            virDomainInfo info;
+            if (virDomainGetInfo(domain, &info) == 0) {
+                exists = true;
+                state = info.state;
+            }
+            virDomainFree(domain);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = vms.find(name);
+        if (it == vms.end() || it->second.state != WarmState::Provisioning) continue;
+
+        if (!exists) {
+            vms.erase(it);
+        } else if (state == VIR_DOMAIN_SHUTOFF) {
+            // cloud-init powered it off: first boot is done
+            it->second.state = WarmState::Ready;
+            fprintf(stdout, "Warm pool: %s ready after %lld s\n", name.c_str(),
+                    (now - it->second.createdAt) / 1000);
+        } else if (now - it->second.createdAt > PROVISION_TIMEOUT_MS) {
+            fprintf(stderr, "Warm pool: %s did not finish first boot, discarding\n", name.c_str());
+            vms.erase(it);
+            expired.push_back(name);
+        }
+    }
+
+    for (const auto& name : expired) {
+        discard(name);
+    }
+}
+
+void WarmPool::refill() {
+    for (const auto& flavor : flavors) {
+        while (running) {
+            size_t provisioning = 0;
+            size_t have = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (const auto& [name, vm] : vms) {
+                    if (vm.state == WarmState::Provisioning) provisioning++;
+                }
+                have = countFlavor(flavor.name, WarmState::Ready) +
+                       countFlavor(flavor.name, WarmState::Provisioning);
+            }
+
+            if (have >= flavor.target || provisioning >= MAX_CONCURRENT_PROVISIONING) break;
+
+            if (!provision(flavor)) {
+                // Retry on the next tick rather than hammering a broken host
+                return;
+            }
+        }
+    }
+}
+
+bool WarmPool::provision(const WarmFlavor& flavor) {
+    std::string name = NAME_PREFIX + flavor.name + "-" + std::to_string(getCurrentTimeMs());
+    std::string password = randomPassword();
+    if (password.empty()) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        WarmVM vm;
+        vm.name = name;
+        vm.flavor = flavor.name;
+        vm.createdAt = getCurrentTimeMs();
+        vms[name] = vm;
+    }
+
+    json params = {
+        {"hostname", name},
+        {"owner", OWNER},
+        {"memory", flavor.memory},
+        {"vcpus", flavor.vcpus},
+        {"disk", flavor.disk},
+        {"username", WARM_USERNAME},
+        {"authMethod", "password"},
+        {"password", password},
+        {"provisioning", "overlay"},
+        {"powerState", "poweroff"}
+    };
+
+    fprintf(stdout, "Warm pool: provisioning %s\n", name.c_str());
+    if (VMOperations(conn).deployVM(params)) {
+        return true;
+    }
+
+    fprintf(stderr, "Warm pool: failed to provision %s\n", name.c_str());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        vms.erase(name);
+    }
+    discard(name);
+    return false;
+}
+
+void WarmPool::discard(const std::string& name) {
+    // Nothing to clean up if the deployment never got as far as defining it
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, name.c_str()); });
+    if (!domain) return;
+    virDomainFree(domain);
+
+    json result = VMOperations(conn).deleteVM(name, true);
+    if (!result["success"].get<bool>()) {
+        fprintf(stderr, "Warm pool: failed to delete %s: %s\n", name.c_str(),
+                result.value("error", "unknown error").c_str());
+    }
+}
+
+bool WarmPool::handOver(const std::string& warmName, const json& vmParams) {
+    std::string hostname = vmParams["hostname"];
+    std::string username = vmParams.value("username", "ubuntu");
+    std::string authMethod = vmParams.value("authMethod", "password");
+    std::string password = vmParams.value("password", "");
+
+    CloudInit::UserDataOptions userOptions;
+    userOptions.hostname = vmParams["owner"].get<std::string>() + "-" + hostname;
+    userOptions.fqdn = hostname + ".local";
+    userOptions.username = username;
+    userOptions.authMethod = authMethod;
+    userOptions.sshKey = vmParams.value("sshKey", "");
+    // Packages came with first boot, and there is no reboot to wait for
+    userOptions.installPackages = false;
+    userOptions.powerState = "";
+    if (username != WARM_USERNAME) {
+        userOptions.extraCommands.push_back(std::string("userdel -r ") + WARM_USERNAME);
+    }
+
+    if (authMethod == "password" && !password.empty()) {
+        userOptions.passwordHash = vmParams.value("passwordHash", "");
+        if (userOptions.passwordHash.empty()) {
+            userOptions.passwordHash = PasswordHash::sha512Crypt(password);
+        }
+        if (userOptions.passwordHash.empty()) {
+            fprintf(stderr, "   ❌ Failed to generate password hash\n");
+            return false;
+        }
+    }
+
+    virDomainPtr domain = timeLibvirt(LibvirtCall::DomainLookupByName,
+                                      [&] { return virDomainLookupByName(conn, warmName.c_str()); });
+    if (!domain) {
+        fprintf(stderr, "   ❌ Warm VM %s disappeared\n", warmName.c_str());
+        return false;
+    }
+
+    virDomainInfo info;
+    if (virDomainGetInfo(domain, &info) < 0 || info.state != VIR_DOMAIN_SHUTOFF) {
+        fprintf(stderr, "   ❌ Warm VM %s is not shut off\n", warmName.c_str());
+        virDomainFree(domain);
+        return false;
+    }
+
+    // A new instance-id makes cloud-init apply the user's settings on next boot.
+    // The seed keeps its path: it is the one referenced by the domain XML.
+    std::string seedIso = CloudInit::buildNoCloudSeed(CloudInit::buildMetaData(hostname, hostname),
+                                                      CloudInit::buildUserData(userOptions));
+
+    std::string uploadError;
+    if (!RemoteExec::uploadFile(conn, seedPath(warmName), seedIso, uploadError)) {
+        fprintf(stderr, "   ❌ Failed to upload cloud-init ISO: %s\n", uploadError.c_str());
+        virDomainFree(domain);
+        return false;
+    }
+
+    if (virDomainRename(domain, hostname.c_str(), 0) < 0) {
+        fprintf(stderr, "   ❌ Failed to rename %s: %s\n", warmName.c_str(), lastLibvirtError().c_str());
+        virDomainFree(domain);
+        return false;
+    }
+
+    DomainInventory::instance().refresh(warmName);
+    DomainInventory::instance().refresh(hostname);
+
+    JobManager::beginStep("start");
+    if (timeLibvirt(LibvirtCall::DomainCreate, [&] { return virDomainCreate(domain); }) < 0) {
+        fprintf(stderr, "   ❌ Failed to start domain: %s\n", lastLibvirtError().c_str());
+        virDomainFree(domain);
+        // Renamed already: remove it so the fallback deployment can reuse the name
+        VMOperations(conn).deleteVM(hostname, true);
+        return false;
+    }
+
+    virDomainFree(domain);
+    return true;
+}
+
+const WarmFlavor* WarmPool::findFlavor(int memory, int vcpus, int disk) const {
+    for (const auto& flavor : flavors) {
+        if (flavor.target > 0 && flavor.memory == memory && flavor.vcpus == vcpus && flavor.disk == disk) {
+            return &flavor;
+        }
+    }
+    return nullptr;
+}
+
+size_t WarmPool::countFlavor(const std::string& flavor, WarmState state) const {
+    // Caller holds the mutex
+    size_t count = 0;
+    for (const auto& [name, vm] : vms) {
+        if (vm.flavor == flavor && vm.state == state) count++;
+    }
+    return count;
+}
+
+std::string WarmPool::seedPath(const std::string& name) {
+    return CLOUD_INIT_DIR + name + "-cloudinit.iso";
+}
@@ -0,0 +1,34 @@
+#ifndef TESTS_CHECK_HPP
+#define TESTS_CHECK_HPP
+
+#include <atomic>
+#include <cstdio>
+
+// Minimal assertions shared by the test programs: a failed CHECK is
+// reported and counted, and finish() turns the count into the exit code.
+// Safe to use from several threads.
+inline std::atomic<int>& checkFailures() {
+    static std::atomic<int> failures{0};
+    return failures;
+}
+
+#define CHECK(condition)                                                          \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__,     \
+                    #condition);                                                  \
+            checkFailures()++;                                                    \
+        }                                                                         \
+    } while (0)
+
+inline int finish(const char* name) {
+    int failures = checkFailures().load();
+    if (failures) {
+        fprintf(stderr, "%s: %d check(s) failed\n", name, failures);
+        return 1;
+    }
+    fprintf(stdout, "%s: ok\n", name);
+    return 0;
+}
+
+#endif // TESTS_CHECK_HPP
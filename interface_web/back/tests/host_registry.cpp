@@ -0,0 +1,172 @@
+// HostRegistry against several libvirt test:/// connections. Each host is
+// given its own node file, since every test:///default connection in a
+// process shares one state and the hosts would be indistinguishable.
+
+#include "../include/host_registry.hpp"
+#include "check.hpp"
+
+#include <libvirt/virterror.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const long long SLACK_MS = 500;
+
+void ignoreErrors(void*, virErrorPtr) {}
+
+std::string writeNode(const std::string& dir, const std::string& host) {
+    std::string path = dir + "/" + host + ".xml";
+    std::ofstream file(path);
+    file << "<node>"
+            "<domain type='test'>"
+            "<name>" << host << "-vm</name>"
+            "<memory>524288</memory>"
+            "<vcpu>1</vcpu>"
+            "<os><type>hvm</type></os>"
+            "</domain>"
+            "</node>";
+    return path;
+}
+
+// Names of the domains on the host; fails on node2 only
+json listDomains(virConnectPtr conn) {
+    char* uri = virConnectGetURI(conn);
+    std::string connected = uri ? uri : "";
+    free(uri);
+    if (connected.find("node2") != std::string::npos) {
+        throw std::runtime_error("node2 refuses");
+    }
+
+    virDomainPtr* domains = nullptr;
+    int count = virConnectListAllDomains(conn, &domains, 0);
+    if (count < 0) throw std::runtime_error("cannot list domains");
+
+    json names = json::array();
+    for (int i = 0; i < count; i++) {
+        names.push_back(virDomainGetName(domains[i]));
+        virDomainFree(domains[i]);
+    }
+    free(domains);
+    return names;
+}
+
+long long elapsedMs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - since).count();
+}
+
+void testHostsFromEnvironment() {
+    setenv("THOTH_HOSTS", "a=test:///default,,broken,local=test:///default,a=test:///x,b=test:///default", 1);
+    auto hosts = HostRegistry::hostsFromEnvironment();
+    unsetenv("THOTH_HOSTS");
+
+    CHECK(hosts.size() == 2);
+    CHECK(hosts.size() == 2 && hosts[0].name == "a" && hosts[1].name == "b");
+    CHECK(!hosts.empty() && hosts[0].uri == "test:///default");
+}
+
+void testGather(const std::string& dir) {
+    HostRegistry& registry = HostRegistry::instance();
+    CHECK(!registry.hasHosts());
+
+    registry.start({
+        {"node1", "test://" + writeNode(dir, "node1")},
+        {"node2", "test://" + writeNode(dir, "node2")},
+        {"missing", "test://" + dir + "/missing.xml"},
+        {"node3", "test://" + writeNode(dir, "node3")},
+    });
+    CHECK(registry.hasHosts());
+    CHECK(registry.status().size() == 4);
+
+    // Results in configuration order, whatever order the hosts answer in
+    bool localRan = false;
+    const long long timeoutMs = 1000;
+    auto started = std::chrono::steady_clock::now();
+    auto results = registry.gather(listDomains, [&]() { localRan = true; }, timeoutMs);
+    long long took = elapsedMs(started);
+
+    CHECK(localRan);
+    CHECK(results.size() == 4);
+    if (results.size() == 4) {
+        CHECK(results[0].host == "node1" && results[0].ok);
+        CHECK(results[0].data == json::array({"node1-vm"}));
+
+        CHECK(results[1].host == "node2" && !results[1].ok);
+        CHECK(results[1].error == "node2 refuses");
+
+        // Never connected: waits for a connection until the deadline
+        CHECK(results[2].host == "missing" && !results[2].ok);
+        CHECK(!results[2].error.empty());
+
+        CHECK(results[3].host == "node3" && results[3].ok);
+        CHECK(results[3].data == json::array({"node3-vm"}));
+    }
+    CHECK(took <= timeoutMs + SLACK_MS);
+
+    // A host that does not answer costs the timeout, not the query time
+    const long long queryMs = 1500;
+    const long long shortTimeoutMs = 200;
+    started = std::chrono::steady_clock::now();
+    results = registry.gather([queryMs](virConnectPtr) -> json {
+        std::this_thread::sleep_for(std::chrono::milliseconds(queryMs));
+        return json::array();
+    }, nullptr, shortTimeoutMs);
+    took = elapsedMs(started);
+
+    CHECK(took >= shortTimeoutMs && took <= shortTimeoutMs + SLACK_MS);
+    CHECK(results.size() == 4);
+    for (const auto& result : results) {
+        CHECK(!result.ok);
+    }
+    if (results.size() == 4) {
+        CHECK(results[0].error.find("Timed out") == 0);
+        CHECK(results[0].elapsedMs == shortTimeoutMs);
+    }
+
+    bool timedOut = false;
+    for (const auto& host : registry.status()) {
+        if (host["name"] == "node1") timedOut = host["timeouts"].get<size_t>() == 1;
+    }
+    CHECK(timedOut);
+
+    // Let the abandoned queries finish before the pools go away
+    std::this_thread::sleep_for(std::chrono::milliseconds(queryMs));
+    registry.stop();
+    CHECK(!registry.hasHosts());
+
+    // Without hosts only the local part runs
+    localRan = false;
+    results = registry.gather(listDomains, [&]() { localRan = true; });
+    CHECK(localRan && results.empty());
+}
+
+} // namespace
+
+int main() {
+    virSetErrorFunc(nullptr, ignoreErrors);
+
+    char dir[] = "/tmp/thoth-hosts-XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    testHostsFromEnvironment();
+    testGather(dir);
+
+    for (const char* host : {"node1", "node2", "node3"}) {
+        unlink((std::string(dir) + "/" + host + ".xml").c_str());
+    }
+    rmdir(dir);
+
+    return finish("host_registry");
+}
@@ -0,0 +1,103 @@
+// JobManager with a single worker: a suspended job must give the worker
+// back to the queue and finish once resumed, whether resume() comes
+// before or after its job function returned.
+
+#include "../include/job_manager.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+namespace {
+
+bool waitForState(const std::string& id, JobState state, Job& job) {
+    for (int i = 0; i < 500; i++) {
+        if (JobManager::instance().get(id, job) && job.state == state) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+void testSuspendFreesTheWorker() {
+    auto& jobs = JobManager::instance();
+    std::string parkedId;
+
+    std::string first = jobs.submit("test", "alice", "vm-1", [&parkedId](json&) {
+        JobManager::beginStep("wait");
+        parkedId = JobManager::suspend([](json& result) {
+            JobManager::beginStep("finish");
+            result = {{"resumed", true}};
+            return true;
+        });
+        return true;
+    });
+    CHECK(!first.empty());
+
+    // Runs on the only worker while the first job waits
+    std::string second = jobs.submit("test", "alice", "vm-2", [](json&) { return true; });
+    Job job;
+    CHECK(waitForState(second, JobState::Succeeded, job));
+
+    CHECK(jobs.get(first, job) && job.state == JobState::Running);
+    CHECK(parkedId == first);
+
+    jobs.resume(first);
+    CHECK(waitForState(first, JobState::Succeeded, job));
+    CHECK(job.result == json({{"resumed", true}}));
+    CHECK(job.steps.size() == 2 && job.steps[0].name == "wait" && job.steps[1].name == "finish");
+}
+
+void testResumeBeforeReturn() {
+    auto& jobs = JobManager::instance();
+
+    // What happens when the awaited event already happened
+    std::string id = jobs.submit("test", "bob", "vm-3", [](json&) {
+        std::string self = JobManager::suspend([](json& result) {
+            result = "done";
+            return true;
+        });
+        JobManager::instance().resume(self);
+        return true;
+    });
+
+    Job job;
+    CHECK(waitForState(id, JobState::Succeeded, job));
+    CHECK(job.result == "done");
+}
+
+void testFailureDropsTheContinuation() {
+    auto& jobs = JobManager::instance();
+    std::atomic<bool> continued{false};
+
+    std::string id = jobs.submit("test", "bob", "vm-4", [&continued](json&) -> bool {
+        JobManager::suspend([&continued](json&) {
+            continued = true;
+            return true;
+        });
+        throw std::runtime_error("gave up");
+    });
+
+    Job job;
+    CHECK(waitForState(id, JobState::Failed, job));
+    CHECK(job.error == "gave up");
+    jobs.resume(id);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    CHECK(!continued);
+}
+
+} // namespace
+
+int main() {
+    // Outside of a job there is nothing to suspend
+    CHECK(JobManager::suspend([](json&) { return true; }).empty());
+
+    JobManager::instance().start(1);
+    testSuspendFreesTheWorker();
+    testResumeBeforeReturn();
+    testFailureDropsTheContinuation();
+    JobManager::instance().stop();
+
+    return finish("job_manager");
+}
@@ -0,0 +1,100 @@
+// OwnershipIndex: assignment, reassignment and release, read back both
+// ways, and readers running while the index changes.
+
+#include "../include/ownership_index.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int CHURN_ROUNDS = 2000;
+const int READERS = 4;
+
+std::vector<std::string> sorted(std::vector<std::string> names) {
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+void testAssignAndRelease() {
+    OwnershipIndex& index = OwnershipIndex::instance();
+    std::string owner;
+
+    index.assign("alice__web__1", "alice");
+    index.assign("alice__db__2", "alice");
+    index.assign("alice__db__2", "alice");
+    index.assign("bob__ci__3", "bob");
+    index.assign("stray", "");
+
+    CHECK(index.ownerOf("alice__web__1", owner) && owner == "alice");
+    CHECK(!index.ownerOf("stray", owner));
+    CHECK(sorted(index.vmsOf("alice")) == std::vector<std::string>({"alice__db__2", "alice__web__1"}));
+    CHECK(index.vmsOf("carol").empty());
+
+    // A warm VM claimed by another user moves between owners
+    index.assign("alice__web__1", "bob");
+    CHECK(index.ownerOf("alice__web__1", owner) && owner == "bob");
+    CHECK(index.vmsOf("alice") == std::vector<std::string>({"alice__db__2"}));
+    CHECK(sorted(index.vmsOf("bob")) == std::vector<std::string>({"alice__web__1", "bob__ci__3"}));
+
+    index.release("alice__db__2");
+    index.release("alice__db__2");
+    index.release("never__assigned__0");
+    CHECK(!index.ownerOf("alice__db__2", owner));
+    CHECK(index.vmsOf("alice").empty());
+
+    index.clear();
+    CHECK(!index.ownerOf("bob__ci__3", owner));
+    CHECK(index.vmsOf("bob").empty());
+}
+
+// One writer moves a VM between two owners and drops it; readers must
+// always see both directions agree
+void testConcurrentReaders() {
+    OwnershipIndex& index = OwnershipIndex::instance();
+    index.assign("fixed__vm__1", "alice");
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < READERS; r++) {
+        readers.emplace_back([&index, &done]() {
+            while (!done) {
+                std::string owner;
+                CHECK(index.ownerOf("fixed__vm__1", owner) && owner == "alice");
+
+                if (index.ownerOf("moving__vm__2", owner)) {
+                    CHECK(owner == "alice" || owner == "bob");
+                }
+                auto alice = index.vmsOf("alice");
+                CHECK(std::find(alice.begin(), alice.end(), "fixed__vm__1") != alice.end());
+                CHECK(alice.size() <= 2);
+            }
+        });
+    }
+
+    for (int i = 0; i < CHURN_ROUNDS; i++) {
+        index.assign("moving__vm__2", i % 2 ? "alice" : "bob");
+        if (i % 3 == 0) index.release("moving__vm__2");
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    index.release("moving__vm__2");
+    CHECK(index.vmsOf("alice") == std::vector<std::string>({"fixed__vm__1"}));
+    CHECK(index.vmsOf("bob").empty());
+    index.clear();
+}
+
+} // namespace
+
+int main() {
+    testAssignAndRelease();
+    testConcurrentReaders();
+    return finish("ownership_index");
+}
@@ -0,0 +1,229 @@
+// PlacementEngine::choose, directly and over a replay of thousands of
+// synthetic deploys and deletions on a mixed set of hosts, for both
+// policies. The replay counts deploys with PlacementEngine::reserve and
+// release, the way place() and finish() do, and checks that no host ever goes past its overcommit or disk
+// limits and that a rejection only happens when nothing fits.
+
+#include "../include/placement.hpp"
+#include "check.hpp"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const unsigned long long GIB = 1024ULL * 1024 * 1024;
+const int DEPLOYS = 5000;
+const int OWNERS = 40;
+const double DELETE_PROBABILITY = 0.45;
+
+HostState makeHost(const std::string& name, unsigned int cpus, unsigned long long memoryGiB,
+                   long long diskGiB) {
+    HostState host;
+    host.name = name;
+    host.reachable = true;
+    host.cpus = cpus;
+    host.memoryBytes = memoryGiB * GIB;
+    host.freeMemoryBytes = host.memoryBytes * 9 / 10;
+    host.freeDiskBytes = diskGiB < 0 ? -1 : diskGiB * static_cast<long long>(GIB);
+    return host;
+}
+
+std::vector<HostState> mixedHosts() {
+    std::vector<HostState> hosts = {
+        makeHost("local", 16, 64, 1000),
+        makeHost("node2", 32, 128, 2000),
+        makeHost("node3", 8, 32, 400),
+        makeHost("node4", 64, 256, 4000),
+        makeHost("node5", 16, 64, -1),      // disk space unknown
+        makeHost("node6", 32, 128, 2000),
+    };
+    HostState down = makeHost("down", 64, 512, 8000);
+    down.reachable = false;
+    hosts.push_back(down);
+    return hosts;
+}
+
+// The capacity rules choose() is meant to enforce
+bool fits(const HostState& host, const PlacementRequest& request, const PlacementConfig& config) {
+    if (!host.reachable || host.cpus == 0 || host.memoryBytes == 0) return false;
+    if (host.committedVcpus + request.vcpus > host.cpus * config.cpuOvercommit) return false;
+    if (host.committedMemoryBytes + request.memoryBytes > host.memoryBytes * config.memoryOvercommit) return false;
+    return host.freeDiskBytes < 0 || request.diskBytes <= static_cast<unsigned long long>(host.freeDiskBytes);
+}
+
+unsigned int owned(const HostState& host, const std::string& owner) {
+    auto it = host.vmsByOwner.find(owner);
+    return it == host.vmsByOwner.end() ? 0 : it->second;
+}
+
+void testChoose() {
+    PlacementConfig config;
+    PlacementRequest request = PlacementRequest::fromDeployBody(
+        {{"owner", "alice"}, {"vcpus", 2}, {"memory", 2048}, {"disk", 20}});
+    CHECK(request.vcpus == 2);
+    CHECK(request.memoryBytes == 2 * GIB);
+    CHECK(request.diskBytes == 21 * GIB);
+
+    std::string error;
+    CHECK(PlacementEngine::choose({}, request, config, error) == -1);
+    CHECK(error == "No hypervisor is available");
+
+    // Two identical hosts, one already busier
+    std::vector<HostState> hosts = {makeHost("a", 16, 64, 1000), makeHost("b", 16, 64, 1000)};
+    PlacementEngine::reserve(hosts[1], PlacementRequest::fromDeployBody(
+        {{"owner", "bob"}, {"vcpus", 8}, {"memory", 16384}, {"disk", 100}}));
+
+    config.policy = PlacementPolicy::BinPack;
+    CHECK(PlacementEngine::choose(hosts, request, config, error) == 1);
+    config.policy = PlacementPolicy::Spread;
+    CHECK(PlacementEngine::choose(hosts, request, config, error) == 0);
+
+    // Anti-affinity wins over the policy, unless turned off
+    PlacementEngine::reserve(hosts[0], PlacementRequest::fromDeployBody({{"owner", "alice"}, {"vcpus", 1}}));
+    PlacementEngine::reserve(hosts[1], PlacementRequest::fromDeployBody({{"owner", "alice"}, {"vcpus", 1}}));
+    PlacementEngine::reserve(hosts[1], PlacementRequest::fromDeployBody({{"owner", "alice"}, {"vcpus", 1}}));
+    config.policy = PlacementPolicy::BinPack;
+    CHECK(PlacementEngine::choose(hosts, request, config, error) == 0);
+    config.ownerAntiAffinity = false;
+    CHECK(PlacementEngine::choose(hosts, request, config, error) == 1);
+
+    // Full on every count
+    PlacementRequest huge = request;
+    huge.vcpus = 1000;
+    CHECK(PlacementEngine::choose(hosts, huge, config, error) == -1);
+    CHECK(error.find("vCPUs full on 2") != std::string::npos);
+
+    huge = request;
+    huge.diskBytes = 5000 * GIB;
+    CHECK(PlacementEngine::choose(hosts, huge, config, error) == -1);
+    CHECK(error.find("disk on 2 of 2 host(s)") != std::string::npos);
+}
+
+// Free memory and disk stop at zero when a host is measured fuller than
+// its reservations say; releasing must give back only what was taken
+void testReserveRelease() {
+    HostState host = makeHost("a", 16, 64, 30);
+    const HostState initial = host;
+    PlacementRequest request = PlacementRequest::fromDeployBody(
+        {{"owner", "alice"}, {"vcpus", 4}, {"memory", 65536}, {"disk", 40}});
+
+    PlacementEngine::Held held = PlacementEngine::reserve(host, request);
+    CHECK(held.diskBytes == 30 * static_cast<long long>(GIB));
+    CHECK(held.freeMemoryBytes == initial.freeMemoryBytes);
+    CHECK(host.freeDiskBytes == 0);
+    CHECK(host.freeMemoryBytes == 0);
+    CHECK(owned(host, "alice") == 1);
+
+    PlacementEngine::release(host, request, held);
+    CHECK(host.freeDiskBytes == initial.freeDiskBytes);
+    CHECK(host.freeMemoryBytes == initial.freeMemoryBytes);
+    CHECK(host.committedVcpus == 0 && host.committedMemoryBytes == 0);
+    CHECK(host.vmsByOwner.empty());
+
+    // Unknown disk space stays unknown
+    HostState unknown = makeHost("b", 16, 64, -1);
+    held = PlacementEngine::reserve(unknown, request);
+    CHECK(held.diskBytes == 0 && unknown.freeDiskBytes == -1);
+    PlacementEngine::release(unknown, request, held);
+    CHECK(unknown.freeDiskBytes == -1);
+}
+
+struct Placed {
+    size_t host;
+    PlacementRequest request;
+    PlacementEngine::Held held;
+};
+
+void simulate(PlacementPolicy policy, const char* label) {
+    PlacementConfig config;
+    config.enabled = true;
+    config.policy = policy;
+
+    std::vector<HostState> hosts = mixedHosts();
+    std::vector<Placed> live;
+    std::vector<size_t> placedOn(hosts.size(), 0);
+    size_t rejected = 0;
+    int firstRejection = -1;
+
+    // Same sequence for both policies
+    std::mt19937 random(42);
+    const int vcpuChoices[] = {1, 1, 2, 2, 4, 8};
+    const int memoryChoices[] = {512, 1024, 2048, 4096, 8192, 16384};   // MB
+    const int diskChoices[] = {10, 20, 40, 80, 160};                      // GB
+
+    for (int i = 0; i < DEPLOYS; i++) {
+        if (!live.empty() && std::uniform_real_distribution<>(0, 1)(random) < DELETE_PROBABILITY) {
+            size_t victim = std::uniform_int_distribution<size_t>(0, live.size() - 1)(random);
+            PlacementEngine::release(hosts[live[victim].host], live[victim].request, live[victim].held);
+            live[victim] = live.back();
+            live.pop_back();
+        }
+
+        PlacementRequest request = PlacementRequest::fromDeployBody({
+            {"owner", "user" + std::to_string(random() % OWNERS)},
+            {"vcpus", vcpuChoices[random() % 6]},
+            {"memory", memoryChoices[random() % 6]},
+            {"disk", diskChoices[random() % 5]}
+        });
+
+        std::string error;
+        int chosen = PlacementEngine::choose(hosts, request, config, error);
+        if (chosen < 0) {
+            rejected++;
+            if (firstRejection < 0) firstRejection = i;
+            CHECK(!error.empty());
+            for (const auto& host : hosts) {
+                CHECK(!fits(host, request, config));
+            }
+            continue;
+        }
+
+        HostState& host = hosts[chosen];
+        CHECK(fits(host, request, config));
+
+        // No host that fits holds fewer of the owner's VMs
+        for (const auto& other : hosts) {
+            if (fits(other, request, config)) {
+                CHECK(owned(host, request.owner) <= owned(other, request.owner));
+            }
+        }
+
+        live.push_back({static_cast<size_t>(chosen), request, PlacementEngine::reserve(host, request)});
+        placedOn[chosen]++;
+
+        CHECK(host.committedVcpus <= host.cpus * config.cpuOvercommit);
+        CHECK(host.committedMemoryBytes <= host.memoryBytes * config.memoryOvercommit);
+        CHECK(host.freeDiskBytes == -1 || host.freeDiskBytes >= 0);
+    }
+
+    CHECK(placedOn.back() == 0);   // the unreachable host
+
+    printf("%s: %d deploys, %zu rejected (first at #%d), %zu VMs left\n",
+           label, DEPLOYS, rejected, firstRejection, live.size());
+    printf("  %-6s %8s %8s %8s %8s\n", "host", "placed", "vCPU %", "mem %", "disk %");
+    for (size_t i = 0; i < hosts.size(); i++) {
+        const HostState& host = hosts[i];
+        double initialDisk = static_cast<double>(mixedHosts()[i].freeDiskBytes);
+        printf("  %-6s %8zu %8.1f %8.1f ", host.name.c_str(), placedOn[i],
+               100.0 * host.committedVcpus / (host.cpus * config.cpuOvercommit),
+               100.0 * host.committedMemoryBytes / (host.memoryBytes * config.memoryOvercommit));
+        if (host.freeDiskBytes < 0) {
+            printf("%8s\n", "-");
+        } else {
+            printf("%8.1f\n", 100.0 * (1.0 - host.freeDiskBytes / initialDisk));
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    testChoose();
+    testReserveRelease();
+    simulate(PlacementPolicy::BinPack, "binpack");
+    simulate(PlacementPolicy::Spread, "spread");
+    return finish("placement");
+}
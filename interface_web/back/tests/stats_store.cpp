@@ -0,0 +1,184 @@
+// StatsStore under concurrent use: one writer (the sampler's role), many
+// readers of latest/history/forEachLatest, and a thread churning series in
+// and out with remove/pruneOlderThan. Every recorded field is derived from
+// the round number, so a torn or out-of-order read shows up as a mismatch.
+
+#include "../include/stats_store.hpp"
+#include "check.hpp"
+
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+const int VMS = 64;
+const int ROUNDS = 2000;
+const int READERS = 8;
+const int READS = 50000;      // per reader
+const int CHURN_ROUNDS = 2000;
+const size_t HISTORY = 32;
+const long long INTERVAL_MS = 1000;
+
+// Half a CPU-second per interval, i.e. 50%
+const unsigned long long CPU_PER_ROUND = 500000000ULL;
+
+std::string vmName(int i) {
+    return "vm-" + std::to_string(i);
+}
+
+DomainStats::DomainSample sample(const std::string& name, long long round) {
+    DomainStats::DomainSample s;
+    s.name = name;
+    s.timestamp = round * INTERVAL_MS;
+    s.cpuTime = round * CPU_PER_ROUND;
+    s.balloonCurrent = round;
+    s.balloonMaximum = ROUNDS;
+
+    DomainStats::BlockSample disk;
+    disk.name = "vda";
+    disk.readBytes = round;
+    disk.writeBytes = round * 2;
+    s.disks.push_back(disk);
+
+    DomainStats::NetSample nic;
+    nic.name = "vnet0";
+    nic.rxBytes = round;
+    nic.txBytes = round * 3;
+    s.nics.push_back(nic);
+    return s;
+}
+
+// Every field of a point must come from the same record() call
+bool consistent(const StatsPoint& point) {
+    long long round = point.timestamp / INTERVAL_MS;
+    if (point.timestamp != round * INTERVAL_MS || round < 1) return false;
+    if (point.memoryUsed != static_cast<unsigned long long>(round)) return false;
+    if (point.disks.size() != 1 || point.nics.size() != 1) return false;
+    if (point.disks[0].readBytes != static_cast<unsigned long long>(round) ||
+        point.disks[0].writeBytes != static_cast<unsigned long long>(round * 2)) return false;
+    if (point.nics[0].rxBytes != static_cast<unsigned long long>(round) ||
+        point.nics[0].txBytes != static_cast<unsigned long long>(round * 3)) return false;
+    return true;
+}
+
+void testCpuPercent() {
+    StatsStore store;
+    store.setHistoryCapacity(4);
+
+    store.record(sample("cpu", 1));
+    store.record(sample("cpu", 2));
+
+    StatsPoint point;
+    CHECK(store.latest("cpu", point));
+    CHECK(point.cpuPercent > 49.999 && point.cpuPercent < 50.001);
+
+    // A restarted domain reports a smaller cpuTime: no negative usage
+    DomainStats::DomainSample restarted = sample("cpu", 3);
+    restarted.cpuTime = 0;
+    store.record(restarted);
+    CHECK(store.latest("cpu", point));
+    CHECK(point.cpuPercent == 0.0);
+
+    // The ring keeps the newest points only
+    store.record(sample("cpu", 4));
+    store.record(sample("cpu", 5));
+    auto points = store.history("cpu", 0);
+    CHECK(points.size() == 4);
+    CHECK(!points.empty() && points.front().timestamp == 2 * INTERVAL_MS);
+    CHECK(store.history("cpu", 4 * INTERVAL_MS).size() == 2);
+}
+
+void testConcurrentAccess() {
+    StatsStore store;
+    store.setHistoryCapacity(HISTORY);
+
+    std::vector<std::thread> threads;
+
+    // Sampler: every VM once per round, in timestamp order
+    threads.emplace_back([&]() {
+        for (long long round = 1; round <= ROUNDS; round++) {
+            for (int i = 0; i < VMS; i++) {
+                store.record(sample(vmName(i), round));
+            }
+        }
+    });
+
+    for (int r = 0; r < READERS; r++) {
+        threads.emplace_back([&, r]() {
+            std::unordered_map<int, long long> lastSeen;
+            int i = r;
+
+            // A fixed amount of work rather than "until the writer is done":
+            // readers are favoured by the shared lock, and on a single CPU the
+            // writer would barely progress while they spin
+            for (int count = 0; count < READS; count++) {
+                i = (i + 7) % VMS;
+                StatsPoint point;
+                if (store.latest(vmName(i), point)) {
+                    CHECK(consistent(point));
+                    CHECK(point.timestamp >= lastSeen[i]);
+                    lastSeen[i] = point.timestamp;
+                    if (point.timestamp > INTERVAL_MS) {
+                        CHECK(point.cpuPercent > 49.999 && point.cpuPercent < 50.001);
+                    }
+                }
+
+                if (count % 16 == 0) {
+                    auto points = store.history(vmName(i), 0);
+                    CHECK(points.size() <= HISTORY);
+                    for (size_t p = 0; p < points.size(); p++) {
+                        CHECK(consistent(points[p]));
+                        if (p > 0) CHECK(points[p].timestamp == points[p - 1].timestamp + INTERVAL_MS);
+                    }
+                }
+
+                if (count % 256 == 0) {
+                    store.forEachLatest([](const std::string&, const StatsPoint& latest) {
+                        CHECK(consistent(latest));
+                    });
+                }
+            }
+        });
+    }
+
+    // Series appearing and disappearing while the others are read
+    threads.emplace_back([&]() {
+        for (long long round = 1; round <= CHURN_ROUNDS; round++) {
+            store.record(sample("churn-a", round));
+            store.record(sample("churn-b", round));
+            store.remove("churn-a");
+            store.pruneOlderThan(0);   // exclusive pass over every shard, drops nothing
+        }
+        store.remove("churn-b");
+    });
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    CHECK(store.size() == VMS);
+    for (int i = 0; i < VMS; i++) {
+        StatsPoint point;
+        CHECK(store.latest(vmName(i), point));
+        CHECK(point.timestamp == ROUNDS * INTERVAL_MS);
+        CHECK(store.history(vmName(i), 0).size() == HISTORY);
+    }
+
+    // Everything older than the last round goes
+    store.record(sample("late", ROUNDS + 1));
+    store.pruneOlderThan((ROUNDS + 1) * INTERVAL_MS);
+    CHECK(store.size() == 1);
+
+    fprintf(stdout, "%d rounds x %d VMs, %d reads on each of %d threads\n",
+            ROUNDS, VMS, READS, READERS);
+}
+
+} // namespace
+
+int main() {
+    testCpuPercent();
+    testConcurrentAccess();
+    return finish("stats_store");
+}
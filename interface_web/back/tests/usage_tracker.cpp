@@ -0,0 +1,112 @@
+// UsageTracker: per-owner totals as domain entries come, change and go,
+// and deploy reservations held next to them.
+
+#include "../include/usage_tracker.hpp"
+#include "../include/domain_inventory.hpp"
+#include "check.hpp"
+
+#include <string>
+
+namespace {
+
+const unsigned long long GIB = 1024ULL * 1024 * 1024;
+
+DomainEntry makeEntry(const std::string& name, const std::string& owner,
+                      unsigned int vcpus, unsigned long long memoryMiB, unsigned long long diskGiB) {
+    DomainEntry entry;
+    entry.name = name;
+    entry.owner = owner;
+    entry.vcpus = vcpus;
+    entry.memory = memoryMiB * 1024;
+    entry.maxMemory = entry.memory;
+    entry.storage = diskGiB * GIB;
+    return entry;
+}
+
+bool same(const ResourceUsage& usage, int vms, int cpu, long long ram, long long storage) {
+    return usage.vms == vms && usage.cpu == cpu && usage.ram == ram && usage.storage == storage;
+}
+
+void testUpdate() {
+    UsageTracker& tracker = UsageTracker::instance();
+
+    DomainEntry web = makeEntry("alice__web__1", "alice", 2, 2048, 20);
+    DomainEntry db = makeEntry("alice__db__2", "alice", 4, 8192, 100);
+    DomainEntry bob = makeEntry("bob__ci__3", "bob", 1, 512, 10);
+    tracker.update(web.name, &web);
+    tracker.update(db.name, &db);
+    tracker.update(bob.name, &bob);
+
+    CHECK(same(tracker.get("alice"), 2, 6, 10240, 120 * GIB));
+    CHECK(same(tracker.get("bob"), 1, 1, 512, 10 * GIB));
+    CHECK(same(tracker.get("carol"), 0, 0, 0, 0));
+
+    // Hotplug and balloon: the new state replaces the old one
+    web.vcpus = 4;
+    web.memory = 1024 * 1024;
+    tracker.update(web.name, &web);
+    tracker.update(web.name, &web);
+    CHECK(same(tracker.get("alice"), 2, 8, 9216, 120 * GIB));
+
+    // Taken over by another owner (a claimed warm VM)
+    web.owner = "bob";
+    tracker.update(web.name, &web);
+    CHECK(same(tracker.get("alice"), 1, 4, 8192, 100 * GIB));
+    CHECK(same(tracker.get("bob"), 2, 5, 1536, 30 * GIB));
+
+    // Undefined, twice
+    tracker.update(db.name, nullptr);
+    tracker.update(db.name, nullptr);
+    CHECK(same(tracker.get("alice"), 0, 0, 0, 0));
+
+    // Not named userid__hostname__timestamp
+    DomainEntry stray = makeEntry("stray", "", 8, 4096, 50);
+    tracker.update(stray.name, &stray);
+    CHECK(same(tracker.get(""), 0, 0, 0, 0));
+
+    tracker.clear();
+    CHECK(same(tracker.get("bob"), 0, 0, 0, 0));
+}
+
+void testReservations() {
+    UsageTracker& tracker = UsageTracker::instance();
+
+    ResourceUsage small;
+    small.vms = 1;
+    small.cpu = 1;
+    small.ram = 1024;
+    small.storage = 10 * static_cast<long long>(GIB);
+    ResourceUsage large = small;
+    large.cpu = 8;
+    large.ram = 16384;
+
+    tracker.reserve("alice__a__1", "alice", small);
+    tracker.reserve("alice__b__2", "alice", large);
+    CHECK(same(tracker.reserved("alice"), 2, 9, 17408, 20 * GIB));
+    CHECK(same(tracker.get("alice"), 0, 0, 0, 0));
+
+    // Reserving the same VM again replaces its reservation
+    tracker.reserve("alice__b__2", "alice", small);
+    CHECK(same(tracker.reserved("alice"), 2, 2, 2048, 20 * GIB));
+
+    // Reservations outlive an inventory reload
+    DomainEntry entry = makeEntry("alice__a__1", "alice", 1, 1024, 10);
+    tracker.update(entry.name, &entry);
+    tracker.clear();
+    CHECK(same(tracker.reserved("alice"), 2, 2, 2048, 20 * GIB));
+
+    tracker.release("alice__a__1");
+    tracker.release("alice__a__1");
+    tracker.release("nobody");
+    CHECK(same(tracker.reserved("alice"), 1, 1, 1024, 10 * GIB));
+    tracker.release("alice__b__2");
+    CHECK(same(tracker.reserved("alice"), 0, 0, 0, 0));
+}
+
+} // namespace
+
+int main() {
+    testUpdate();
+    testReservations();
+    return finish("usage_tracker");
+}
@@ -0,0 +1,202 @@
+// UserStore persistence. Each phase runs in a child process, so every
+// open() starts from what the previous phase left on disk, the way a
+// restart would: journal replay after a crash, a torn last record,
+// compaction, and measured usage never reaching the files.
+
+#include "../include/user_store.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+std::string snapshotPath;
+std::string journalPath;
+
+// Runs `phase` in a child; _exit skips close(), like a crash
+bool inChild(const char* name, const std::function<void()>& phase) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        phase();
+        int code = finish(name);
+        fflush(stdout);
+        _exit(code);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+long long fileSize(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_size : -1;
+}
+
+json makeUser(const std::string& username) {
+    return {
+        {"username", username},
+        {"role", "user"},
+        {"quotas", {{"maxVMs", 5}}},
+        {"usage", {{"vms", 0}}}
+    };
+}
+
+void setRole(const std::string& username, const std::string& role) {
+    json updated;
+    std::string error;
+    CHECK(UserStore::instance().update(username, [&role](json& user) { user["role"] = role; },
+                                       updated, error));
+    CHECK(updated["role"] == role);
+}
+
+void writeAndCrash() {
+    UserStore& store = UserStore::instance();
+    CHECK(store.open(snapshotPath));
+
+    std::string error;
+    for (const char* name : {"alice", "bob", "carol"}) {
+        json user = makeUser(name);
+        CHECK(store.insert(user, error));
+    }
+    json duplicate = makeUser("alice");
+    CHECK(!store.insert(duplicate, error) && error == "User already exists");
+
+    setRole("alice", "admin");
+    CHECK(store.remove("bob", error));
+    CHECK(!store.remove("bob", error));
+
+    // Measured usage is visible, including through update()
+    store.setUsage("alice", {{"vms", 7}});
+    store.setUsage("nobody", {{"vms", 1}});
+    json user;
+    CHECK(store.get("alice", user) && user["usage"]["vms"] == 7);
+    setRole("alice", "admin");
+    CHECK(store.get("alice", user) && user["usage"]["vms"] == 7);
+    CHECK(!store.exists("nobody"));
+}
+
+void checkReplayed() {
+    UserStore& store = UserStore::instance();
+    CHECK(store.open(snapshotPath));
+
+    CHECK(store.usernames() == std::vector<std::string>({"alice", "carol"}));
+    json alice, carol;
+    CHECK(store.get("alice", alice) && alice["role"] == "admin" && alice["id"] == 1);
+    CHECK(store.get("carol", carol) && carol["id"] == 3);
+
+    // The usage measured before the crash was never written
+    CHECK(alice["usage"]["vms"] == 0);
+    CHECK(readFile(journalPath).find("\"vms\":7") == std::string::npos);
+
+    // Ids are not reused
+    std::string error;
+    json dave = makeUser("dave");
+    CHECK(store.insert(dave, error) && dave["id"] == 4);
+}
+
+void checkTornRecord() {
+    UserStore& store = UserStore::instance();
+    CHECK(store.open(snapshotPath));
+
+    CHECK(!store.exists("erin"));
+    CHECK(store.exists("dave"));
+    CHECK(store.usernames().size() == 3);
+
+    // Rewritten into the snapshot rather than appended to
+    CHECK(fileSize(journalPath) == 0);
+    CHECK(readFile(snapshotPath).find("erin") == std::string::npos);
+
+    std::string error;
+    json frank = makeUser("frank");
+    CHECK(store.insert(frank, error));
+}
+
+void checkAfterTornRecord() {
+    UserStore& store = UserStore::instance();
+    CHECK(store.open(snapshotPath));
+    CHECK(store.usernames() == std::vector<std::string>({"alice", "carol", "dave", "frank"}));
+}
+
+void compactAndClose() {
+    UserStore& store = UserStore::instance();
+    CHECK(store.open(snapshotPath));
+    store.setUsage("carol", {{"vms", 9}});
+
+    long long largest = 0;
+    for (size_t i = 0; i < UserStore::COMPACT_AFTER_RECORDS + 10; i++) {
+        setRole("carol", "role-" + std::to_string(i));
+        largest = std::max(largest, fileSize(journalPath));
+    }
+
+    // Compacted once on the way, so the journal holds only the last records
+    CHECK(fileSize(journalPath) < largest);
+    CHECK(fileSize(journalPath) > 0);
+    CHECK(readFile(snapshotPath).find("role-") != std::string::npos);
+    CHECK(readFile(snapshotPath).find("\"vms\": 9") == std::string::npos);
+
+    store.close();
+    CHECK(fileSize(journalPath) == 0);
+}
+
+void checkCompacted() {
+    UserStore& store = UserStore::instance();
+    CHECK(store.open(snapshotPath));
+
+    json carol;
+    std::string last = "role-" + std::to_string(UserStore::COMPACT_AFTER_RECORDS + 9);
+    CHECK(store.get("carol", carol) && carol["role"] == last);
+    CHECK(carol["usage"]["vms"] == 0);
+    CHECK(store.usernames().size() == 4);
+}
+
+} // namespace
+
+int main() {
+    char dir[] = "/tmp/thoth-users-XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snapshotPath = std::string(dir) + "/users.json";
+    journalPath = snapshotPath + ".journal";
+
+    CHECK(inChild("user_store: write", writeAndCrash));
+    CHECK(fileSize(snapshotPath) < 0);     // nothing compacted yet
+    CHECK(inChild("user_store: replay", checkReplayed));
+
+    // A write cut short: the record is missing its end
+    {
+        std::ofstream journal(journalPath, std::ios::app);
+        journal << R"({"op":"put","user":{"username":"erin","role":"us)";
+    }
+    CHECK(inChild("user_store: torn record", checkTornRecord));
+    CHECK(inChild("user_store: after torn record", checkAfterTornRecord));
+
+    CHECK(inChild("user_store: compaction", compactAndClose));
+    CHECK(inChild("user_store: compacted", checkCompacted));
+
+    unlink(journalPath.c_str());
+    unlink(snapshotPath.c_str());
+    rmdir(dir);
+
+    return finish("user_store");
+}
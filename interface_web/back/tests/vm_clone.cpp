@@ -0,0 +1,126 @@
+// Naming and XML rewriting behind CloneOperations: where a clone's disks
+// and a frozen source's new top images go, and what the clone's
+// definition keeps from the source's.
+
+#include "../include/vm_clone.hpp"
+#include "check.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::string DIR = "/var/lib/libvirt/images/";
+const std::string SOURCE = "alice__web__1718000000";
+const std::string CLONE = "alice__web-copy__1718000500";
+
+const char* SOURCE_XML = R"(<domain type='kvm'>
+  <name>alice__web__1718000000</name>
+  <uuid>6f1c1b7e-3f0a-4c36-9d4e-2b1f0c8e5a11</uuid>
+  <memory unit='KiB'>2097152</memory>
+  <devices>
+    <disk type='file' device='disk'>
+      <driver name='qemu' type='qcow2'/>
+      <source file='/var/lib/libvirt/images/alice__web__1718000000.qcow2'/>
+      <target dev='vda' bus='virtio'/>
+    </disk>
+    <disk type='file' device='disk'>
+      <source file="/data/scratch &amp; logs.raw"/>
+      <target dev='vdb' bus='virtio'/>
+    </disk>
+    <disk type='file' device='cdrom'>
+      <source file='/var/lib/libvirt/images/alice__web__1718000000-cloudinit.iso'/>
+      <target dev='sda' bus='sata'/>
+    </disk>
+    <interface type='network'>
+      <mac address='52:54:00:3a:91:0c'/>
+      <source network='default'/>
+    </interface>
+    <interface type='network'>
+      <mac address='52:54:00:3a:91:0d'/>
+      <source network='isolated'/>
+    </interface>
+  </devices>
+</domain>)";
+
+bool contains(const std::string& text, const std::string& part) {
+    return text.find(part) != std::string::npos;
+}
+
+void testCloneMode() {
+    CloneMode mode = CloneMode::Full;
+    CHECK(parseCloneMode("linked", mode) && mode == CloneMode::Linked);
+    CHECK(parseCloneMode("full", mode) && mode == CloneMode::Full);
+    CHECK(!parseCloneMode("shallow", mode));
+    CHECK(!parseCloneMode("", mode));
+    CHECK(std::string(cloneModeName(CloneMode::Linked)) == "linked");
+    CHECK(std::string(cloneModeName(CloneMode::Full)) == "full");
+}
+
+void testClonePath() {
+    // Images named after the VM keep their suffix
+    CHECK(clonePathFor(DIR + SOURCE + ".qcow2", SOURCE, CLONE, "vda") == DIR + CLONE + ".qcow2");
+    CHECK(clonePathFor(DIR + SOURCE + "-cloudinit.iso", SOURCE, CLONE, "sda")
+          == DIR + CLONE + "-cloudinit.iso");
+
+    // Anything else is named after the clone and the device
+    CHECK(clonePathFor("/data/scratch.raw", SOURCE, CLONE, "vdb") == "/data/" + CLONE + "-vdb.raw");
+    CHECK(clonePathFor("/data/scratch", SOURCE, CLONE, "vdb") == "/data/" + CLONE + "-vdb");
+    CHECK(clonePathFor("disk.img", SOURCE, CLONE, "vdc") == CLONE + "-vdc.img");
+
+    // Only the file name is matched, not the directory
+    CHECK(clonePathFor("/srv/" + SOURCE + "/disk.qcow2", SOURCE, CLONE, "vda")
+          == "/srv/" + SOURCE + "/" + CLONE + "-vda.qcow2");
+}
+
+void testFrozenTopPath() {
+    CHECK(frozenTopPath(DIR + SOURCE + ".qcow2", 1718000500) == DIR + SOURCE + "-1718000500.qcow2");
+    CHECK(frozenTopPath("/data/scratch.raw", 7) == "/data/scratch-7.qcow2");
+    CHECK(frozenTopPath("/data/scratch", 7) == "/data/scratch-7.qcow2");
+}
+
+void testBuildCloneXML() {
+    std::vector<std::pair<std::string, std::string>> paths = {
+        {DIR + SOURCE + ".qcow2", DIR + CLONE + ".qcow2"},
+        {"/data/scratch & logs.raw", "/data/" + CLONE + "-vdb.raw"},
+        {DIR + SOURCE + "-cloudinit.iso", DIR + CLONE + "-cloudinit.iso"},
+    };
+    std::string xml = buildCloneXML(SOURCE_XML, SOURCE, CLONE, paths);
+
+    CHECK(contains(xml, "<name>" + CLONE + "</name>"));
+    CHECK(!contains(xml, "<name>" + SOURCE + "</name>"));
+
+    // libvirt generates a UUID and MACs for the clone
+    CHECK(!contains(xml, "<uuid>"));
+    CHECK(!contains(xml, "<mac address="));
+    CHECK(contains(xml, "<source network='default'/>"));
+    CHECK(contains(xml, "<source network='isolated'/>"));
+
+    // Disks, quoted either way and escaped
+    CHECK(contains(xml, "<source file='" + DIR + CLONE + ".qcow2'/>"));
+    CHECK(contains(xml, "<source file=\"/data/" + CLONE + "-vdb.raw\"/>"));
+    CHECK(contains(xml, "<source file='" + DIR + CLONE + "-cloudinit.iso'/>"));
+    CHECK(!contains(xml, SOURCE + ".qcow2"));
+    CHECK(!contains(xml, "scratch &amp; logs"));
+
+    CHECK(contains(xml, "<memory unit='KiB'>2097152</memory>"));
+    CHECK(contains(xml, "<target dev='vdb' bus='virtio'/>"));
+
+    // A path that is a prefix of another is only swapped where it is whole
+    std::string prefixed = buildCloneXML(
+        "<domain><name>a</name><source file='/x/a.qcow2'/><source file='/x/a.qcow2.bak'/></domain>",
+        "a", "b", {{"/x/a.qcow2", "/x/b.qcow2"}});
+    CHECK(contains(prefixed, "<name>b</name>"));
+    CHECK(contains(prefixed, "'/x/b.qcow2'"));
+    CHECK(contains(prefixed, "'/x/a.qcow2.bak'"));
+}
+
+} // namespace
+
+int main() {
+    testCloneMode();
+    testClonePath();
+    testFrozenTopPath();
+    testBuildCloneXML();
+    return finish("vm_clone");
+}
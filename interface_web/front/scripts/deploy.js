@@ -92,9 +92,8 @@ async function deployVM(event) {
             body: JSON.stringify(deployData)
         });
         
-        updateProgressStep(1, 'success');
-        updateProgressStep(2, 'success');
-        updateProgressStep(3, 'success');
+        // Steps 1-3 follow the backend deployment job
+        await waitForJob(result.jobId);
         
         // Step 4: Wait for cloud-init
         updateProgressStep(4, 'loading');
@@ -161,6 +160,49 @@ function getFlavorConfig(flavorType) {
     return flavors[flavorType] || flavors.medium;
 }
 
+// Backend job steps shown under each progress step
+const JOB_STEP_PROGRESS = {
+    'validate': 1,
+    'check-name': 1,
+    'claim-warm': 2,
+    'preflight': 1,
+    'cloud-init': 1,
+    'disk': 2,
+    'define': 2,
+    'start': 3
+};
+
+// Poll a deployment job until it finishes, mirroring its steps in the progress list
+async function waitForJob(jobId) {
+    while (true) {
+        const data = await fetchAPI(`/jobs/${jobId}`);
+        const job = data.job;
+        
+        let current = 1;
+        for (const step of job.steps) {
+            current = JOB_STEP_PROGRESS[step.name] || current;
+        }
+        for (let i = 1; i < current; i++) {
+            updateProgressStep(i, 'success');
+        }
+        
+        if (job.state === 'succeeded') {
+            for (let i = current; i <= 3; i++) {
+                updateProgressStep(i, 'success');
+            }
+            return job;
+        }
+        
+        if (job.state === 'failed') {
+            updateProgressStep(current, 'error');
+            throw new Error(job.error || 'Deployment failed');
+        }
+        
+        updateProgressStep(current, 'loading');
+        await new Promise(resolve => setTimeout(resolve, 1000));
+    }
+}
+
 // Wait for VM IP
 async function waitForVMIP(vmName, maxWaitSeconds) {
     const startTime = Date.now();
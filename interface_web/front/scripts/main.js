@@ -10,7 +10,7 @@ let users = [
 
 // Monitoring Charts
 let charts = {};
-let monitoringInterval = null;
+let monitoringStream = null;
 
 // ==========================================
 // PaaS Applications
@@ -323,9 +323,9 @@ function initCharts() {
 function toggleMonitoring() {
     const toggleBtn = document.getElementById('monitoring-toggle');
     
-    if (monitoringInterval) {
-        clearInterval(monitoringInterval);
-        monitoringInterval = null;
+    if (monitoringStream) {
+        monitoringStream.close();
+        monitoringStream = null;
         toggleBtn.innerHTML = '<span>▶️</span> Start';
         showToast('Monitoring stopped', 'info');
     } else {
@@ -333,30 +333,30 @@ function toggleMonitoring() {
             showToast('⚠️ Select a VM first', 'warning');
             return;
         }
-        monitoringInterval = setInterval(updateMonitoring, 3000);
+        const vmName = currentVM;
+        monitoringStream = new EventSource(`${API_URL}/stream/stats?vms=${encodeURIComponent(vmName)}`);
+        monitoringStream.addEventListener('stats', (event) => {
+            try {
+                const data = JSON.parse(event.data);
+                updateMonitoring(data[vmName]);
+            } catch (error) {
+                console.error('Error updating monitoring:', error);
+            }
+        });
         toggleBtn.innerHTML = '<span>⏸️</span> Stop';
         showToast('Monitoring started', 'success');
-        updateMonitoring();
     }
 }
 
-async function updateMonitoring() {
-    if (!currentVM) return;
+function updateMonitoring(stats) {
+    if (!stats) return;
     
-    try {
-        const data = await fetchAPI(`/vms/${currentVM}/stats`);
-        const stats = data.stats;
-        if (!stats) return;
-        
-        const now = new Date().toLocaleTimeString();
-        
-        updateChart(charts.cpu, now, stats.cpu);
-        updateChart(charts.memory, now, parseFloat(stats.memory.percent));
-        updateChart(charts.disk, now, parseFloat(stats.disk.writeMB));
-        updateChart(charts.network, now, parseFloat(stats.network.txMB));
-    } catch (error) {
-        console.error('Error updating monitoring:', error);
-    }
+    const now = new Date().toLocaleTimeString();
+    
+    updateChart(charts.cpu, now, stats.cpu);
+    updateChart(charts.memory, now, parseFloat(stats.memory.percent));
+    updateChart(charts.disk, now, parseFloat(stats.disk.writeMB));
+    updateChart(charts.network, now, parseFloat(stats.network.txMB));
 }
 
 function updateChart(chart, label, value) {
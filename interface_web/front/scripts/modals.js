@@ -213,14 +213,21 @@ function showCloneModal() {
                         <label>Clone Name *</label>
                         <input type="text" id="clone-name" required 
                                placeholder="e.g., ${currentVM}-clone" 
-                               pattern="[a-zA-Z0-9_-]+" 
-                               title="Only letters, numbers, hyphens and underscores">
+                               pattern="[a-zA-Z0-9-]+" 
+                               title="Only letters, numbers and hyphens">
+                    </div>
+                    <div class="form-group">
+                        <label>Clone Type</label>
+                        <select id="clone-mode">
+                            <option value="full">Full copy</option>
+                            <option value="linked">Linked (instant)</option>
+                        </select>
                     </div>
                     <div class="info-banner">
                         <span class="info-icon">ℹ️</span>
                         <div>
-                            <p><strong>This will create a full clone of the VM</strong></p>
-                            <p>All disks will be copied. The VM must be stopped to clone.</p>
+                            <p><strong>Full:</strong> all disks are copied. The VM must be stopped to clone.</p>
+                            <p><strong>Linked:</strong> the clone shares the current disk state with the source and only stores its own changes. Works while the VM is running.</p>
                         </div>
                     </div>
                 </div>
@@ -249,19 +256,30 @@ async function cloneVM(event) {
     event.preventDefault();
     
     const cloneName = document.getElementById('clone-name').value;
+    const mode = document.getElementById('clone-mode').value;
     
     closeCloneModal();
     showToast('Cloning VM...', 'info');
     
     try {
-        const result = await fetchAPI(`/vms/${currentVM}/clone`, {
+        const started = await fetchAPI(`/vms/${currentVM}/clone`, {
             method: 'POST',
             headers: { 'Content-Type': 'application/json' },
             body: JSON.stringify({
-                cloneName: cloneName
+                cloneName: cloneName,
+                mode: mode
             })
         });
         
+        // Cloning runs as a background job: wait for it to finish
+        let job = null;
+        while (started.jobId) {
+            job = (await fetchAPI(`/jobs/${started.jobId}`)).job;
+            if (job.state === 'succeeded' || job.state === 'failed') break;
+            await new Promise(resolve => setTimeout(resolve, 1000));
+        }
+        const result = job ? { success: job.state === 'succeeded', error: job.error } : started;
+        
         if (result.success) {
             showToast('✅ VM cloned successfully!', 'success');
             await loadVMs();
@@ -351,10 +369,19 @@ async function deleteVMConfirmed(event) {
     showToast('Deleting VM...', 'info');
     
     try {
-        const result = await fetchAPI(`/vms/${currentVM}?removeDisks=${removeDisks}`, {
+        const started = await fetchAPI(`/vms/${currentVM}?removeDisks=${removeDisks}`, {
             method: 'DELETE'
         });
         
+        // Deletion runs as a background job: wait for it to finish
+        let job = null;
+        while (started.jobId) {
+            job = (await fetchAPI(`/jobs/${started.jobId}`)).job;
+            if (job.state === 'succeeded' || job.state === 'failed') break;
+            await new Promise(resolve => setTimeout(resolve, 1000));
+        }
+        const result = job ? { success: job.state === 'succeeded', error: job.error } : started;
+        
         if (result.success) {
             showToast('✅ VM deleted successfully!', 'success');
             currentVM = null;
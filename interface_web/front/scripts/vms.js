@@ -1,7 +1,7 @@
 
 const API_URL = 'http://localhost:3000/api';
 let currentVM = null;
-let statsInterval = null;
+let statsStream = null;
 
 // Fetch API Wrapper
 async function fetchAPI(endpoint, options = {}) {
@@ -119,9 +119,7 @@ async function selectVM(vmName) {
         panelTitle.textContent = `VM: ${vmName}`;
     }
     
-    if (statsInterval) {
-        clearInterval(statsInterval);
-    }
+    stopStatsUpdate();
     
     await loadVMInfo();
     await loadSnapshots();
@@ -150,32 +148,42 @@ async function loadVMInfo() {
     }
 }
 
-// Start Stats Update
+// Start Stats Update (server pushes a sample on every sampler tick)
 function startStatsUpdate() {
-    updateStats();
-    statsInterval = setInterval(updateStats, 3000);
+    stopStatsUpdate();
+    if (!currentVM) return;
+    
+    const vmName = currentVM;
+    statsStream = new EventSource(`${API_URL}/stream/stats?vms=${encodeURIComponent(vmName)}`);
+    statsStream.addEventListener('stats', (event) => {
+        try {
+            const data = JSON.parse(event.data);
+            updateStats(data[vmName]);
+        } catch (error) {
+            console.error('Error updating stats:', error);
+        }
+    });
+}
+
+// Stop Stats Update
+function stopStatsUpdate() {
+    if (statsStream) {
+        statsStream.close();
+        statsStream = null;
+    }
 }
 
 // Update Stats
-async function updateStats() {
-    if (!currentVM) return;
+function updateStats(stats) {
+    if (!stats) return;
     
-    try {
-        const data = await fetchAPI(`/vms/${currentVM}/stats`);
-        const stats = data.stats;
-        
-        if (!stats) return;
-        
-        document.getElementById('cpu-usage').textContent = `${stats.cpu}%`;
-        document.getElementById('memory-usage').textContent = 
-            `${stats.memory.used} KB / ${stats.memory.max} KB (${stats.memory.percent}%)`;
-        document.getElementById('disk-io').textContent = 
-            `R: ${stats.disk.readMB} MB | W: ${stats.disk.writeMB} MB`;
-        document.getElementById('network-io').textContent = 
-            `RX: ${stats.network.rxMB} MB | TX: ${stats.network.txMB} MB`;
-    } catch (error) {
-        console.error('Error updating stats:', error);
-    }
+    document.getElementById('cpu-usage').textContent = `${stats.cpu}%`;
+    document.getElementById('memory-usage').textContent = 
+        `${stats.memory.used} KB / ${stats.memory.max} KB (${stats.memory.percent}%)`;
+    document.getElementById('disk-io').textContent = 
+        `R: ${stats.disk.readMB} MB | W: ${stats.disk.writeMB} MB`;
+    document.getElementById('network-io').textContent = 
+        `RX: ${stats.network.rxMB} MB | TX: ${stats.network.txMB} MB`;
 }
 
 // VM Actions
@@ -209,7 +217,7 @@ async function shutdownVM() {
         await loadVMInfo();
         await loadVMs();
         document.getElementById('vm-stats').style.display = 'none';
-        if (statsInterval) clearInterval(statsInterval);
+        stopStatsUpdate();
     } catch (error) {
         showToast(`❌ Error: ${error.message}`, 'error');
     }